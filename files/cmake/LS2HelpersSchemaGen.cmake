@@ -0,0 +1,57 @@
+# Copyright (c) 2016-2018 LG Electronics, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-License-Identifier: Apache-2.0
+
+include(CMakeParseArguments)
+
+if(NOT LS2_HELPERS_SCHEMAGEN)
+    set(LS2_HELPERS_SCHEMAGEN "${CMAKE_CURRENT_LIST_DIR}/../scripts/ls2-helpers-schemagen.py")
+endif()
+
+# Usage: ls2_helpers_generate_schema(output schema [NAME name] [NAMESPACE namespace])
+#
+# Generates a header with LSHelpers::JsonStruct types from a JSON schema file.
+# The header is regenerated when the schema changes. Add the header to the sources of the target
+# and ${CMAKE_CURRENT_BINARY_DIR} to its include directories.
+#
+# <output> variable to set to the generated header path, <schema name>_schema.hpp
+# <schema> JSON schema file
+# NAME name of the root struct, default is derived from the schema file name
+# NAMESPACE namespace for the generated structs
+function(ls2_helpers_generate_schema output schema)
+    cmake_parse_arguments(ARG "" "NAME;NAMESPACE" "" ${ARGN})
+
+    # Looked up only when used, including the module does not need Python.
+    find_package(PythonInterp 3 REQUIRED)
+
+    get_filename_component(schema ${schema} ABSOLUTE)
+    get_filename_component(name ${schema} NAME_WE)
+    set(header ${CMAKE_CURRENT_BINARY_DIR}/${name}_schema.hpp)
+
+    set(options)
+    if(ARG_NAME)
+        list(APPEND options --name ${ARG_NAME})
+    endif()
+    if(ARG_NAMESPACE)
+        list(APPEND options --namespace ${ARG_NAMESPACE})
+    endif()
+
+    add_custom_command(OUTPUT ${header}
+                       COMMAND ${PYTHON_EXECUTABLE} ${LS2_HELPERS_SCHEMAGEN} ${schema} -o ${header} ${options}
+                       DEPENDS ${schema} ${LS2_HELPERS_SCHEMAGEN}
+                       COMMENT "Generating ${name}_schema.hpp from ${schema}")
+
+    set(${output} ${header} PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+# Copyright (c) 2016-2018 LG Electronics, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""
+Generates C++ structs from a JSON schema.
+
+Each object in the schema becomes a LSHelpers::JsonStruct. The field description
+carries the schema constraints (required, minimum, maximum, enum, default,
+additionalProperties), so decoding a request into the struct validates it in the
+same pass. Register the handler with ServicePoint::registerMethod taking the
+generated struct.
+
+Supported schema subset: types object, array, string, integer, number and boolean,
+properties, required, additionalProperties (boolean), items, enum (strings and
+integers), minimum, maximum and default. Anything else that affects validation is
+reported as an error, so the generated code never validates less than the schema.
+Integers are int32_t only if enum or both minimum and maximum keep them in range,
+otherwise int64_t, so the generated code does not reject values the schema accepts.
+
+Usage: ls2-helpers-schemagen.py schema.json -o schema.hpp [--name Name] [--namespace ns]
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# Keywords without effect on validation.
+IGNORED_KEYWORDS = {"$schema", "id", "title", "description"}
+
+OBJECT_KEYWORDS = {"type", "properties", "required", "additionalProperties"}
+ARRAY_KEYWORDS = {"type", "items"}
+SCALAR_KEYWORDS = {"type", "enum", "minimum", "maximum", "default"}
+
+INT32_MIN = -2 ** 31
+INT32_MAX = 2 ** 31 - 1
+
+
+class SchemaError(Exception):
+    pass
+
+
+def pascal_case(name):
+    parts = re.split(r"[^0-9A-Za-z]+", name)
+    result = "".join(part[:1].upper() + part[1:] for part in parts if part)
+    if not result or result[0].isdigit():
+        result = "S" + result
+    return result
+
+
+def identifier(name):
+    result = re.sub(r"[^0-9A-Za-z_]", "_", name)
+    if not result or result[0].isdigit():
+        result = "_" + result
+    return result
+
+
+def cpp_string(value):
+    return json.dumps(value, ensure_ascii=True)
+
+
+def check_keywords(schema, allowed, path):
+    unsupported = set(schema) - allowed - IGNORED_KEYWORDS
+    if unsupported:
+        raise SchemaError("%s: unsupported keywords %s" % (path, ", ".join(sorted(unsupported))))
+
+
+class Generator(object):
+    def __init__(self):
+        self.structs = []  # Struct definitions, dependencies first.
+        self.names = set()
+
+    def struct_name(self, name):
+        result = name
+        index = 2
+        while result in self.names:
+            result = "%s%d" % (name, index)
+            index += 1
+        self.names.add(result)
+        return result
+
+    def field_type(self, schema, name, path):
+        """Returns C++ type of the value, generating structs for objects."""
+        if not isinstance(schema, dict):
+            raise SchemaError("%s: schema must be an object" % path)
+
+        schema_type = schema.get("type")
+        if schema_type == "object":
+            return self.generate_struct(schema, pascal_case(name), path)
+
+        if schema_type == "array":
+            check_keywords(schema, ARRAY_KEYWORDS, path)
+            if "items" not in schema:
+                raise SchemaError("%s: array without items" % path)
+            return "std::vector<%s>" % self.field_type(schema["items"], name + "Item", path + "/items")
+
+        check_keywords(schema, SCALAR_KEYWORDS, path)
+        if schema_type == "string":
+            return "std::string"
+        if schema_type == "boolean":
+            return "bool"
+        if schema_type == "number":
+            return "double"
+        if schema_type == "integer":
+            # Schema integers are not limited, use int32_t only if the schema keeps the value in range.
+            if "enum" in schema:
+                values = schema["enum"]
+            elif "minimum" in schema and "maximum" in schema:
+                values = [schema["minimum"], schema["maximum"]]
+            else:
+                return "int64_t"
+            if all(INT32_MIN <= v <= INT32_MAX for v in values):
+                return "int32_t"
+            return "int64_t"
+
+        raise SchemaError("%s: unsupported type %s" % (path, json.dumps(schema_type)))
+
+    def field_options(self, schema, required, path):
+        options = []
+        if not required:
+            options.append(".optional()")
+
+        if "default" in schema:
+            options.append(".defaultValue(%s)" % self.literal(schema["default"], schema, path + "/default"))
+        if "minimum" in schema:
+            options.append(".min(%s)" % self.literal(schema["minimum"], schema, path + "/minimum"))
+        if "maximum" in schema:
+            options.append(".max(%s)" % self.literal(schema["maximum"], schema, path + "/maximum"))
+        if "enum" in schema:
+            values = ", ".join(self.literal(v, schema, path + "/enum") for v in schema["enum"])
+            options.append(".allowedValues({%s})" % values)
+        return "".join(options)
+
+    def literal(self, value, schema, path):
+        schema_type = schema.get("type")
+        if schema_type == "string" and isinstance(value, str):
+            return "std::string(%s)" % cpp_string(value)
+        if schema_type == "boolean" and isinstance(value, bool):
+            return "true" if value else "false"
+        if schema_type == "integer" and isinstance(value, int) and not isinstance(value, bool):
+            return "%d" % value if INT32_MIN <= value <= INT32_MAX else "INT64_C(%d)" % value
+        if schema_type == "number" and isinstance(value, (int, float)) and not isinstance(value, bool):
+            return repr(float(value))
+        raise SchemaError("%s: value %s does not match type %s" % (path, json.dumps(value), schema_type))
+
+    def generate_struct(self, schema, name, path):
+        check_keywords(schema, OBJECT_KEYWORDS, path)
+
+        additional = schema.get("additionalProperties", True)
+        if not isinstance(additional, bool):
+            raise SchemaError("%s: only boolean additionalProperties is supported" % path)
+
+        properties = schema.get("properties", {})
+        required = set(schema.get("required", []))
+        missing = required - set(properties)
+        if missing:
+            raise SchemaError("%s: required properties not described: %s" % (path, ", ".join(sorted(missing))))
+
+        struct_name = self.struct_name(name)
+        members = []
+        fields = []
+        for key, value in properties.items():
+            field_path = "%s/properties/%s" % (path, key)
+            member = identifier(key)
+            members.append("\t%s %s;" % (self.field_type(value, key, field_path), member))
+            fields.append("\t\tfield(%s, %s)%s;" % (cpp_string(key), member,
+                                                    self.field_options(value, key in required, field_path)))
+
+        lines = []
+        if "description" in schema:
+            lines.append("/** %s */" % schema["description"].replace("*/", "* /"))
+        lines.append("struct %s : public LSHelpers::JsonStruct<%s, %s>" % (struct_name, struct_name,
+                                                                         "false" if additional else "true"))
+        lines.append("{")
+        lines.extend(members)
+        if members:
+            lines.append("")
+        lines.append("\ttemplate<typename V>")
+        lines.append("\tvoid jsonFields(V& field)")
+        lines.append("\t{")
+        lines.extend(fields)
+        lines.append("\t}")
+        lines.append("};")
+        self.structs.append("\n".join(lines))
+        return struct_name
+
+
+def generate(schema, name, namespace, source):
+    generator = Generator()
+    if schema.get("type") != "object":
+        raise SchemaError("#: root of the schema must be an object")
+    generator.generate_struct(schema, name, "#")
+
+    output = [
+        "// Generated by ls2-helpers-schemagen from %s. Do not edit." % os.path.basename(source),
+        "",
+        "#pragma once",
+        "",
+        "#include <cstdint>",
+        "#include <map>",
+        "#include <string>",
+        "#include <vector>",
+        "#include <ls2-helpers/jsonstruct.hpp>",
+        "",
+    ]
+    if namespace:
+        output.extend(["namespace %s {" % namespace, ""])
+    output.append("\n\n".join(generator.structs))
+    if namespace:
+        output.extend(["", "} // namespace %s" % namespace])
+    output.append("")
+    return "\n".join(output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate C++ structs from a JSON schema.")
+    parser.add_argument("schema", help="JSON schema file")
+    parser.add_argument("-o", "--output", required=True, help="output header")
+    parser.add_argument("--name", help="name of the root struct, default from the schema file name")
+    parser.add_argument("--namespace", help="namespace for the generated structs")
+    args = parser.parse_args()
+
+    name = args.name or pascal_case(os.path.basename(args.schema).split(".")[0])
+
+    try:
+        with open(args.schema) as schema_file:
+            schema = json.load(schema_file)
+        header = generate(schema, name, args.namespace, args.schema)
+    except (IOError, ValueError, SchemaError) as error:
+        sys.stderr.write("%s: %s\n" % (args.schema, error))
+        return 1
+
+    with open(args.output, "w") as output_file:
+        output_file.write(header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
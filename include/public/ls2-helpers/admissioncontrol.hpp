@@ -0,0 +1,250 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <luna-service2/lunaservice.hpp>
+
+namespace LSHelpers {
+
+/**
+ * @brief Limits of a method's concurrent requests.
+ * A request is in flight from the time it is dispatched to the handler until its first response,
+ * deferred requests included.
+ *
+ * Optionally, requests are also limited per sender:
+ * - senderRate - token bucket per sender. Calls over the rate are rejected with a rate limit error.
+ * - fairQueuing - requests waiting for a slot are queued per sender and served with deficit round
+ *   robin, instead of in arrival order. A request costs one unit plus one per KiB of payload, each
+ *   sender gets quantum units per round. When the queue is full, a new request displaces the last
+ *   request of the sender with the longest queue, so a chatty sender can not lock out the others.
+ *
+ * Example:
+ * @code
+ * service.setAdmissionLimits("/", "query", AdmissionLimits(4, 64)
+ *                                              .senderRate(20, 40)
+ *                                              .fairQueuing()
+ *                                              .keyedBy(AdmissionLimits::SenderKey::ApplicationId));
+ * @endcode
+ */
+struct AdmissionLimits
+{
+	/** What identifies a sender. */
+	enum class SenderKey : uint8_t
+	{
+		Sender,       ///< Unique name of the sender's connection, LSMessageGetSender.
+		ApplicationId ///< Application id, falls back to the sender for calls not made by an application.
+	};
+
+	/**
+	 * @param _maxInFlight maximum number of requests in flight, 0 for no limit.
+	 * @param _maxQueued maximum number of requests waiting for a free slot. Requests over it are
+	 *                   rejected with a busy error.
+	 */
+	explicit AdmissionLimits(size_t _maxInFlight = 0, size_t _maxQueued = 0)
+			: maxInFlight(_maxInFlight)
+			, maxQueued(_maxQueued)
+			, rate(0)
+			, burst(0)
+			, quantum(0)
+			, key(SenderKey::Sender)
+	{}
+
+	/**
+	 * Limit the call rate of each sender.
+	 * @param _rate calls per second, 0 for no limit.
+	 * @param _burst calls a sender can make at once, at least one.
+	 */
+	AdmissionLimits& senderRate(double _rate, uint32_t _burst)
+	{
+		rate = _rate;
+		burst = _burst > 0 ? _burst : 1;
+		return *this;
+	}
+
+	/**
+	 * Serve queued requests round robin between senders.
+	 * @param _quantum cost units per sender per round.
+	 */
+	AdmissionLimits& fairQueuing(uint32_t _quantum = 1)
+	{
+		quantum = _quantum > 0 ? _quantum : 1;
+		return *this;
+	}
+
+	/**
+	 * Set what identifies a sender for the per sender limits. Sender by default.
+	 */
+	AdmissionLimits& keyedBy(SenderKey _key)
+	{
+		key = _key;
+		return *this;
+	}
+
+	size_t maxInFlight;
+	size_t maxQueued;
+	double rate;      // 0 for no per sender rate limit.
+	uint32_t burst;
+	uint32_t quantum; // 0 for first in first out queue.
+	SenderKey key;
+};
+
+/**
+ * @brief Counters of a method's admission control.
+ */
+struct AdmissionStats
+{
+	uint64_t admitted; ///< Requests dispatched to the handler, including the ones queued first.
+	uint64_t queued;   ///< Requests that waited for a free slot.
+	uint64_t rejected; ///< Requests rejected with a busy error, including the displaced ones.
+	uint64_t rateLimited; ///< Requests rejected by the per sender rate limit.
+	size_t inFlight;   ///< Requests currently in flight.
+	size_t queueDepth; ///< Requests currently waiting.
+};
+
+/**
+ * @brief Admission control of one method. Set with ServicePoint::setAdmissionLimits.
+ *
+ * Requests over the in flight limit wait in a FIFO queue and are dispatched as earlier requests
+ * respond. Requests over the queue limit are rejected right away, before the payload is parsed,
+ * so the requests that are admitted keep a bounded latency under overload.
+ *
+ * Multithreading: This class is thread safe.
+ */
+class AdmissionControl
+{
+public:
+	enum class Decision : uint8_t
+	{
+		Admit,      ///< Dispatch the request now.
+		Queue,      ///< The request is queued, it is returned from release once a slot is free.
+		Reject,     ///< Respond with a busy error.
+		RateLimited ///< Respond with a rate limit error.
+	};
+
+	explicit AdmissionControl(const AdmissionLimits& limits)
+			: mLimits(limits)
+			, mInFlight(0)
+			, mQueued(0)
+			, mStats()
+	{}
+
+	/** Not copyable. */
+	AdmissionControl(const AdmissionControl&) = delete;
+	AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+	/**
+	 * Admit a new request.
+	 * @param message request message, stored if queued.
+	 * @param displaced set to a queued request displaced by this one with fair queuing.
+	 *                  Respond to it with a busy error.
+	 * @param arrivalUs arrival time of the request, returned by release if queued.
+	 * @return decision.
+	 */
+	Decision admit(const LS::Message& message, LS::Message& displaced, uint64_t arrivalUs = 0);
+
+	/**
+	 * Admit a new request, with the sender key and cost given.
+	 * @param message request message, stored if queued.
+	 * @param sender sender key.
+	 * @param cost cost units of the request, for fair queuing.
+	 * @param displaced set to a queued request displaced by this one.
+	 * @param nowMs current time, in milliseconds.
+	 * @param arrivalUs arrival time of the request, returned by release if queued.
+	 * @return decision.
+	 */
+	Decision admit(const LS::Message& message,
+	               const std::string& sender,
+	               uint32_t cost,
+	               LS::Message& displaced,
+	               uint64_t nowMs,
+	               uint64_t arrivalUs = 0);
+
+	/**
+	 * Release the slot of an admitted request, the request has responded.
+	 * @param next set to the next queued request, if any. The request takes over the slot.
+	 * @param arrivalUs if not null, set to the arrival time of next given to admit.
+	 * @return true if next is set and should be dispatched.
+	 */
+	bool release(LS::Message& next, uint64_t* arrivalUs = nullptr);
+
+	/**
+	 * @return admission counters.
+	 */
+	AdmissionStats getStats() const;
+
+	/**
+	 * @return number of queued requests of a sender. Counted only with fair queuing.
+	 */
+	size_t getQueueDepth(const std::string& sender) const;
+
+	/**
+	 * @return the limits.
+	 */
+	inline const AdmissionLimits& getLimits() const { return mLimits; }
+
+private:
+	static const size_t MAX_BUCKETS = 4096;
+
+	struct Bucket
+	{
+		double tokens;
+		uint64_t updatedMs;
+		std::list<const std::string*>::iterator order; // Position in mBucketOrder.
+	};
+
+	struct Queued
+	{
+		LS::Message message;
+		uint32_t cost;
+		uint64_t arrivalUs;
+	};
+
+	// Queue of one sender, for fair queuing.
+	struct Flow
+	{
+		std::string sender;
+		std::deque<Queued> queue;
+		uint64_t deficit = 0;
+		bool granted = false; // Quantum added in this round.
+	};
+
+	bool takeToken(const std::string& sender, uint64_t nowMs);
+	bool enqueueFair(const Queued& queued,
+	                 const std::string& sender,
+	                 LS::Message& displaced,
+	                 bool& isDisplaced);
+	Queued dequeueFair();
+
+	const AdmissionLimits mLimits;
+	mutable std::mutex mMutex;
+	std::deque<Queued> mQueue; // First in first out queue.
+	std::unordered_map<std::string, Flow> mFlows; // Fair queue, per sender.
+	std::deque<Flow*> mActiveFlows; // Round robin order of the senders with queued requests.
+	std::unordered_map<std::string, Bucket> mBuckets; // Rate limit, per sender.
+	std::list<const std::string*> mBucketOrder; // Keys of mBuckets, least recently used first.
+	size_t mInFlight;
+	size_t mQueued;
+	AdmissionStats mStats;
+};
+
+} // namespace LSHelpers;
@@ -0,0 +1,189 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LSHelpers {
+
+/**
+ * @brief Monotonic memory arena.
+ * Allocations are bump pointer allocations from large blocks, individual deallocation is a no-op.
+ * All memory is released at once with reset() or when the arena is destroyed.
+ *
+ * Use with ArenaAllocator for containers and strings that live for the duration of one request,
+ * see JsonRequest::getArena().
+ *
+ * Multithreading: Not thread safe. The acquire() / release cache is per thread.
+ */
+class Arena
+{
+public:
+	/**
+	 * Returns arena to the per thread cache.
+	 */
+	struct Releaser
+	{
+		void operator()(Arena* arena) const;
+	};
+
+	typedef std::unique_ptr<Arena, Releaser> Ptr;
+
+	/**
+	 * @param blockSize size of the first block, in bytes. Later blocks grow.
+	 */
+	explicit Arena(size_t blockSize = 4096);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/**
+	 * Allocates memory from the arena.
+	 * @param size size in bytes.
+	 * @param alignment alignment, must be a power of two.
+	 * @return pointer to memory valid until reset() or the arena is destroyed.
+	 * @throw std::bad_alloc if out of memory.
+	 */
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/**
+	 * Releases all allocations. Keeps one block for reuse, unless it has grown large.
+	 */
+	void reset();
+
+	/**
+	 * @return number of bytes allocated since the last reset.
+	 */
+	inline size_t getBytesAllocated() const
+	{
+		return mBytesAllocated;
+	}
+
+	/**
+	 * Gets an arena from the per thread cache, or creates a new one.
+	 * The arena is reset and returned to the cache of the releasing thread when the pointer is destroyed.
+	 */
+	static Ptr acquire();
+
+private:
+	struct Block
+	{
+		Block* next;
+		size_t size;
+	};
+
+	void addBlock(size_t minSize);
+
+	size_t mBlockSize;
+	Block* mBlocks; // Newest block first
+	char* mCurrent;
+	char* mEnd;
+	size_t mBytesAllocated;
+};
+
+/**
+ * @brief Standard library allocator allocating from an Arena.
+ * Deallocation is a no-op, the memory is released with the arena.
+ * A default constructed allocator has no arena and uses the heap.
+ *
+ * Example:
+ * @code
+ * ArenaString name{ArenaAllocator<char>(request.getArena())};
+ * request.get("name", name);
+ * @endcode
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator() noexcept
+		: mArena(nullptr)
+	{}
+
+	explicit ArenaAllocator(Arena& arena) noexcept
+		: mArena(&arena)
+	{}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+		: mArena(other.getArena())
+	{}
+
+	inline T* allocate(size_t n)
+	{
+		if (!mArena)
+		{
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+		return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	inline void deallocate(T* p, size_t) noexcept
+	{
+		if (!mArena)
+		{
+			::operator delete(p);
+		}
+	}
+
+	inline Arena* getArena() const noexcept
+	{
+		return mArena;
+	}
+
+	template<typename U>
+	inline bool operator==(const ArenaAllocator<U>& other) const noexcept
+	{
+		return mArena == other.getArena();
+	}
+
+	template<typename U>
+	inline bool operator!=(const ArenaAllocator<U>& other) const noexcept
+	{
+		return mArena != other.getArena();
+	}
+
+private:
+	Arena* mArena;
+};
+
+/** String allocated from an arena. */
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> > ArenaString;
+
+/** Vector allocated from an arena. */
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+} // Namespace LSHelpers
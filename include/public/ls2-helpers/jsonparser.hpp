@@ -16,13 +16,21 @@
 
 #pragma once
 
+#include <array>
 #include <exception>
 #include <functional>
+#include <map>
 #include <string>
 #include <sstream>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 #include <pbnjson.hpp>
 
+#include "arena.hpp"
+#include "stringmap.hpp"
+#include "stringref.hpp"
+
 namespace LSHelpers {
 
 template<typename T> class JsonParseContext;
@@ -94,6 +102,133 @@ public:
 	virtual void parseFromJson(const pbnjson::JValue& value) = 0;
 };
 
+/**
+ * @brief Kind of a parse error.
+ */
+enum class ParseErrorCode : uint8_t
+{
+	MalformedJson,    ///< The payload is not valid JSON.
+	Missing,          ///< Mandatory field not present.
+	NullValue,        ///< Null value where not allowed.
+	InvalidValue,     ///< Wrong type or value that failed to parse.
+	OutOfRange,       ///< Value less than minimum, greater than maximum or out of bounds of the type.
+	NotAllowed,       ///< Value not in allowed values.
+	UnexpectedFields  ///< Fields not read in strict mode.
+};
+
+/**
+ * @brief Parse error record.
+ * Holds the error in structured form, text is formatted only when requested.
+ * @see JsonParser::getDiagnostics
+ */
+struct ParseDiagnostic
+{
+	/**
+	 * @param _code error code
+	 * @param _field field name
+	 * @param _message error description. Not copied - must be a string literal.
+	 * @param _index array element index, -1 if the error is not about an array element.
+	 * @param _detail error description to use instead of message, for formatted messages.
+	 */
+	ParseDiagnostic(ParseErrorCode _code,
+	                const char* _field,
+	                const char* _message,
+	                ssize_t _index = -1,
+	                std::string _detail = std::string())
+		: code(_code)
+		, field(_field ? _field : "")
+		, index(_index)
+		, message(_message)
+		, detail(std::move(_detail))
+	{}
+
+	/**
+	 * @return error description.
+	 */
+	inline const char* getMessage() const
+	{
+		return detail.empty() ? message : detail.c_str();
+	}
+
+	/**
+	 * @return location of the error as JSON pointer (RFC 6901), e.g. "/values/3".
+	 *         Empty string for errors about the whole document.
+	 */
+	std::string getLocation() const;
+
+	/**
+	 * @return human readable error message, as returned by JsonParser::getError.
+	 */
+	std::string toString() const;
+
+	ParseErrorCode code;
+	std::string field; ///< Field name, empty for errors about the whole document.
+	ssize_t index; ///< Array element index or -1.
+	const char* message;
+	std::string detail;
+};
+
+/**
+ * True for the element types supported by JsonParser::getNumericArray -
+ * the fixed width integer types, float and double.
+ */
+template<typename T>
+struct IsNumericArrayElement : std::integral_constant<bool,
+		std::is_same<T, int8_t>::value || std::is_same<T, uint8_t>::value ||
+		std::is_same<T, int16_t>::value || std::is_same<T, uint16_t>::value ||
+		std::is_same<T, int32_t>::value || std::is_same<T, uint32_t>::value ||
+		std::is_same<T, int64_t>::value || std::is_same<T, uint64_t>::value ||
+		std::is_same<T, float>::value || std::is_same<T, double>::value>
+{};
+
+/**
+ * @brief Column of an array of objects, for columnar decoding with JsonParser::getColumns.
+ * Holds the field name and the vector the field values of all array elements are stored in.
+ * Create with @ref column or @ref optionalColumn.
+ */
+template<typename T>
+struct JsonColumn
+{
+	JsonColumn(const char* _name, std::vector<T>& _destination, bool _optional, const T& _defaultValue)
+		: name(_name)
+		, destination(_destination)
+		, optional(_optional)
+		, defaultValue(_defaultValue)
+	{}
+
+	std::string name;
+	std::vector<T>& destination;
+	bool optional;
+	T defaultValue;
+};
+
+/**
+ * Creates a required column for JsonParser::getColumns.
+ * Every array element must have the field.
+ * @param name field name
+ * @param destination vector to store the field values in.
+ */
+template<typename T>
+JsonColumn<T> column(const char* name, std::vector<T>& destination)
+{
+	return JsonColumn<T>(name, destination, false, T());
+}
+
+/**
+ * Creates an optional column for JsonParser::getColumns.
+ * Elements without the field, or with null value, store defaultValue.
+ * @param name field name
+ * @param destination vector to store the field values in.
+ * @param defaultValue value for elements that miss the field.
+ */
+template<typename T>
+JsonColumn<T> optionalColumn(const char* name,
+                             std::vector<T>& destination,
+                             const typename std::vector<T>::value_type& defaultValue = T())
+{
+	return JsonColumn<T>(name, destination, true, defaultValue);
+}
+
 /**
  * @brief Helper class to validate JSON against schema and parse to C++ objects.
  * With the aim to provide a clean and concise syntax.
@@ -128,10 +263,11 @@ public:
 	explicit JsonParser(pbnjson::JValue json)
 			: _jsonValue(json)
 			, _numberOfFields(0)
+			, _pendingJson(nullptr)
 		{
 			if (!_jsonValue.isValid())
 			{
-				_parseError = "Malformed JSON.";
+				_diagnostics.emplace_back(ParseErrorCode::MalformedJson, "", "Malformed JSON.");
 			}
 		}
 
@@ -141,6 +277,7 @@ public:
 	explicit JsonParser(const char* json)
 			: _jsonValue()
 			, _numberOfFields(0)
+			, _pendingJson(nullptr)
 	{
 		if (json != nullptr)
 		{
@@ -149,7 +286,7 @@ public:
 
 		if (!_jsonValue.isValid())
 		{
-			_parseError = "Malformed JSON.";
+			_diagnostics.emplace_back(ParseErrorCode::MalformedJson, "", "Malformed JSON.");
 		}
 	}
 
@@ -165,6 +302,7 @@ public:
 	 */
 	inline const pbnjson::JValue getJson() const
 	{
+		ensureParsed();
 		return _jsonValue;
 	}
 
@@ -176,27 +314,43 @@ public:
 	 */
 	inline bool hasError() const
 	{
-		return !_parseError.empty();
+		ensureParsed();
+		return !_diagnostics.empty();
 	}
 
 	/**
-	 * Returns current error.
+	 * Returns the first error, formatted as text.
 	 * Returns empty string if no error.
-	 * JsonParser stores only the first error encountered.
+	 * @see getDiagnostics
 	 */
 	inline std::string getError() const
 	{
-		return _parseError;
+		ensureParsed();
+		return _diagnostics.empty() ? std::string() : _diagnostics.front().toString();
+	}
+
+	/**
+	 * Returns all errors, in the order encountered.
+	 * At most MAX_DIAGNOSTICS errors are stored.
+	 */
+	inline const std::vector<ParseDiagnostic>& getDiagnostics() const
+	{
+		ensureParsed();
+		return _diagnostics;
 	}
 
 	/**
-	 * Clears the error, allowing to continue parsing even if error occurred.
+	 * Clears the errors, allowing to continue parsing even if error occurred.
 	 */
 	inline void clearError()
 	{
-		_parseError.clear();
+		ensureParsed();
+		_diagnostics.clear();
 	}
 
+	/** Maximum number of errors stored. */
+	static const size_t MAX_DIAGNOSTICS = 16;
+
 	/** Look up a json field named *name* and store it's value in the *destination*.
 	 * This is polymorphic method and the parsing implementation depends on the
 	 * type of the destination field.
@@ -209,12 +363,42 @@ public:
 	 *
 	 * @param name field name
 	 * @param destination reference to variable to store the value in
-	 * @param parserFunc optional custom function for parsing the field.
 	 * @return JsonParseContext for adding more constraints using call chaining.
 	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
 	 * */
 	template<typename T>
-	JsonParseContext<T> get(const char* name, T& destination, const std::function<void(const pbnjson::JValue&, T&)>& parserFunc = &parseValueOrDataObject<T>);
+	JsonParseContext<T> get(const char* name, T& destination)
+	{
+		return get(name, destination, ValueParser<T>());
+	}
+
+	/** Look up a json field named *name* and store it's value in the *destination*, using custom parser function.
+	 * @see get
+	 *
+	 * @param name field name
+	 * @param destination reference to variable to store the value in
+	 * @param parserFunc function for parsing the field.
+	 * @return JsonParseContext for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 * */
+	template<typename T>
+	JsonParseContext<T> get(const char* name, T& destination, const std::function<void(const pbnjson::JValue&, T&)>& parserFunc)
+	{
+		return get<T, std::function<void(const pbnjson::JValue&, T&)> >(name, destination, parserFunc);
+	}
+
+	/** Look up a json field named *name* and store it's value in the *destination*, using custom parser function object.
+	 * The parser is a template parameter, so lambdas and function objects are called directly without std::function.
+	 * @see get
+	 *
+	 * @param name field name
+	 * @param destination reference to variable to store the value in
+	 * @param parserFunc function object callable as parserFunc(const pbnjson::JValue&, T&).
+	 * @return JsonParseContext for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 * */
+	template<typename T, typename F>
+	JsonParseContext<T> get(const char* name, T& destination, const F& parserFunc);
 
 	/** Look up a json string field named *name* and reinterpret it as a JSON payload.
 	 *  Then apply the regular get logic.
@@ -226,7 +410,25 @@ public:
 	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
 	 * */
 	template<typename T>
-	JsonParseContext<T> getFromString(const char* name, T& destination, const std::function<void(const pbnjson::JValue&, T&)>& parserFunc = &parseValueOrDataObject<T>);
+	JsonParseContext<T> getFromString(const char* name, T& destination)
+	{
+		return getFromString(name, destination, ValueParser<T>());
+	}
+
+	/** Look up a json string field named *name* and reinterpret it as a JSON payload, using custom parser function.
+	 * @see getFromString
+	 */
+	template<typename T>
+	JsonParseContext<T> getFromString(const char* name, T& destination, const std::function<void(const pbnjson::JValue&, T&)>& parserFunc)
+	{
+		return getFromString<T, std::function<void(const pbnjson::JValue&, T&)> >(name, destination, parserFunc);
+	}
+
+	/** Look up a json string field named *name* and reinterpret it as a JSON payload, using custom parser function object.
+	 * @see getFromString
+	 */
+	template<typename T, typename F>
+	JsonParseContext<T> getFromString(const char* name, T& destination, const F& parserFunc);
 
 	/** Look up a json field named *name* and translate into value using the provided map.
 	 * The following checks are performed and appropriate error messages are sent:
@@ -278,21 +480,234 @@ public:
 	template<typename IT, typename T>
 	JsonParseContext<T> getAndMap(const char* name, T& destination, std::initializer_list< std::pair<IT, T> > valueMap);
 
+	/** Look up a json string field named *name* and translate into value using perfect hash StringMap.
+	 * Fastest option for enum-like string fields - the string is looked up in place,
+	 * without creating std::string, and unknown values are rejected in constant time.
+	 *
+	 * Example:
+	 * @code
+	 * static const StringMap<MyEnum, 2> myEnumValues {{{"OPTION1", MyEnum::o1}, {"OPTION2", MyEnum::o2}}};
+	 * parser.getAndMap("someEnum", enumValue, myEnumValues);
+	 * @endcode
+	 *
+	 * @param name field name
+	 * @param destination reference to variable to store the value in
+	 * @param valueMap map from string to destination type.
+	 * @return JsonParseContext for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 * */
+	template<typename T, size_t N>
+	JsonParseContext<T> getAndMap(const char* name, T& destination, const StringMap<T, N>& valueMap);
+
 	/**
 	 * Parse array object to std::vector.
 	 * Individual items will be parsed using parserFunc.
+	 * The vector may use a custom allocator, e.g. ArenaVector.
 	 *
 	 * @param name field name
 	 * @param destination reference to array to store the values in
-	 * @param parserFunc optional - a function to parse individual items.
+	 * @param parserFunc optional - a function or function object to parse individual items.
 	 *                   Throw JsonParseException to indicate parse error.
 	 * @return JsonParseContext for adding more constraints using call chaining.
 	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
 	 */
+	template<typename T, typename A>
+	JsonParseContext< std::vector<T, A> > getArray(const char* name,
+	                                                 std::vector<T, A>& destination)
+	{
+		return getArray(name, destination, ValueParser<T>());
+	}
+
+	/**
+	 * Parse array object to std::vector, using custom parser function for items.
+	 * @see getArray
+	 */
 	template<typename T>
 	JsonParseContext< std::vector<T> > getArray(const char* name,
 	                                              std::vector<T>& destination,
-	                                              const std::function< void (const pbnjson::JValue& , T& )>& parserFunc = &parseValueOrDataObject<T>);
+	                                              const std::function< void (const pbnjson::JValue& , T& )>& parserFunc)
+	{
+		return getArray<T, std::function< void (const pbnjson::JValue& , T& )> >(name, destination, parserFunc);
+	}
+
+	/**
+	 * Parse array object to std::vector, using custom parser function object for items.
+	 * The parser is a template parameter, so it's called directly without std::function.
+	 * @see getArray
+	 */
+	template<typename T, typename F, typename A>
+	JsonParseContext< std::vector<T, A> > getArray(const char* name,
+	                                                 std::vector<T, A>& destination,
+	                                                 const F& parserFunc);
+
+	/**
+	 * Parse array of numbers to std::vector in bulk.
+	 * Faster than getArray for large numeric arrays - the elements are decoded in one pass,
+	 * range checked in blocks and a single error is reported for the whole array.
+	 * Numeric strings are accepted as numbers, like in get.
+	 *
+	 * @tparam T fixed width integer type, float or double, see IsNumericArrayElement.
+	 * @param name field name
+	 * @param destination reference to vector to store the values in. Cleared on error.
+	 * @return JsonParseContext for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 */
+	template<typename T, typename A>
+	JsonParseContext< std::vector<T, A> > getNumericArray(const char* name, std::vector<T, A>& destination);
+
+	/**
+	 * Parse array of numbers to std::array in bulk.
+	 * The JSON array must have exactly N elements.
+	 * @see getNumericArray
+	 */
+	template<typename T, size_t N>
+	JsonParseContext< std::array<T, N> > getNumericArray(const char* name, std::array<T, N>& destination);
+
+	/**
+	 * Parse array of numbers to a caller provided buffer in bulk.
+	 * @see getNumericArray
+	 *
+	 * Example:
+	 * @code
+	 * int16_t samples[1024];
+	 * size_t sampleCount;
+	 * parser.getNumericArray("samples", samples, 1024, sampleCount).min(1);
+	 * @endcode
+	 *
+	 * @param name field name
+	 * @param destination buffer to store the values in.
+	 * @param capacity number of elements in the buffer. It's an error if the JSON array is larger.
+	 * @param count set to the number of elements stored, 0 on error.
+	 * @return JsonParseContext for the element count, for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 */
+	template<typename T>
+	JsonParseContext<size_t> getNumericArray(const char* name, T* destination, size_t capacity, size_t& count);
+
+	/**
+	 * Parse array of objects into parallel vectors, one per field (struct of arrays).
+	 * All columns are filled in a single pass over the array, without creating an object per element.
+	 * Element i of the array is stored at index i of every column.
+	 * Use instead of getArray of JsonDataObject for large arrays of homogeneous objects.
+	 *
+	 * Example:
+	 * @code
+	 * std::vector<std::string> ids;
+	 * std::vector<int64_t> sizes;
+	 * std::vector<bool> visible;
+	 * size_t appCount;
+	 * parser.getColumns("apps", appCount,
+	 *                   column("id", ids),
+	 *                   column("size", sizes),
+	 *                   optionalColumn("visible", visible, true));
+	 * @endcode
+	 *
+	 * Fields not listed as columns are ignored.
+	 * On error all columns are cleared and a single error naming the element is recorded.
+	 *
+	 * @param name field name of the array.
+	 * @param rowCount set to the number of elements decoded.
+	 * @param columns columns to decode, created with column or optionalColumn.
+	 * @return JsonParseContext for the element count, for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 */
+	template<typename... Columns>
+	JsonParseContext<size_t> getColumns(const char* name, size_t& rowCount, Columns&&... columns);
+
+	/**
+	 * Visit elements of an array one at a time, without storing the whole array.
+	 * Each element is parsed into *element*, which is reused for all elements, and passed to the callback.
+	 * The callback returns false to stop the iteration, e.g. when the element searched for is found.
+	 * Element parse errors are reported like in get and stop the iteration.
+	 *
+	 * Example:
+	 * @code
+	 * AppInfo app;
+	 * bool found = false;
+	 * parser.forEachElement("apps", app, [&](const AppInfo& a)
+	 * {
+	 *     found = a.id == "com.example.app";
+	 *     return !found;
+	 * });
+	 * @endcode
+	 *
+	 * @param name field name of the array.
+	 * @param element storage for the current element. After the call holds the last element visited.
+	 * @param callback function object callable as bool callback(T& element). Return false to stop.
+	 * @return JsonParseContext for adding more constraints using call chaining.
+	 *         Constraints like min apply to the last element visited.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 */
+	template<typename T, typename C>
+	JsonParseContext<T> forEachElement(const char* name, T& element, const C& callback)
+	{
+		return forEachElement(name, element, callback, ValueParser<T>());
+	}
+
+	/**
+	 * Visit elements of an array one at a time, using custom parser function object for items.
+	 * @see forEachElement
+	 */
+	template<typename T, typename C, typename F>
+	JsonParseContext<T> forEachElement(const char* name, T& element, const C& callback, const F& parserFunc);
+
+	/**
+	 * Parse object with dynamic keys to std::unordered_map.
+	 * Each member value is parsed like in get. Parse errors are reported with field name "name.key".
+	 * When the destination is parsed again, the entries of existing keys are reused and parsed in place,
+	 * entries with keys no longer present are removed.
+	 *
+	 * Example:
+	 * @code
+	 * std::unordered_map<std::string, AppSettings> settings; // AppSettings implements JsonDataObject
+	 * parser.getMap("settings", settings);
+	 * @endcode
+	 *
+	 * @param name field name
+	 * @param destination reference to map to store the values in.
+	 * @return JsonParseContext for adding more constraints using call chaining.
+	 *         The return value shall not be assigned to a variable. It depends on destructor being called to finalize checks.
+	 */
+	template<typename T>
+	JsonParseContext< std::unordered_map<std::string, T> > getMap(const char* name,
+	                                                                std::unordered_map<std::string, T>& destination)
+	{
+		return getMap(name, destination, ValueParser<T>());
+	}
+
+	/**
+	 * Parse object with dynamic keys to std::unordered_map, using custom parser function object for values.
+	 * @see getMap
+	 */
+	template<typename T, typename F>
+	JsonParseContext< std::unordered_map<std::string, T> > getMap(const char* name,
+	                                                                std::unordered_map<std::string, T>& destination,
+	                                                                const F& parserFunc)
+	{
+		return getMapImpl(name, destination, parserFunc);
+	}
+
+	/**
+	 * Parse object with dynamic keys to std::map.
+	 * @see getMap
+	 */
+	template<typename T>
+	JsonParseContext< std::map<std::string, T> > getMap(const char* name, std::map<std::string, T>& destination)
+	{
+		return getMap(name, destination, ValueParser<T>());
+	}
+
+	/**
+	 * Parse object with dynamic keys to std::map, using custom parser function object for values.
+	 * @see getMap
+	 */
+	template<typename T, typename F>
+	JsonParseContext< std::map<std::string, T> > getMap(const char* name,
+	                                                      std::map<std::string, T>& destination,
+	                                                      const F& parserFunc)
+	{
+		return getMapImpl(name, destination, parserFunc);
+	}
 
 	/**
 	 * Get a JsonParser object for a sub-object.
@@ -318,6 +733,7 @@ public:
 	 */
 	inline bool hasKey(const char* name)
 	{
+		ensureParsed();
 		return _jsonValue.hasKey(name);
 	}
 
@@ -342,7 +758,7 @@ public:
 	 * Returns true of the input is valid Json string depicting a Json object.
 	 * @return
 	 */
-	inline bool isValidJson(){return _jsonValue.isObject();}
+	inline bool isValidJson(){ensureParsed(); return _jsonValue.isObject();}
 
 	/**
 	 * Template method to do the parsing.
@@ -375,6 +791,19 @@ public:
 		}
 	}
 
+	/**
+	 * Function object that calls parseValueOrDataObject.
+	 * Default parser for get and getArray, allows the call to be inlined.
+	 */
+	template<typename T>
+	struct ValueParser
+	{
+		inline void operator()(const pbnjson::JValue& value, T& destination) const
+		{
+			parseValueOrDataObject(value, destination);
+		}
+	};
+
 	/**
 	 * Records an error.
 	 * Used internally by JsonParseContext
@@ -386,7 +815,65 @@ public:
 	 */
 	void recordError(const char* fieldName, const char* message);
 
+	/**
+	 * Records an error with error code and constant message.
+	 * Used internally by JsonParseContext. Not for public use.
+	 * @param fieldName
+	 * @param code
+	 * @param message error description. Not copied - must be a string literal.
+	 */
+	inline void recordError(const char* fieldName, ParseErrorCode code, const char* message)
+	{
+		recordError(ParseDiagnostic(code, fieldName, message));
+	}
+
+	/**
+	 * Records an error.
+	 * Not for public use.
+	 */
+	void recordError(ParseDiagnostic&& diagnostic);
+
 protected:
+	/**
+	 * Tag type to select the deferred parse constructor.
+	 */
+	struct DeferParse {};
+
+	/**
+	 * Initalize parser with json string that is parsed on first access to the data.
+	 * The string is not copied and must stay valid for the lifetime of the parser.
+	 */
+	JsonParser(const char* json, DeferParse)
+			: _jsonValue()
+			, _numberOfFields(0)
+			, _pendingJson(json)
+	{
+		if (json == nullptr)
+		{
+			_diagnostics.emplace_back(ParseErrorCode::MalformedJson, "", "Malformed JSON.");
+		}
+	}
+
+	/**
+	 * Parses the json data if the parse was deferred.
+	 * Called before any access to _jsonValue or _parseError.
+	 */
+	inline void ensureParsed() const
+	{
+		if (_pendingJson)
+		{
+			parsePending();
+		}
+	}
+
+	/**
+	 * @return true if the json data is not parsed yet.
+	 */
+	inline bool isParsePending() const
+	{
+		return _pendingJson != nullptr;
+	}
+
 	/**
 	 * Internal implementation of getting value.
 	 * Parses the json value in value and stores in destination.
@@ -398,16 +885,63 @@ protected:
 	 * @param parserFunc
 	 * @return
 	 */
-	template<typename T>
+	template<typename T, typename F>
 	JsonParseContext<T> getImpl(const char* name,
 	                            const pbnjson::JValue& value,
 	                            bool found,
 	                            T& destination,
-	                            const std::function<void(const pbnjson::JValue&, T&)>& parserFunc);
+	                            const F& parserFunc);
+
+	/**
+	 * Looks up the array for getNumericArray and getColumns.
+	 * @param name field name
+	 * @param array set to the array if present and not null.
+	 * @param valueRead set to true if the field is present.
+	 * @param isNull set to true if the field is null.
+	 * @return true if array holds a JSON array to decode.
+	 */
+	bool getArrayValue(const char* name, pbnjson::JValue& array, bool& valueRead, bool& isNull);
+
+	/**
+	 * Gets the characters of a string value without copying.
+	 * @return false if the value is not a string.
+	 */
+	static bool getStringData(const pbnjson::JValue& value, const char*& data, size_t& length);
+
+	/**
+	 * Internal implementation of getMap, for std::map and std::unordered_map.
+	 */
+	template<typename M, typename F>
+	JsonParseContext<M> getMapImpl(const char* name, M& destination, const F& parserFunc);
+
+	/**
+	 * Decodes a field of an array element and appends it to the column.
+	 * @throw JsonParseError if the field is missing or fails to parse.
+	 */
+	template<typename T>
+	static void decodeColumn(const pbnjson::JValue& element, JsonColumn<T>& column);
 
-	std::string _parseError;
-	pbnjson::JValue _jsonValue;
+	/**
+	 * Decodes all elements of array of numbers to destination.
+	 * Explicitly instantiated in jsonparser.cpp for the IsNumericArrayElement types.
+	 * Records at most one error for the whole array.
+	 * @param name field name, for error reporting.
+	 * @param array JSON array.
+	 * @param destination buffer of array.arraySize() elements.
+	 * @return true if all elements decoded.
+	 */
+	template<typename T>
+	bool decodeNumericArray(const char* name, const pbnjson::JValue& array, T* destination);
+
+	// Mutable because deferred parse may be triggered from const accessors.
+	mutable std::vector<ParseDiagnostic> _diagnostics;
+	mutable pbnjson::JValue _jsonValue;
 	ssize_t _numberOfFields;
+
+private:
+	void parsePending() const;
+
+	mutable const char* _pendingJson; // Json string to parse on first access, null when parsed.
 };
 
 /**
@@ -432,12 +966,14 @@ public:
 	                 const char* fieldName,
 	                 T& destination,
 	                 bool valueRead,
-	                 bool valueNull) :
+	                 bool valueNull,
+	                 bool failed = false) :
 			_parser(parser),
 			_fieldName(fieldName),
 			_destination(destination),
 			_valueRead(valueRead),
 			_valueNull(valueNull),
+			_failed(failed),
 			_optional(false),
 			_allowNull(false)
 	{}
@@ -448,6 +984,8 @@ public:
 			_fieldName(context._fieldName),
 			_destination(context._destination),
 			_valueRead(context._valueRead),
+			_valueNull(context._valueNull),
+			_failed(context._failed),
 			_optional(context._optional),
 			_allowNull(context._allowNull)
 	{
@@ -531,7 +1069,7 @@ public:
 	{
 		if (_valueRead && _destination < value)
 		{
-			_parser.recordError(_fieldName, "value less than minimum");
+			_parser.recordError(_fieldName, ParseErrorCode::OutOfRange, "value less than minimum");
 		}
 		return *this;
 	};
@@ -545,7 +1083,7 @@ public:
 	{
 		if (_valueRead && _destination > value)
 		{
-			_parser.recordError(_fieldName, "value greater than maximum");
+			_parser.recordError(_fieldName, ParseErrorCode::OutOfRange, "value greater than maximum");
 		}
 		return *this;
 	};
@@ -568,24 +1106,46 @@ public:
 				}
 			}
 
-			_parser.recordError(_fieldName, "value not in allowed list");
+			_parser.recordError(_fieldName, ParseErrorCode::NotAllowed, "value not in allowed list");
+		}
+		return *this;
+	};
+
+	/**
+	 * Specify a set of allowed string values as the keys of a StringMap.
+	 * Checked in constant time, for string destinations.
+	 * @param values - map with the allowed values as keys.
+	 * Set ParseError value not in allowed list.
+	 */
+	template<typename V, size_t N>
+	inline JsonParseContext& allowedValues(const StringMap<V, N>& values)
+	{
+		if (_valueRead && !values.contains(_destination))
+		{
+			_parser.recordError(_fieldName, ParseErrorCode::NotAllowed, "value not in allowed list");
 		}
 		return *this;
 	};
 
 private:
+	/* Records missing / null errors. Does nothing if the value was read, if decoding
+	 * it already recorded an error, or if called before. */
 	inline void finishParse() noexcept
 	{
-		if (!_valueRead)
+		if (_valueRead || _failed)
 		{
-			if (!_optional)
-			{
-				_parser.recordError(_fieldName, "mandatory but not present");
-			}
-			else if (_valueNull && !_allowNull)
-			{
-				_parser.recordError(_fieldName, "null value is not allowed");
-			}
+			return;
+		}
+
+		if (!_optional)
+		{
+			_parser.recordError(_fieldName, ParseErrorCode::Missing, "mandatory but not present");
+			_failed = true;
+		}
+		else if (_valueNull && !_allowNull)
+		{
+			_parser.recordError(_fieldName, ParseErrorCode::NullValue, "null value is not allowed");
+			_failed = true;
 		}
 	}
 
@@ -594,22 +1154,25 @@ private:
 	T& _destination;
 	bool _valueRead;
 	bool _valueNull;
+	bool _failed;
 	bool _optional;
 	bool _allowNull;
 };
 
 /* Template method implementations */
 
-template<typename T>
+template<typename T, typename F>
 JsonParseContext<T> JsonParser::get(const char* name,
                                     T& destination,
-                                    const std::function<void(const pbnjson::JValue&, T&)>& parserFunc)
+                                    const F& parserFunc)
 {
 	if (name == nullptr)
 	{
 		throw std::runtime_error("Internal error in JsonParseContext.get, field name is null");
 	}
 
+	ensureParsed();
+
 	bool hasKey = _jsonValue.hasKey(name);
 	pbnjson::JValue v; // = null
 	if (hasKey)
@@ -621,10 +1184,10 @@ JsonParseContext<T> JsonParser::get(const char* name,
 	return getImpl(name, v, hasKey, destination, parserFunc);
 }
 
-template<typename T>
+template<typename T, typename F>
 JsonParseContext<T> JsonParser::getFromString(const char* name,
                                               T& destination,
-                                              const std::function<void(const pbnjson::JValue&, T&)>& parserFunc)
+                                              const F& parserFunc)
 {
 	std::string stringValue;
 	bool valueSet;
@@ -640,12 +1203,12 @@ JsonParseContext<T> JsonParser::getFromString(const char* name,
 	return getImpl(name, value, valueSet, destination, parserFunc);
 }
 
-template<typename T>
+template<typename T, typename F>
 JsonParseContext<T> JsonParser::getImpl(const char* name,
                                         const pbnjson::JValue& value,
                                         bool hasKey,
                                         T& destination,
-                                        const std::function<void(const pbnjson::JValue&, T&)>& parserFunc)
+                                        const F& parserFunc)
 {
 	bool isNull = hasKey && value.isNull();
 
@@ -663,7 +1226,7 @@ JsonParseContext<T> JsonParser::getImpl(const char* name,
 	catch (const JsonParseError& e)
 	{
 		recordError(name, e.message.c_str());
-		return JsonParseContext<T>(*this, name, destination, false, isNull);
+		return JsonParseContext<T>(*this, name, destination, false, isNull, true);
 	}
 }
 
@@ -685,11 +1248,11 @@ JsonParseContext<T> JsonParser::getAndMap(const char* name, T& destination, cons
 		}
 		else
 		{
-			recordError(name, "value not in allowed values list");
+			recordError(name, ParseErrorCode::NotAllowed, "value not in allowed values list");
 		}
 	}
 
-	return JsonParseContext<T>(*this, name, destination, valueRead && found, false);
+	return JsonParseContext<T>(*this, name, destination, valueRead && found, false, valueRead && !found);
 }
 
 template<typename IT, typename T, size_t N>
@@ -714,11 +1277,11 @@ JsonParseContext<T> JsonParser::getAndMap(const char* name, T& destination, cons
 
 		if (!found)
 		{
-			recordError(name, "value not in allowed values list");
+			recordError(name, ParseErrorCode::NotAllowed, "value not in allowed values list");
 		}
 	}
 
-	return JsonParseContext<T>(*this, name, destination, valueRead && found, false);
+	return JsonParseContext<T>(*this, name, destination, valueRead && found, false, valueRead && !found);
 }
 
 template<typename IT, typename T>
@@ -743,17 +1306,48 @@ JsonParseContext<T> JsonParser::getAndMap(const char* name, T& destination, std:
 
 		if (!found)
 		{
-			recordError(name, "value not in allowed values list");
+			recordError(name, ParseErrorCode::NotAllowed, "value not in allowed values list");
 		}
 	}
 
-	return JsonParseContext<T>(*this, name, destination, valueRead && found, false);
+	return JsonParseContext<T>(*this, name, destination, valueRead && found, false, valueRead && !found);
 }
 
-template<typename T>
-JsonParseContext< std::vector<T> > JsonParser::getArray(const char* name,
-                                                        std::vector<T>& destination,
-                                                        const std::function<void(const pbnjson::JValue&,T&)>& parserFunc)
+template<typename T, size_t N>
+JsonParseContext<T> JsonParser::getAndMap(const char* name, T& destination, const StringMap<T, N>& valueMap)
+{
+	pbnjson::JValue value;
+	bool valueRead;
+	bool found = false;
+	get(name, value).optional().checkValueRead(valueRead);
+
+	if (valueRead)
+	{
+		const char* data;
+		size_t length;
+
+		if (!getStringData(value, data, length))
+		{
+			recordError(name, ParseErrorCode::InvalidValue, "not a string");
+		}
+		else if (const T* mapped = valueMap.find(data, length))
+		{
+			found = true;
+			destination = *mapped;
+		}
+		else
+		{
+			recordError(name, ParseErrorCode::NotAllowed, "value not in allowed values list");
+		}
+	}
+
+	return JsonParseContext<T>(*this, name, destination, valueRead && found, false, valueRead && !found);
+}
+
+template<typename T, typename F, typename A>
+JsonParseContext< std::vector<T, A> > JsonParser::getArray(const char* name,
+                                                           std::vector<T, A>& destination,
+                                                           const F& parserFunc)
 {
 	bool valueRead = false;
 	bool isNull = false;
@@ -769,8 +1363,8 @@ JsonParseContext< std::vector<T> > JsonParser::getArray(const char* name,
 		{
 			if (!array.isArray())
 			{
-				recordError(name, "array expected but did not get one.");
-				return JsonParseContext< std::vector<T> >(*this, name, destination, valueRead, isNull);
+				recordError(name, ParseErrorCode::InvalidValue, "array expected but did not get one.");
+				return JsonParseContext< std::vector<T, A> >(*this, name, destination, valueRead, isNull);
 			}
 
 			destination.clear();
@@ -784,7 +1378,280 @@ JsonParseContext< std::vector<T> > JsonParser::getArray(const char* name,
 		}
 	}
 
-	return JsonParseContext< std::vector<T> >(*this, name, destination, valueRead, isNull);
+	return JsonParseContext< std::vector<T, A> >(*this, name, destination, valueRead, isNull);
+}
+
+template<typename T, typename A>
+JsonParseContext< std::vector<T, A> > JsonParser::getNumericArray(const char* name, std::vector<T, A>& destination)
+{
+	static_assert(IsNumericArrayElement<T>::value,
+	              "getNumericArray supports int8_t to uint64_t, float and double only");
+
+	bool valueRead = false;
+	bool isNull = false;
+	bool failed = false;
+	pbnjson::JValue array;
+
+	if (getArrayValue(name, array, valueRead, isNull))
+	{
+		destination.resize((size_t)array.arraySize());
+		if (!decodeNumericArray(name, array, destination.data()))
+		{
+			destination.clear();
+			valueRead = false;
+			failed = true;
+		}
+	}
+
+	return JsonParseContext< std::vector<T, A> >(*this, name, destination, valueRead, isNull, failed);
+}
+
+template<typename T, size_t N>
+JsonParseContext< std::array<T, N> > JsonParser::getNumericArray(const char* name, std::array<T, N>& destination)
+{
+	static_assert(IsNumericArrayElement<T>::value,
+	              "getNumericArray supports int8_t to uint64_t, float and double only");
+
+	bool valueRead = false;
+	bool isNull = false;
+	bool failed = false;
+	pbnjson::JValue array;
+
+	if (getArrayValue(name, array, valueRead, isNull))
+	{
+		if ((size_t)array.arraySize() != N)
+		{
+			recordError(name, ("array of " + std::to_string(N) + " elements expected").c_str());
+			valueRead = false;
+			failed = true;
+		}
+		else if (!decodeNumericArray(name, array, destination.data()))
+		{
+			valueRead = false;
+			failed = true;
+		}
+	}
+
+	return JsonParseContext< std::array<T, N> >(*this, name, destination, valueRead, isNull, failed);
+}
+
+template<typename T>
+JsonParseContext<size_t> JsonParser::getNumericArray(const char* name, T* destination, size_t capacity, size_t& count)
+{
+	static_assert(IsNumericArrayElement<T>::value,
+	              "getNumericArray supports int8_t to uint64_t, float and double only");
+
+	bool valueRead = false;
+	bool isNull = false;
+	bool failed = false;
+	pbnjson::JValue array;
+
+	if (getArrayValue(name, array, valueRead, isNull))
+	{
+		count = (size_t)array.arraySize();
+		if (count > capacity)
+		{
+			recordError(name, ("array of at most " + std::to_string(capacity) + " elements expected").c_str());
+			valueRead = false;
+			failed = true;
+			count = 0;
+		}
+		else if (!decodeNumericArray(name, array, destination))
+		{
+			valueRead = false;
+			failed = true;
+			count = 0;
+		}
+	}
+
+	return JsonParseContext<size_t>(*this, name, count, valueRead, isNull, failed);
+}
+
+template<typename T>
+void JsonParser::decodeColumn(const pbnjson::JValue& element, JsonColumn<T>& column)
+{
+	if (!element.hasKey(column.name))
+	{
+		if (!column.optional)
+		{
+			throw JsonParseError("field '%s' missing", column.name.c_str());
+		}
+		column.destination.push_back(column.defaultValue);
+		return;
+	}
+
+	pbnjson::JValue value = element[column.name];
+	if (value.isNull())
+	{
+		if (!column.optional)
+		{
+			throw JsonParseError("field '%s' is null", column.name.c_str());
+		}
+		column.destination.push_back(column.defaultValue);
+		return;
+	}
+
+	T fieldValue;
+	try
+	{
+		ValueParser<T>()(value, fieldValue);
+	}
+	catch (const JsonParseError& e)
+	{
+		throw JsonParseError("field '%s' %s", column.name.c_str(), e.message.c_str());
+	}
+	column.destination.push_back(std::move(fieldValue));
+}
+
+template<typename... Columns>
+JsonParseContext<size_t> JsonParser::getColumns(const char* name, size_t& rowCount, Columns&&... columns)
+{
+	typedef int expand[];
+
+	bool valueRead = false;
+	bool isNull = false;
+	bool failed = false;
+	pbnjson::JValue array;
+
+	if (getArrayValue(name, array, valueRead, isNull))
+	{
+		const size_t size = (size_t)array.arraySize();
+		(void)expand{0, (columns.destination.clear(), columns.destination.reserve(size), 0)...};
+
+		size_t i = 0;
+		try
+		{
+			for (; i < size; i++)
+			{
+				pbnjson::JValue element = array[(int)i];
+				if (!element.isObject())
+				{
+					throw JsonParseError("not an object");
+				}
+				(void)expand{0, (decodeColumn(element, columns), 0)...};
+			}
+			rowCount = size;
+		}
+		catch (const JsonParseError& e)
+		{
+			recordError(ParseDiagnostic(ParseErrorCode::InvalidValue, name, "", (ssize_t)i, e.message));
+			(void)expand{0, (columns.destination.clear(), 0)...};
+			rowCount = 0;
+			valueRead = false;
+			failed = true;
+		}
+	}
+
+	return JsonParseContext<size_t>(*this, name, rowCount, valueRead, isNull, failed);
+}
+
+template<typename T, typename C, typename F>
+JsonParseContext<T> JsonParser::forEachElement(const char* name,
+                                               T& element,
+                                               const C& callback,
+                                               const F& parserFunc)
+{
+	bool valueRead = false;
+	bool isNull = false;
+	bool failed = false;
+	pbnjson::JValue array;
+
+	if (getArrayValue(name, array, valueRead, isNull))
+	{
+		for (ssize_t i = 0; i < array.arraySize(); i++)
+		{
+			bool elementRead = false;
+			getImpl(name, array[i], true, element, parserFunc).checkValueRead(elementRead);
+
+			if (!elementRead)
+			{
+				valueRead = false;
+				failed = true;
+				break;
+			}
+
+			if (!callback(element))
+			{
+				break;
+			}
+		}
+	}
+
+	return JsonParseContext<T>(*this, name, element, valueRead, isNull, failed);
+}
+
+/**
+ * Reserves space for the entries of an unordered map, no-op for other containers.
+ */
+template<typename T>
+inline void reserveMap(std::unordered_map<std::string, T>& map, size_t size)
+{
+	map.reserve(size);
+}
+
+template<typename M>
+inline void reserveMap(M&, size_t)
+{
+}
+
+template<typename M, typename F>
+JsonParseContext<M> JsonParser::getMapImpl(const char* name, M& destination, const F& parserFunc)
+{
+	bool valueRead = false;
+	bool isNull = false;
+
+	pbnjson::JValue object;
+	get(name, object).optional().checkValueRead(valueRead);
+
+	if (valueRead)
+	{
+		isNull = object.isNull();
+
+		if (!isNull)
+		{
+			if (!object.isObject())
+			{
+				recordError(name, ParseErrorCode::InvalidValue, "object expected but did not get one.");
+				return JsonParseContext<M>(*this, name, destination, valueRead, isNull);
+			}
+
+			reserveMap(destination, (size_t)object.objectSize());
+
+			std::string key;
+			std::string fieldName;
+			for (const pbnjson::JValue::KeyValue& member : object.children())
+			{
+				member.first.asString(key);
+
+				auto iter = destination.find(key);
+				if (iter == destination.end())
+				{
+					iter = destination.emplace(key, typename M::mapped_type()).first;
+				}
+
+				fieldName.assign(name).append(".").append(key);
+				getImpl(fieldName.c_str(), member.second, true, iter->second, parserFunc);
+			}
+
+			// All keys of the object are in destination now, remove the rest.
+			if (destination.size() != (size_t)object.objectSize())
+			{
+				for (auto iter = destination.begin(); iter != destination.end();)
+				{
+					if (object.hasKey(iter->first))
+					{
+						++iter;
+					}
+					else
+					{
+						iter = destination.erase(iter);
+					}
+				}
+			}
+		}
+	}
+
+	return JsonParseContext<M>(*this, name, destination, valueRead, isNull);
 }
 
 } // Namespace LSHelpers
@@ -21,7 +21,14 @@
 #include <algorithm>
 #include <luna-service2/lunaservice.hpp>
 
+#include "arena.hpp"
 #include "jsonparser.hpp"
+#include "jsonwriter.hpp"
+#include "metrics.hpp"
+#include "payloadoffload.hpp"
+#include "payloadcache.hpp"
+#include "tracing.hpp"
+#include "validationpolicy.hpp"
 
 namespace LSHelpers {
 
@@ -30,6 +37,8 @@ namespace LSHelpers {
  * Throw within a handler method to return early and send error response to caller.
  *
  * Doubles as JValue and can be returned from handler methods.
+ * Returning is much cheaper than throwing - prefer it for errors caused by the caller,
+ * like invalid parameters, that can be frequent.
  *
  * @see @ref LSHelpers::JsonRequest
  */
@@ -79,6 +88,25 @@ public:
  *	return true;        // Equivalent to return JObject{{"returnValue":true}}
  * }
  *
+ * // Without exceptions
+ * pbnjson::JValue MyClass::fastHandlerMethod(JsonRequest& request)
+ * {
+ *	std::string contextName;
+ *	request.get("context", contextName);
+ *
+ *	if (!request.finishParse())
+ *	{
+ *	  return request.getErrorResponse();
+ *	}
+ *
+ *	if (!hasContext(contextName))
+ *	{
+ *	  return ErrorResponse(105, "Context not found");
+ *	}
+ *
+ *	return true;
+ * }
+ *
  * Context& getContextOrThrow(const std::string& contextName)
  * {
  * 	if (!hasContext(contextName))
@@ -114,11 +142,21 @@ public:
 	 * @param msg the luna message to handle.
 	 * @param handler handler method to call.
 	 * @param schema schema to use for validation (optional).
+	 * @param cache cache to look up the parsed payload from (optional).
+	 * @param useArena if true, the request object is allocated from a per request arena,
+	 *                 reused between requests on the same thread. See getArena.
+	 * @param policy decides if the request is validated against the schema and counts the result (optional).
+	 *               If not set, all requests are validated.
+	 * @param offload serializes large responses on a worker pool (optional), see PayloadOffload.
 	 * @return true if the call was handled. False if an unknown exception was thrown.
 	 */
 	static bool handleLunaCall(LSMessage* msg,
 	                           const Handler& handler,
-	                           const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema());
+	                           const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema(),
+	                           PayloadCache* cache = nullptr,
+	                           bool useArena = false,
+	                           ValidationPolicy* policy = nullptr,
+	                           const PayloadOffload* offload = nullptr);
 
 	~JsonRequest();
 
@@ -154,21 +192,155 @@ public:
 	 */
 	DeferredResponseFunction defer();
 
+	/**
+	 * Get error response for the parse error, to return from the handler without throwing.
+	 * Same response as sent when finishParseOrThrow throws.
+	 * @see finishParse
+	 * @return error response with the first parse error.
+	 */
+	ErrorResponse getErrorResponse() const;
+
 	/**
 	 * @return underlying message.
 	 */
 	inline const LS::Message getMessage() const { return mMessage; }
 
+	/**
+	 * Get memory arena for temporaries of this request.
+	 * The arena is released in bulk when the request is destroyed - after the response
+	 * is sent, or for deferred requests when all copies of the response function are gone.
+	 * Memory allocated from the arena must not be used after that.
+	 *
+	 * Example:
+	 * @code
+	 * ArenaString name{ArenaAllocator<char>(request.getArena())};
+	 * ArenaVector<int32_t> ids{ArenaAllocator<int32_t>(request.getArena())};
+	 * request.get("name", name);
+	 * request.getArray("ids", ids);
+	 * @endcode
+	 *
+	 * @return the arena, taken from the per thread cache on first use.
+	 */
+	Arena& getArena();
+
+	/**
+	 * Send a pre-serialized response, built without a JValue tree.
+	 * The value returned from the handler is ignored once this is called.
+	 * Can be called more than once for deferred requests.
+	 *
+	 * Example:
+	 * @code
+	 * JValue handler(JsonRequest& request)
+	 * {
+	 *     mWriter.clear();
+	 *     mWriter.beginObject().field("returnValue", true).field("count", mCount).endObject();
+	 *     request.respond(mWriter);
+	 *     return true; // Ignored.
+	 * }
+	 * @endcode
+	 *
+	 * @param response response object.
+	 */
+	void respond(const JsonWriter& response);
+
+	/**
+	 * Send a response object derived from JsonWritable, like JsonStruct.
+	 * The object is written to JSON directly, without a JValue tree.
+	 * @see respond(const JsonWriter&)
+	 * @param response response object.
+	 */
+	template<typename T>
+	typename std::enable_if<std::is_base_of<JsonWritable, T>::value>::type respond(const T& response)
+	{
+		JsonWriter& writer = getResponseWriter();
+		response.toJson(writer);
+		respond(writer);
+	}
+
+	/**
+	 * Get the trace context of the request, to continue the trace from deferred work with TraceScope.
+	 * @return the request span, not traced if tracing is not started.
+	 */
+	inline TraceContext getTraceContext() const
+	{
+		return TraceContext{mTrace.traceId, mTrace.spanId};
+	}
+
+	/**
+	 * @return true if the response is deferred.
+	 */
+	inline bool isDeferred() const { return mDeferred; }
+
+	/**
+	 * Set the main loop to send responses from, for requests handled on the calling thread.
+	 * Used when handlers run on worker threads - the responses, including the ones sent later from
+	 * deferred response functions, are passed to the main loop and sent from there.
+	 * Responses sent from the main loop thread itself are sent directly.
+	 * @param context main context of the service handle, null to send directly.
+	 */
+	static void setThreadResponseContext(GMainContext* context);
+
 private:
+	friend class ServicePoint;
+
 	JsonRequest(const LS::Message& message, const pbnjson::JValue params);
 
+	// Per request settings of dispatch.
+	struct DispatchOptions
+	{
+		bool useArena = false;
+		const PayloadOffload* offload = nullptr; // Serialize large responses on a pool.
+		std::function<void()> onComplete; // Called once, on the first response or when the request is destroyed.
+		std::shared_ptr<MethodMetrics> metrics; // Record handler and response metrics.
+		uint64_t startUs = 0; // Arrival time, for the time to respond.
+		Span trace = Span(); // Request span, trace id 0 if not traced.
+	};
+
+	// Parse and validate the payload. Responds with the error and returns invalid value if failed.
+	// Schema failures of a monitoring policy are counted and logged, the unvalidated value is returned.
+	// errorCode is set to the error code of the response, if failed.
+	// trace is set to the request span, if tracing is started.
+	static pbnjson::JValue parsePayload(LS::Message& message,
+	                                    const pbnjson::JSchema& schema,
+	                                    PayloadCache* cache,
+	                                    ValidationPolicy* policy,
+	                                    int32_t* errorCode = nullptr,
+	                                    Span* trace = nullptr);
+
+	// Call the handler with the parsed payload and respond with the result.
+	static bool dispatch(LS::Message& message,
+	                     const pbnjson::JValue& value,
+	                     const Handler& handler,
+	                     const DispatchOptions& options);
+
 	// Send response to caller.
 	void respond(const pbnjson::JValue& response);
+	void respond(const char* payload);
+	bool respondOffloaded(const pbnjson::JValue& response, bool large);
+	void complete();
+	void recordResponse(const char* payload); // Null payload if serialized later.
+	void finishTrace();
+
+	// Cleared writer, reused between responses on the same thread.
+	static JsonWriter& getResponseWriter();
+
+	// Send response now, or pass it to the response context.
+	// Queued responses are always passed to the context, to keep them behind earlier offloaded responses.
+	static void sendResponse(LS::Message& message, const char* payload, GMainContext* context, bool queued = false);
 
 	LS::Message mMessage;
+	Arena::Ptr mArena; // Null until used, or if the request is allocated from it.
+	GMainContext* mResponseContext; // Main loop to send responses from, null to send directly.
+	PayloadOffload mOffload; // Where to serialize large responses.
+	std::unique_ptr<OrderedOffload> mOffloaded; // Set once a response is offloaded, keeps the responses in order.
+	std::function<void()> mOnComplete; // Called on the first response.
+	std::shared_ptr<MethodMetrics> mMetrics; // Null if metrics are not enabled.
+	uint64_t mStartUs; // Dispatch time, reset once the first response is recorded.
+	Span mTrace; // Request span, start time reset once recorded.
 	std::weak_ptr<JsonRequest> mWeakPtr; // Weak pointer to self, for use in defer
 	bool mDeferred; // Response deferred.
 	bool mResponded; // If at least one response is sent back.
+	bool mRespondedDirectly; // Response sent from the handler, the returned value is not used.
 };
 
 } // namespace LSHelpers;
@@ -19,6 +19,7 @@
 #include <luna-service2/lunaservice.hpp>
 
 #include "jsonparser.hpp"
+#include "payloadcache.hpp"
 
 namespace LSHelpers {
 
@@ -84,17 +85,53 @@ public:
 	 */
 	typedef std::function<void (JsonResponse& response)> Handler;
 
+	/**
+	 * Copy constructor. Parses the payload of the original first,
+	 * as a deferred payload is only valid while the handler runs.
+	 */
+	JsonResponse(const JsonResponse& other)
+			: JsonParser((other.ensureParsed(), other))
+			, mMessage(other.mMessage)
+			, mStatus(other.mStatus)
+	{}
+
+	JsonResponse& operator=(const JsonResponse& other)
+	{
+		other.ensureParsed();
+		JsonParser::operator=(other);
+		mMessage = other.mMessage;
+		mStatus = other.mStatus;
+		return *this;
+	}
+
+	/**
+	 * How a call reply ended, for call metrics.
+	 */
+	enum class Outcome : uint8_t
+	{
+		Success,
+		Error, // returnValue false.
+		HubError,
+		ParseError // Not valid JSON or does not match the schema.
+	};
+
 	/**
 	 * Handler method - parses the message and calls handler.
 	 * Catches any exceptions and logs them.
 	 * @param msg the luna message to handle
 	 * @param handler handler function to call.
 	 * @param schema schema to use for validation (optional).
+	 * @param cache cache to look up the parsed payload from (optional).
+	 *              Only payloads small enough to be cached are parsed before calling the handler.
+	 * @param outcome if not null, set to the outcome of the reply after the handler returns.
+	 *                Uses the quick scan of isSuccess if the handler did not parse the payload.
 	 * @return true
 	 */
 	static bool handleLunaResponse(LSMessage* msg,
 	                               const Handler& handler,
-	                               const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema()) noexcept;
+	                               const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema(),
+	                               PayloadCache* cache = nullptr,
+	                               Outcome* outcome = nullptr) noexcept;
 
 	/**
 	 * @return the token of the call that this response replies to.
@@ -104,27 +141,49 @@ public:
 
 	/**
 	 * Check if the response is successful (contains returnValue:true)
+	 * A response without returnValue is successful if it's valid JSON.
+	 * Tries to get the result from a quick scan of the payload, so checking
+	 * the result does not require the payload to be parsed.
 	 * @return true if successful, false if not.
 	 */
-	inline bool isSuccess(){return mSuccess;}
+	bool isSuccess();
 
 	/**
 	 * Calls finishParse and checks if finishParse or the call itself has an error.
 	 */
-	inline bool hasErrors(){return !mSuccess || !JsonParser::finishParse(false);};
+	inline bool hasErrors(){return !isSuccess() || !JsonParser::finishParse(false);};
 
 private:
+	enum class Status : uint8_t
+	{
+		Unknown, // Not determined yet.
+		Success,
+		Failure
+	};
+
 	/**
-	 * Initalize luna request with specified message.
+	 * Initalize luna response with specified message and parsed payload.
 	 */
-	JsonResponse(LSMessage* message, pbnjson::JValue value, bool isSuccess)
+	JsonResponse(LSMessage* message, pbnjson::JValue value, bool isValid)
 			: JsonParser(value)
 			, mMessage(message)
-			, mSuccess(isSuccess)
+			, mStatus(isValid ? Status::Unknown : Status::Failure)
 	{}
 
+	/**
+	 * Initalize luna response with specified message.
+	 * The payload is parsed on first access.
+	 */
+	explicit JsonResponse(LSMessage* message)
+			: JsonParser(LSMessageGetPayload(message), DeferParse())
+			, mMessage(message)
+			, mStatus(Status::Unknown)
+	{}
+
+	Outcome getOutcome();
+
 	LSMessage* mMessage;
-	bool mSuccess;
+	Status mStatus;
 };
 
 } // namespace LSHelpers;
@@ -0,0 +1,235 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <string>
+#include <pbnjson.hpp>
+
+#include "jsonparser.hpp"
+#include "jsonwriter.hpp"
+#include "stringmap.hpp"
+
+namespace LSHelpers {
+
+/**
+ * @brief Field options returned by JsonFieldWriter.
+ * Accepts the same options as JsonParseContext, so that one field description serves both
+ * parsing and writing. The options only affect parsing and are ignored when writing.
+ */
+class JsonFieldOptions
+{
+public:
+	inline JsonFieldOptions& optional(bool = true) { return *this; }
+	inline JsonFieldOptions& allowNull(bool = true) { return *this; }
+	inline JsonFieldOptions& checkValueRead(bool&) { return *this; }
+
+	template<typename V>
+	inline JsonFieldOptions& defaultValue(const V&) { return *this; }
+
+	template<typename V>
+	inline JsonFieldOptions& min(const V&) { return *this; }
+
+	template<typename V>
+	inline JsonFieldOptions& max(const V&) { return *this; }
+
+	template<typename V>
+	inline JsonFieldOptions& allowedValues(std::initializer_list<V>) { return *this; }
+
+	template<typename V, size_t N>
+	inline JsonFieldOptions& allowedValues(const StringMap<V, N>&) { return *this; }
+};
+
+/**
+ * @brief Field visitor that reads the fields with JsonParser.
+ * @see JsonStruct
+ */
+class JsonFieldReader
+{
+public:
+	explicit JsonFieldReader(JsonParser& parser)
+			: mParser(parser)
+	{}
+
+	template<typename T>
+	inline JsonParseContext<T> operator()(const char* name, T& field)
+	{
+		return mParser.get(name, field);
+	}
+
+	template<typename T, typename A>
+	inline JsonParseContext< std::vector<T, A> > operator()(const char* name, std::vector<T, A>& field)
+	{
+		return mParser.getArray(name, field);
+	}
+
+	template<typename T>
+	inline JsonParseContext< std::map<std::string, T> > operator()(const char* name, std::map<std::string, T>& field)
+	{
+		return mParser.getMap(name, field);
+	}
+
+	template<typename T>
+	inline JsonParseContext< std::unordered_map<std::string, T> > operator()(const char* name,
+	                                                                         std::unordered_map<std::string, T>& field)
+	{
+		return mParser.getMap(name, field);
+	}
+
+	/**
+	 * Enum-like field, stored in JSON as one of the map keys.
+	 */
+	template<typename T, size_t N>
+	inline JsonParseContext<T> mapped(const char* name, T& field, const StringMap<T, N>& values)
+	{
+		return mParser.getAndMap(name, field, values);
+	}
+
+private:
+	JsonParser& mParser;
+};
+
+/**
+ * @brief Field visitor that writes the fields with JsonWriter.
+ * @see JsonStruct
+ */
+class JsonFieldWriter
+{
+public:
+	explicit JsonFieldWriter(JsonWriter& writer)
+			: mWriter(writer)
+	{}
+
+	template<typename T>
+	inline JsonFieldOptions operator()(const char* name, const T& field)
+	{
+		mWriter.field(name, field);
+		return JsonFieldOptions();
+	}
+
+	/**
+	 * Enum-like field, written as the map key of the value. Values not in the map are written as null.
+	 */
+	template<typename T, size_t N>
+	inline JsonFieldOptions mapped(const char* name, const T& field, const StringMap<T, N>& values)
+	{
+		mWriter.field(name, values.findKey(field));
+		return JsonFieldOptions();
+	}
+
+private:
+	JsonWriter& mWriter;
+};
+
+/**
+ * @brief Base class for plain structs that are both parsed from and written to JSON,
+ * from a single description of the fields.
+ *
+ * The derived class implements a jsonFields template method that passes each field to the visitor.
+ * For parsing the visitor is a JsonFieldReader and the call returns JsonParseContext, so all the parse
+ * options are available. For writing the visitor is a JsonFieldWriter - the fields are written straight
+ * to a JsonWriter buffer, in the order of the description, and the parse options are ignored.
+ * Both visitors are resolved at compile time.
+ *
+ * Fields can be of any type supported by both JsonParser::get and JsonWriter::value, vectors
+ * (parsed with getArray), maps with string keys (parsed with getMap) and other JsonStructs.
+ *
+ * Structs can be generated from a JSON schema with files/scripts/ls2-helpers-schemagen.py,
+ * see ls2_helpers_generate_schema in files/cmake/LS2HelpersSchemaGen.cmake.
+ *
+ * The struct can be used wherever a JsonDataObject is accepted, passed to JsonWriter::value,
+ * returned from a handler registered with ServicePoint::registerMethod, sent with JsonRequest::respond
+ * or posted with SubscriptionPoint::post.
+ *
+ * Example:
+ * @code
+ * struct AppInfo : public JsonStruct<AppInfo>
+ * {
+ *     std::string id;
+ *     int64_t size;
+ *     bool visible;
+ *     std::vector<std::string> tags;
+ *
+ *     template<typename V>
+ *     void jsonFields(V& field)
+ *     {
+ *         field("id", id);
+ *         field("size", size).min(0);
+ *         field("visible", visible).optional().defaultValue(true);
+ *         field("tags", tags).optional();
+ *     }
+ * };
+ *
+ * AppInfo app;
+ * request.get("app", app);
+ *
+ * JsonWriter writer;
+ * writer.value(app);
+ * @endcode
+ *
+ * @tparam T the derived class.
+ * @tparam Strict if true, parsing fails on fields not in the description.
+ */
+template<typename T, bool Strict = false>
+class JsonStruct : public JsonDataObject, public JsonWritable
+{
+public:
+	/**
+	 * Parses the fields from the root object of the parser, without exceptions.
+	 * Used to decode a whole request into the struct.
+	 * @param parser parser to read from, for example JsonRequest.
+	 * @return true if successful. On failure the errors are recorded in the parser.
+	 */
+	bool readFields(JsonParser& parser)
+	{
+		JsonFieldReader reader(parser);
+		static_cast<T*>(this)->jsonFields(reader);
+		return parser.finishParse(Strict);
+	}
+
+	void parseFromJson(const pbnjson::JValue& value) override
+	{
+		JsonParser parser(value);
+		JsonFieldReader reader(parser);
+		static_cast<T*>(this)->jsonFields(reader);
+		parser.finishParseOrThrow(Strict);
+	}
+
+	/**
+	 * Writes the struct as JSON object.
+	 * @param writer writer to write to.
+	 */
+	void toJson(JsonWriter& writer) const
+	{
+		JsonFieldWriter fieldWriter(writer);
+		writer.beginObject();
+		// The description is shared with parsing and is not const, writing does not modify the fields.
+		const_cast<T*>(static_cast<const T*>(this))->jsonFields(fieldWriter);
+		writer.endObject();
+	}
+
+	/**
+	 * @return the struct serialized to JSON string.
+	 */
+	std::string toJsonString() const
+	{
+		JsonWriter writer;
+		toJson(writer);
+		return writer.str();
+	}
+};
+
+} // namespace LSHelpers;
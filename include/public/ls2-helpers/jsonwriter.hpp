@@ -0,0 +1,239 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <pbnjson.hpp>
+
+#include "stringref.hpp"
+
+namespace LSHelpers {
+
+/**
+ * @brief Tag base class of objects that write themselves with JsonWriter.
+ * Derived classes implement toJson(JsonWriter& writer) const. See JsonStruct.
+ */
+class JsonWritable
+{
+};
+
+/**
+ * @brief Streaming JSON builder. Writes JSON text directly into a reusable buffer,
+ * without building a pbnjson::JValue tree first.
+ * Use for large or frequent responses, subscription posts, signals and call parameters -
+ * JsonRequest::respond, SubscriptionPoint::post, ServicePoint::callOneReply, callMultiReply
+ * and sendSignal accept the writer as a pre-serialized payload.
+ *
+ * Strings are escaped as required by JSON. Integers are written exactly, floating point values
+ * with the shortest precision that reads back to the same value. NaN and infinity have
+ * no JSON representation and are written as null.
+ *
+ * The writer does not validate the structure - keys must be written only inside objects,
+ * each key must be followed by exactly one value and all objects and arrays must be closed.
+ *
+ * Keep the writer around and call clear() between payloads to reuse the buffer.
+ *
+ * Multithreading: Not thread safe, use one writer per thread.
+ *
+ * Example:
+ * @code
+ * JsonWriter writer;
+ * writer.beginObject()
+ *     .field("returnValue", true)
+ *     .key("apps").beginArray();
+ * for (const auto& app : apps)
+ * {
+ *     writer.beginObject()
+ *         .field("id", app.id)
+ *         .field("size", app.size)
+ *         .endObject();
+ * }
+ * writer.endArray().endObject();
+ *
+ * request.respond(writer);
+ * @endcode
+ */
+class JsonWriter
+{
+public:
+	/**
+	 * @param capacity initial buffer capacity in bytes.
+	 */
+	explicit JsonWriter(size_t capacity = 256);
+
+	/**
+	 * Clears the content, keeping the buffer capacity.
+	 */
+	void clear();
+
+	/**
+	 * Reserves buffer space.
+	 * @param capacity capacity in bytes.
+	 */
+	inline void reserve(size_t capacity) { mBuffer.reserve(capacity); }
+
+	JsonWriter& beginObject();
+	JsonWriter& endObject();
+	JsonWriter& beginArray();
+	JsonWriter& endArray();
+
+	/**
+	 * Writes object key. Must be followed by a value.
+	 */
+	JsonWriter& key(const StringRef& name);
+
+	JsonWriter& value(bool value);
+	JsonWriter& value(const char* value);
+	JsonWriter& value(const std::string& value);
+	JsonWriter& value(const StringRef& value);
+	JsonWriter& value(double value);
+
+	inline JsonWriter& value(float value)
+	{
+		return this->value(static_cast<double>(value));
+	}
+
+	template<typename T>
+	inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, JsonWriter&>::type
+	value(T value)
+	{
+		return writeInt(static_cast<int64_t>(value));
+	}
+
+	template<typename T>
+	inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, JsonWriter&>::type
+	value(T value)
+	{
+		return writeUInt(static_cast<uint64_t>(value));
+	}
+
+	/**
+	 * Writes an object derived from JsonWritable, for example JsonStruct.
+	 */
+	template<typename T>
+	inline typename std::enable_if<std::is_base_of<JsonWritable, T>::value, JsonWriter&>::type
+	value(const T& object)
+	{
+		object.toJson(*this);
+		return *this;
+	}
+
+	/**
+	 * Writes a vector as JSON array.
+	 */
+	template<typename T, typename A>
+	JsonWriter& value(const std::vector<T, A>& values)
+	{
+		beginArray();
+		for (const auto& element : values)
+		{
+			value(element);
+		}
+		return endArray();
+	}
+
+	/**
+	 * Writes a map as JSON object.
+	 */
+	template<typename T>
+	JsonWriter& value(const std::map<std::string, T>& values)
+	{
+		return writeMap(values);
+	}
+
+	/** @see value(const std::map<std::string, T>&) */
+	template<typename T>
+	JsonWriter& value(const std::unordered_map<std::string, T>& values)
+	{
+		return writeMap(values);
+	}
+
+	/**
+	 * Writes a JValue. Serializes the value with pbnjson, use for small parts of the payload only.
+	 */
+	JsonWriter& value(const pbnjson::JValue& value);
+
+	/**
+	 * Writes null.
+	 */
+	JsonWriter& null();
+
+	/**
+	 * Writes already serialized JSON value as is.
+	 * @param json valid JSON text.
+	 */
+	JsonWriter& raw(const StringRef& json);
+
+	/**
+	 * Writes key and value. Same as key(name).value(value).
+	 */
+	template<typename T>
+	inline JsonWriter& field(const StringRef& name, const T& value)
+	{
+		return key(name).value(value);
+	}
+
+	/**
+	 * @return the JSON text, valid until the writer is modified.
+	 */
+	inline const char* c_str() const { return mBuffer.c_str(); }
+
+	/**
+	 * @return the JSON text.
+	 */
+	inline const std::string& str() const { return mBuffer; }
+
+	inline size_t size() const { return mBuffer.size(); }
+	inline bool empty() const { return mBuffer.empty(); }
+
+private:
+	inline void separate()
+	{
+		if (mNeedComma)
+		{
+			mBuffer.push_back(',');
+		}
+		mNeedComma = true;
+	}
+
+	void writeString(const char* str, size_t length);
+
+	template<typename M>
+	JsonWriter& writeMap(const M& values)
+	{
+		beginObject();
+		for (const auto& item : values)
+		{
+			key(item.first).value(item.second);
+		}
+		return endObject();
+	}
+
+	JsonWriter& writeInt(int64_t value);
+	JsonWriter& writeUInt(uint64_t value);
+	void appendDigits(uint64_t value);
+
+	std::string mBuffer;
+	bool mNeedComma; // Next value or key follows a previous one at the same level.
+};
+
+} // namespace LSHelpers;
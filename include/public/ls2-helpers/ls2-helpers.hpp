@@ -20,6 +20,18 @@
 #include <luna-service2/lunaservice.h>
 
 #include "jsonparser.hpp"
+#include "jsonstruct.hpp"
+#include "jsonwriter.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include "admissioncontrol.hpp"
+#include "arena.hpp"
+#include "payloadcache.hpp"
+#include "stringmap.hpp"
+#include "stringref.hpp"
 #include "servicepoint.hpp"
 #include "subscriptionpoint.hpp"
+#include "validationpolicy.hpp"
+#include "payloadoffload.hpp"
+#include "workerpool.hpp"
 #include "persistentsubscription.hpp"
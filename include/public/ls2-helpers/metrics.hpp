@@ -0,0 +1,183 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <pbnjson.hpp>
+
+namespace LSHelpers {
+
+/**
+ * @brief Histogram of non negative integer values with bounded relative error, like HdrHistogram.
+ *
+ * Each power of two range is split into 8 linear sub buckets, so a recorded value is reported
+ * within 12.5% of its actual value. Values up to 2^36 are tracked, larger ones are clamped.
+ * Recording is lock free and does not allocate.
+ *
+ * Multithreading: This class is thread safe. Values read while recording may be slightly inconsistent.
+ */
+class Histogram
+{
+public:
+	static const uint32_t SUB_BUCKET_BITS = 3;
+	static const uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const uint32_t MAX_VALUE_BITS = 36;
+	static const uint32_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	Histogram();
+
+	/** Not copyable. */
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	/**
+	 * Record a value.
+	 */
+	void record(uint64_t value);
+
+	/**
+	 * @return number of recorded values.
+	 */
+	uint64_t getCount() const;
+
+	/**
+	 * @return largest recorded value.
+	 */
+	uint64_t getMax() const;
+
+	/**
+	 * @return mean of recorded values, 0 if none.
+	 */
+	double getMean() const;
+
+	/**
+	 * @param percentile percentile, 0 to 100.
+	 * @return upper bound of the bucket containing the percentile, 0 if nothing recorded.
+	 */
+	uint64_t getPercentile(double percentile) const;
+
+	/**
+	 * @return summary object: count, mean, p50, p90, p99 and max.
+	 */
+	pbnjson::JValue toJson() const;
+
+	/**
+	 * @return bucket of a value.
+	 */
+	static uint32_t bucketIndex(uint64_t value);
+
+	/**
+	 * @return largest value of a bucket.
+	 */
+	static uint64_t bucketLimit(uint32_t index);
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKETS> mBuckets;
+	std::atomic<uint64_t> mCount;
+	std::atomic<uint64_t> mSum;
+	std::atomic<uint64_t> mMax;
+};
+
+/**
+ * @brief Counters and histograms of one method. Enable with ServicePoint::enableMetrics.
+ *
+ * Times are in microseconds, sizes in bytes:
+ * - parseUs - parsing and validating the payload.
+ * - handlerUs - running the handler, not including deferred work.
+ * - respondUs - from arrival to the first response, admission and executor queue waits and
+ *   deferred requests included.
+ * - requestBytes, responseBytes - payload sizes, all responses of a request are counted.
+ *
+ * Errors are counted by error code - for error responses returned or thrown from handlers,
+ * parse and validation failures, and requests rejected by admission control. Responses sent
+ * with JsonWriter are not inspected.
+ *
+ * Multithreading: This class is thread safe.
+ */
+struct MethodMetrics
+{
+	/**
+	 * @return monotonic time in microseconds.
+	 */
+	static uint64_t nowUs();
+
+	/**
+	 * Count an error response.
+	 * @param code error code, -1 if the response has none.
+	 */
+	void recordError(int32_t code);
+
+	/**
+	 * @return number of error responses by error code.
+	 */
+	std::map<int32_t, uint64_t> getErrors() const;
+
+	/**
+	 * @return metrics as JSON object.
+	 */
+	pbnjson::JValue toJson() const;
+
+	std::atomic<uint64_t> calls{0};
+	Histogram parseUs;
+	Histogram handlerUs;
+	Histogram respondUs;
+	Histogram requestBytes;
+	Histogram responseBytes;
+
+private:
+	mutable std::mutex mErrorsMutex;
+	std::map<int32_t, uint64_t> mErrors;
+};
+
+/**
+ * @brief Counters and histograms of calls to one URI. Enable with ServicePoint::enableCallMetrics.
+ *
+ * - calls - calls sent, with or without a handler.
+ * - replies - replies handled, including hub errors and multi reply updates.
+ * - errors, hubErrors, parseErrors - replies by outcome, see JsonResponse::Outcome.
+ * - cancelled - calls cancelled with ServicePoint::cancelCall before they completed.
+ * - slow - calls with round trip time above the slow call threshold.
+ * - roundTripUs - microseconds from sending the call to the first reply.
+ * - updateIntervalUs - microseconds between the replies of multi reply calls.
+ *
+ * Replies of calls without a handler are not seen.
+ *
+ * Multithreading: This struct is thread safe.
+ */
+struct CallMetrics
+{
+	/**
+	 * @return metrics as JSON object.
+	 */
+	pbnjson::JValue toJson() const;
+
+	std::atomic<uint64_t> calls{0};
+	std::atomic<uint64_t> replies{0};
+	std::atomic<uint64_t> errors{0};
+	std::atomic<uint64_t> hubErrors{0};
+	std::atomic<uint64_t> parseErrors{0};
+	std::atomic<uint64_t> cancelled{0};
+	std::atomic<uint64_t> slow{0};
+	Histogram roundTripUs;
+	Histogram updateIntervalUs;
+};
+
+} // namespace LSHelpers;
@@ -0,0 +1,112 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pbnjson.hpp>
+
+namespace LSHelpers {
+
+/**
+ * @brief Bounded cache of parsed JSON payloads.
+ * Maps payload bytes and schema to the parsed JValue, so repeated identical
+ * payloads (like {"subscribe":true}) skip the parser and schema validation.
+ *
+ * The cache is direct mapped - each payload hash maps to one slot and a new payload
+ * replaces the previous one in the slot. Only payloads up to maxPayloadSize bytes are cached.
+ *
+ * Cached values are shared between all users of the same payload. The values must be treated
+ * as immutable - use JValue::duplicate() before modifying them.
+ * The schema is identified by address, so it must outlive the cache entries.
+ *
+ * Multithreading: This class is thread safe.
+ *
+ * Example:
+ * @code
+ *  PayloadCache cache;
+ *  pbnjson::JValue value = cache.parse(message.getPayload(), schema);
+ *  if (!value.isValid())
+ *  {
+ *    // Failed to parse or validate.
+ *  }
+ * @endcode
+ */
+class PayloadCache
+{
+public:
+	/**
+	 * @param capacity number of cache slots.
+	 * @param maxPayloadSize the maximum size of payloads to cache, in bytes.
+	 */
+	explicit PayloadCache(size_t capacity = 64, size_t maxPayloadSize = 256);
+
+	/** Not copyable. */
+	PayloadCache(const PayloadCache&) = delete;
+	PayloadCache& operator=(const PayloadCache&) = delete;
+
+	/**
+	 * Parse and validate the payload, equivalent to JDomParser::fromString(payload, schema).
+	 * Returns the cached value if the same payload was parsed with the same schema before.
+	 * @param payload json string to parse.
+	 * @param schema schema to validate against.
+	 * @return parsed value. Invalid value if failed to parse or validate. Failures are not cached.
+	 */
+	pbnjson::JValue parse(const char* payload, const pbnjson::JSchema& schema);
+
+	/**
+	 * Check if a payload is small enough to be cached.
+	 * @param payload json string.
+	 * @return true if the payload is cached by parse().
+	 */
+	bool isCacheable(const char* payload) const;
+
+	/**
+	 * @return number of parse calls served from the cache.
+	 */
+	uint64_t getHits() const;
+
+	/**
+	 * @return number of parse calls for cacheable payloads that needed parsing.
+	 */
+	uint64_t getMisses() const;
+
+	/**
+	 * Drop all cached values. Counters are not reset.
+	 */
+	void clear();
+
+private:
+	struct Entry
+	{
+		Entry() : hash(0), schema(nullptr) {}
+
+		size_t hash;
+		const pbnjson::JSchema* schema;
+		std::string payload;
+		pbnjson::JValue value;
+	};
+
+	size_t mMaxPayloadSize;
+	std::vector<Entry> mEntries;
+	uint64_t mHits;
+	uint64_t mMisses;
+	mutable std::mutex mMutex; // Lock to access mEntries and counters.
+};
+
+} // namespace LSHelpers;
@@ -0,0 +1,143 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <pbnjson.hpp>
+
+#include "workerpool.hpp"
+
+namespace LSHelpers {
+
+/**
+ * @brief Moves parsing and serialization of large payloads off the main loop thread.
+ *
+ * Parsing a megabyte sized request or serializing a response of the same size blocks the main loop
+ * for tens of milliseconds, delaying all the small calls queued behind it. With offload set, payloads
+ * at or above the threshold are parsed or serialized on the worker pool, while dispatch and sending
+ * stay on the main loop. Smaller payloads are handled inline, as without offload.
+ *
+ * Request payload size is known up front. The size of a response or posted JValue is estimated by
+ * walking the value, the walk stops as soon as the threshold is reached.
+ *
+ * Large requests may be dispatched after smaller requests received later. Responses to the same request
+ * and posts to the same subscription point are sent in order.
+ *
+ * Do not modify a JValue after responding with it or posting it, it may be serialized on another thread.
+ *
+ * Example:
+ * @code
+ * WorkerPool pool(2);
+ * service.setPayloadOffload(PayloadOffload(pool, 256 * 1024));
+ * subscription.setPayloadOffload(PayloadOffload(pool, 256 * 1024));
+ * @endcode
+ */
+struct PayloadOffload
+{
+	static const size_t DEFAULT_THRESHOLD = 256 * 1024;
+
+	/**
+	 * No offload, everything runs inline.
+	 */
+	PayloadOffload()
+			: pool(nullptr)
+			, threshold(DEFAULT_THRESHOLD)
+	{}
+
+	/**
+	 * Offload payloads at or above the threshold to the pool.
+	 * @param pool worker pool, must outlive the objects using the offload.
+	 * @param threshold payload size in bytes.
+	 */
+	explicit PayloadOffload(WorkerPool& _pool, size_t _threshold = DEFAULT_THRESHOLD)
+			: pool(&_pool)
+			, threshold(_threshold)
+	{}
+
+	/**
+	 * @return true if a payload of the size is offloaded.
+	 */
+	inline bool isLarge(size_t size) const
+	{
+		return pool && size >= threshold;
+	}
+
+	/**
+	 * @return true if the serialized value is estimated to reach the threshold.
+	 */
+	bool isLarge(const pbnjson::JValue& value) const;
+
+	/**
+	 * Estimate serialized size of a value, without serializing it.
+	 * @param value value to measure.
+	 * @param limit stop once the estimate reaches the limit.
+	 * @return estimated size in bytes, at least the limit if the limit is reached.
+	 */
+	static size_t estimateSize(const pbnjson::JValue& value, size_t limit);
+
+	WorkerPool* pool;
+	size_t threshold;
+};
+
+/**
+ * @brief Runs the offloaded tasks of one owner in order, keeping later inline tasks behind them.
+ * Used for responses to one request and posts to one subscription point.
+ *
+ * Multithreading: This class is thread safe.
+ */
+class OrderedOffload
+{
+public:
+	OrderedOffload()
+			: mPending(0)
+	{}
+
+	/**
+	 * Waits for the offloaded tasks to finish.
+	 */
+	~OrderedOffload();
+
+	/** Not copyable. */
+	OrderedOffload(const OrderedOffload&) = delete;
+	OrderedOffload& operator=(const OrderedOffload&) = delete;
+
+	/**
+	 * Queue the task on the pool if it is large or earlier tasks are still queued.
+	 * @param config offload configuration.
+	 * @param large true if the payload of the task is large.
+	 * @param task task to queue.
+	 * @return true if the task is queued. False if the caller should run the task inline - offload is
+	 *         not set, the task is small and nothing is queued, or the pool queue is full.
+	 *         Earlier tasks are finished then.
+	 */
+	bool offload(const PayloadOffload& config, bool large, const WorkerPool::Task& task);
+
+	/**
+	 * Wait for the offloaded tasks to finish.
+	 */
+	void wait();
+
+private:
+	void finish();
+
+	std::mutex mMutex;
+	std::condition_variable mIdle;
+	size_t mPending;
+};
+
+} // namespace LSHelpers;
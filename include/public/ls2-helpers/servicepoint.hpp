@@ -23,6 +23,9 @@
 
 #include "jsonrequest.hpp"
 #include "jsonresponse.hpp"
+#include "metrics.hpp"
+#include "admissioncontrol.hpp"
+#include "workerpool.hpp"
 
 namespace LSHelpers {
 
@@ -143,12 +146,16 @@ public:
 	 * @param methodName the method name
 	 * @param handler handler method or lambda to call.
 	 * @param schema json schema to use. If set, will validate the request against the schema before calling the handler method.
+	 * @param policy selects the requests validated against the schema, see ValidationPolicy. Validates all by default.
+	 * @param executor where to run the handler, see MethodExecutor. Main loop thread by default.
 	 * @throws std::logic_error if a method is already registered with specified category and name.
 	 */
 	void registerMethod(const std::string& category,
 	                    const std::string& methodName,
 	                    const JsonRequest::Handler& handler,
-	                    const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema());
+	                    const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema(),
+	                    const ValidationPolicy& policy = ValidationPolicy::always(),
+	                    const MethodExecutor& executor = MethodExecutor());
 
 	/**
 	 * Helper method that accepts a object pointer and method pointer.
@@ -158,6 +165,8 @@ public:
 	 * @param object pointer to the object to call
 	 * @param handler pointer to object's member method
 	 * @param schema json schema to use. If set, will validate the request against the schema before calling the handler method.
+	 * @param policy selects the requests validated against the schema, see ValidationPolicy. Validates all by default.
+	 * @param executor where to run the handler, see MethodExecutor. Main loop thread by default.
 	 * @throws std::logic_error if a method is already registered with specified category and name.
 	 */
 	template<typename T>
@@ -165,9 +174,76 @@ public:
 	                    const std::string& methodName,
 	                    T* object,
 	                    pbnjson::JValue (T::* handler) (JsonRequest& request),
-	                    const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema())
+	                    const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema(),
+	                    const ValidationPolicy& policy = ValidationPolicy::always(),
+	                    const MethodExecutor& executor = MethodExecutor())
 	{
-		registerMethod(category, methodName, std::bind(handler, object,  std::placeholders::_1), schema);
+		registerMethod(category, methodName, std::bind(handler, object,  std::placeholders::_1), schema, policy, executor);
+	};
+
+	/**
+	 * Registers a method with parameters decoded into a JsonStruct, for example one generated from
+	 * a JSON schema with ls2-helpers-schemagen. The struct validates and decodes the request in one pass,
+	 * there is no separate JSchema validation. Invalid requests are answered with a schema validation
+	 * error response, without calling the handler.
+	 *
+	 * Example:
+	 * @code
+	 * pbnjson::JValue MyObj::setVolume(JsonRequest& request, SetVolumeParams& params);
+	 *
+	 * lunaService.registerMethod("/", "setVolume", this, &MyObj::setVolume);
+	 * @endcode
+	 * @param category category name. For example "/"
+	 * @param methodName the method name
+	 * @param object pointer to the object to call
+	 * @param handler pointer to object's member method.
+	 * @throws std::logic_error if a method is already registered with specified category and name.
+	 */
+	template<typename T, typename P>
+	void registerMethod(const std::string& category,
+	                    const std::string& methodName,
+	                    T* object,
+	                    pbnjson::JValue (T::* handler) (JsonRequest& request, P& params))
+	{
+		registerMethod(category, methodName, [object, handler](JsonRequest& request) -> pbnjson::JValue
+		{
+			P params;
+			if (!params.readFields(request))
+			{
+				return request.getErrorResponse();
+			}
+			return (object->*handler)(request, params);
+		});
+	};
+
+	/**
+	 * Helper method that accepts a object pointer and method pointer returning a typed response,
+	 * like a JsonStruct. The response is written to JSON directly, without a JValue tree.
+	 * Example: @code lunaService.registerMethod("/", "getAppInfo", this, &MyObj::getAppInfo); @endcode
+	 * @param category category name. For example "/"
+	 * @param methodName the method name
+	 * @param object pointer to the object to call
+	 * @param handler pointer to object's member method. Return value is ignored if the request is deferred.
+	 * @param schema json schema to use. If set, will validate the request against the schema before calling the handler method.
+	 * @throws std::logic_error if a method is already registered with specified category and name.
+	 */
+	template<typename T, typename R>
+	typename std::enable_if<std::is_base_of<JsonWritable, R>::value>::type
+	registerMethod(const std::string& category,
+	               const std::string& methodName,
+	               T* object,
+	               R (T::* handler) (JsonRequest& request),
+	               const pbnjson::JSchema& schema = pbnjson::JSchema::AllSchema())
+	{
+		registerMethod(category, methodName, [object, handler](JsonRequest& request) -> pbnjson::JValue
+		{
+			R response = (object->*handler)(request);
+			if (!request.isDeferred())
+			{
+				request.respond(response);
+			}
+			return true; // Not sent, the response is already sent or deferred.
+		}, schema);
 	};
 
 	/**
@@ -183,6 +259,82 @@ public:
 	void registerSignal(const std::string& category,
 	                    const std::string& methodName);
 
+	/**
+	 * Get schema validation counters of a method.
+	 * @param category category name.
+	 * @param methodName the method name.
+	 * @return the counters.
+	 * @throws std::logic_error if the method is not registered.
+	 */
+	ValidationStats getValidationStats(const std::string& category, const std::string& methodName) const;
+
+	/**
+	 * Limit the requests of a method in flight and the call rate of each sender, see AdmissionLimits.
+	 * Requests over the limit wait in a queue, requests over the queue limit get a busy error
+	 * and calls over the sender rate get a rate limit error, without being parsed.
+	 * Deferred requests count until their first response.
+	 * Not thread safe, call after registering the method and before handling requests.
+	 * @param category category name.
+	 * @param methodName the method name.
+	 * @param limits the limits.
+	 * @throws std::logic_error if the method is not registered.
+	 */
+	void setAdmissionLimits(const std::string& category,
+	                        const std::string& methodName,
+	                        const AdmissionLimits& limits);
+
+	/**
+	 * Get admission control counters of a method.
+	 * @param category category name.
+	 * @param methodName the method name.
+	 * @return the counters, all zero if no limits are set.
+	 * @throws std::logic_error if the method is not registered.
+	 */
+	AdmissionStats getAdmissionStats(const std::string& category, const std::string& methodName) const;
+
+	/**
+	 * Collect metrics of all methods, see MethodMetrics: call and error counts, parse, handler and
+	 * response latency and payload size histograms.
+	 * Applies to the methods already registered and the ones registered later.
+	 * Not thread safe, call before handling requests.
+	 */
+	void enableMetrics();
+
+	/**
+	 * Collect metrics of outgoing calls by target URI, see CallMetrics: round trip latency,
+	 * reply outcomes, cancellations and multi reply update intervals.
+	 * Not thread safe, call before making calls.
+	 * @param slowCallMs log a warning for calls with round trip time above this, 0 to not log.
+	 */
+	void enableCallMetrics(uint32_t slowCallMs = 0);
+
+	/**
+	 * Get metrics of calls to an URI.
+	 * At most MAX_CALL_URIS URIs are tracked, calls to other URIs are counted under "*".
+	 * @param uri the call URI.
+	 * @return the metrics, null if call metrics are not enabled or no calls were made to the URI.
+	 */
+	std::shared_ptr<const CallMetrics> getCallMetrics(const std::string& uri) const;
+
+	/**
+	 * Get metrics of all methods, with their validation and admission counters, and metrics of calls.
+	 * @code
+	 * {"methods": {"/category/method": {"calls": 10, "errors": {"3": 1}, "parseUs": {...}, ...}},
+	 *  "calls": {"luna://com.webos.service/method": {"calls": 5, "roundTripUs": {...}, ...}}}
+	 * @endcode
+	 * @return metrics object, no methods if metrics are not enabled, no calls if call metrics are not enabled.
+	 */
+	pbnjson::JValue getMetrics() const;
+
+	/**
+	 * Register a method that responds with getMetrics().
+	 * Enable metrics with enableMetrics.
+	 * @param category category name.
+	 * @param methodName the method name.
+	 * @throws std::logic_error if a method is already registered with specified category and name.
+	 */
+	void registerStatsMethod(const std::string& category, const std::string& methodName);
+
 	/**
 	 * Make a one reply call.
 	 * If this call succeeds (does not throw) the handler method is guaranteed to be eventually called.
@@ -219,6 +371,22 @@ public:
 		return callOneReply(uri, params, std::bind(handler, object, std::placeholders::_1));
 	}
 
+	/**
+	 * Make a one reply call with pre-serialized parameters.
+	 * @see callOneReply
+	 * @param uri
+	 * @param params parameters, built with JsonWriter.
+	 * @param handler - if set the handler method will be called. If not set, nothing will be called.
+	 * @return luna message token that can be used ot cancel the call (even when no callback is set).
+	 * @throw LS::Error on luna error
+	 */
+	inline LSMessageToken callOneReply(const std::string& uri,
+	                                   const JsonWriter& params,
+	                                   const JsonResponse::Handler& handler)
+	{
+		return makeCall(uri, params.c_str(), true, handler);
+	}
+
 	/**
 	 * Make a multi reply call. The call is active until cancelCall or client is deleted.
 	 * If this call succeeds (does not throw) the handler method is guaranteed to be eventually called at least once.
@@ -255,6 +423,22 @@ public:
 		return callMultiReply(uri, params, std::bind(handler, object, std::placeholders::_1));
 	}
 
+	/**
+	 * Make a multi reply call with pre-serialized parameters.
+	 * @see callMultiReply
+	 * @param uri
+	 * @param params parameters, built with JsonWriter.
+	 * @param handler - mandatory response handler.
+	 * @return luna token, that can be used ot cancel the call.
+	 * @throw LS::Error on luna error, std::logic_error if no response handler.
+	 */
+	inline LSMessageToken callMultiReply(const std::string& uri,
+	                                     const JsonWriter& params,
+	                                     const JsonResponse::Handler& handler)
+	{
+		return makeCall(uri, params.c_str(), false, handler);
+	}
+
 	/**
 	 * Sends a signal to all subscribers.
 	 * @param category - signal category
@@ -265,6 +449,16 @@ public:
 	                const std::string& method,
 	                const pbnjson::JValue& payload);
 
+	/**
+	 * Sends a signal with pre-serialized payload to all subscribers.
+	 * @param category - signal category
+	 * @param method - signal method
+	 * @param payload - payload to send, built with JsonWriter.
+	 */
+	void sendSignal(const std::string& category,
+	                const std::string& method,
+	                const JsonWriter& payload);
+
 	/**
 	 * Subscribe to a signal.
 	 * Note that the response handler receives only signal responses.
@@ -322,6 +516,51 @@ public:
 	 */
 	void cancelCall(LSMessageToken token);
 
+	/**
+	 * Enable caching of parsed request and response payloads.
+	 * Repeated identical small payloads are then parsed and validated only once.
+	 * Handlers must not modify the json returned by getJson(), as it may be shared between calls.
+	 * Not thread safe, call before registering methods and making calls.
+	 * @param capacity number of cached payloads, 0 disables the cache.
+	 * @param maxPayloadSize the maximum size of cached payloads, in bytes.
+	 */
+	void setPayloadCache(size_t capacity, size_t maxPayloadSize = 256);
+
+	/**
+	 * @return the payload cache, for reading the hit and miss counters. Null if not enabled.
+	 */
+	inline const PayloadCache* getPayloadCache() const
+	{
+		return mPayloadCache.get();
+	}
+
+	/**
+	 * Allocate request objects from per request arenas, reused between requests on the same thread.
+	 * Saves heap allocations for busy services. Handlers can use JsonRequest::getArena()
+	 * for their temporaries regardless of this setting.
+	 * Not thread safe, call before registering methods.
+	 * @param enable true to enable.
+	 */
+	inline void setRequestArena(bool enable)
+	{
+		mRequestArena = enable;
+	}
+
+	/**
+	 * Parse large requests and serialize large responses on a worker pool, see PayloadOffload.
+	 * A large request is parsed and validated on the pool, then the handler is called on the main loop.
+	 * Applies to methods running on the main loop, methods with a MethodExecutor parse on their pool anyway.
+	 * Not thread safe, call before registering methods.
+	 * @param offload pool and size threshold. Default constructed to disable.
+	 */
+	inline void setPayloadOffload(const PayloadOffload& offload)
+	{
+		mPayloadOffload = offload;
+	}
+
+	/** Maximum number of URIs with call metrics. */
+	static const size_t MAX_CALL_URIS = 256;
+
 private:
 	// Internal call object
 	struct Call
@@ -340,6 +579,11 @@ private:
 		LSMessageToken token;
 		JsonResponse::Handler handler;
 		bool oneReply;
+		std::shared_ptr<CallMetrics> metrics; // Null if call metrics are not enabled.
+		std::string uri; // Set only with metrics, for the slow call log.
+		uint64_t sentUs = 0;
+		uint64_t lastReplyUs = 0; // 0 until the first reply.
+		Span trace = Span(); // Call span, start time reset once recorded. Trace id 0 if not traced.
 	};
 	//Internal method object
 	struct MethodInfo
@@ -347,11 +591,15 @@ private:
 		MethodInfo(ServicePoint* _service,
 		           const JsonRequest::Handler& _handler,
 		           const pbnjson::JSchema& _schema,
+		           const ValidationPolicy& _policy,
+		           const MethodExecutor& _executor,
 		           const std::string& _category,
 		           const std::string& _method)
 				: service(_service)
 				, handler(_handler)
 				, schema(_schema)
+				, policy(_policy)
+				, executor(_executor)
 				, category(_category)
 				, method(_method)
 		{}
@@ -359,19 +607,48 @@ private:
 		ServicePoint* service;
 		JsonRequest::Handler handler;
 		pbnjson::JSchema schema;
+		ValidationPolicy policy;
+		MethodExecutor executor;
+		std::shared_ptr<AdmissionControl> admission; // Null if not limited.
+		std::shared_ptr<MethodMetrics> metrics; // Null if metrics are not enabled.
 		std::string category;
 		std::string method;
 	};
 
+	MethodInfo& findMethod(const std::string& category, const std::string& methodName) const;
+
 	LSMessageToken makeCall(const std::string& uri, const pbnjson::JValue& params, bool oneReply, const JsonResponse::Handler& handler);
+	LSMessageToken makeCall(const std::string& uri, const char* params, bool oneReply, const JsonResponse::Handler& handler);
+	void sendSignalImpl(const std::string& category, const std::string& method, const char* payload);
 	void cancelCall(Call* call);
+	std::shared_ptr<CallMetrics> findCallMetrics(const std::string& uri);
 
 	void registerMethodImpl(MethodInfo& method);
 	void unregisterMethodImpl(MethodInfo& method);
 
 	static bool methodHandler(LSHandle *sh, LSMessage *msg, void *method_context);
+	static bool dispatchMethod(LSHandle *sh, LSMessage *msg, MethodInfo* method, uint64_t arrivalUs);
+	static bool handleCall(LS::Message& message,
+	                       MethodInfo* method,
+	                       const PayloadOffload* offload,
+	                       const std::function<void()>& onComplete,
+	                       uint64_t arrivalUs);
+	static bool handleOnExecutor(LSHandle *sh,
+	                             LSMessage *msg,
+	                             MethodInfo* method,
+	                             const std::function<void()>& onComplete,
+	                             uint64_t arrivalUs);
+	static bool handleLargePayload(LSHandle *sh,
+	                               LSMessage *msg,
+	                               MethodInfo* method,
+	                               const std::function<void()>& onComplete,
+	                               uint64_t arrivalUs);
+	static std::function<void()> makeCompletion(LSHandle *sh, MethodInfo* method);
 	static bool removedMethodHandler(LSHandle *sh, LSMessage *msg, void *method_context);
 	static bool callResponseHandler(LSHandle *sh, LSMessage *reply, void *ctx);
+	static bool handleReply(LSMessage* msg, const JsonResponse::Handler& handler, PayloadCache* cache,
+	                        CallMetrics* metrics);
+	static void recordReply(Call& call);
 
 	// Instance variables
 	LS::Handle* mHandle;
@@ -380,6 +657,29 @@ private:
 	std::vector<std::unique_ptr<MethodInfo> > mMethods;
 	std::unordered_map<LSMessageToken, std::unique_ptr<Call> > mCalls;
 	std::mutex mCallsMutex; // Lock access to mCalls.
+	std::unique_ptr<PayloadCache> mPayloadCache;
+	bool mRequestArena;
+	bool mMetricsEnabled;
+	bool mCallMetricsEnabled;
+	uint64_t mSlowCallUs; // 0 to not log slow calls.
+	std::unordered_map<std::string, std::shared_ptr<CallMetrics> > mCallMetrics;
+	mutable std::mutex mCallMetricsMutex; // Lock access to mCallMetrics.
+
+	PayloadOffload mPayloadOffload;
+
+	// Handlers running on worker pools. The destructor waits for them to finish.
+	struct ExecutorState
+	{
+		// Returns false if the service point is destroyed.
+		bool enter();
+		void leave();
+
+		std::mutex mutex;
+		std::condition_variable finished;
+		size_t running = 0;
+		bool stopped = false;
+	};
+	std::shared_ptr<ExecutorState> mExecutorState;
 };
 
 } // namespace LSHelpers;
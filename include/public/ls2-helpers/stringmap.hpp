@@ -0,0 +1,254 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "stringref.hpp"
+
+namespace LSHelpers {
+
+/**
+ * @return StringMap table size - power of two, at least twice the number of keys.
+ */
+constexpr size_t stringMapTableSize(size_t size, size_t result = 1)
+{
+	return result >= 2 * size ? result : stringMapTableSize(size, result * 2);
+}
+
+/**
+ * @brief Immutable map from a fixed set of strings to values, using a perfect hash.
+ * Intended for enum-like string fields - use with JsonParser::getAndMap and JsonParseContext::allowedValues.
+ *
+ * The hash table is built once, when the map is constructed, so declare the map static const.
+ * The map uses two level hash and displace: the first hash selects a bucket, the bucket seed
+ * selects the slot with the second hash. Each slot holds at most one key, so a lookup hashes the
+ * string twice and does a single compare - unknown strings are rejected in constant time.
+ * Lookups do not allocate and take the string as pointer and length.
+ *
+ * Keys are not copied, use string literals or strings that outlive the map.
+ *
+ * Example:
+ * @code
+ * static const StringMap<AudioType, 2> audioTypes {{
+ *     {"Analog", AudioType::Analog},
+ *     {"Digital", AudioType::Digital}
+ * }};
+ *
+ * parser.getAndMap("audioType", audioType, audioTypes);
+ * @endcode
+ *
+ * @tparam T value type, must be default constructible and copyable.
+ * @tparam N number of keys.
+ */
+template<typename T, size_t N>
+class StringMap
+{
+public:
+	/**
+	 * Builds the map.
+	 * @param values exactly N pairs of key and value.
+	 * @throw std::invalid_argument if the number of values is not N or keys are not unique.
+	 */
+	StringMap(std::initializer_list< std::pair<const char*, T> > values)
+		: _seeds()
+		, _slots()
+	{
+		if (values.size() != N)
+		{
+			throw std::invalid_argument("StringMap: number of values does not match the size");
+		}
+
+		// Group keys by first level hash.
+		std::array<size_t, N> bucketOf;
+		std::array<size_t, TABLE_SIZE> bucketSize {};
+		size_t index = 0;
+		for (const auto& value : values)
+		{
+			bucketOf[index] = hash(value.first, strlen(value.first), 0) & MASK;
+			bucketSize[bucketOf[index]]++;
+			index++;
+		}
+
+		// Place the largest buckets first, while most slots are free.
+		for (size_t size = N; size > 0; size--)
+		{
+			for (size_t bucket = 0; bucket < TABLE_SIZE; bucket++)
+			{
+				if (bucketSize[bucket] == size)
+				{
+					placeBucket(values, bucketOf, bucket);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Looks up a string.
+	 * @param str string, does not need to be zero terminated.
+	 * @param len length of the string.
+	 * @return pointer to the value, nullptr if the string is not in the map.
+	 */
+	inline const T* find(const char* str, size_t len) const
+	{
+		const Slot& slot = _slots[slotIndex(str, len)];
+		if (slot.key && slot.keyLength == len && memcmp(slot.key, str, len) == 0)
+		{
+			return &slot.value;
+		}
+		return nullptr;
+	}
+
+	/** @see find */
+	inline const T* find(const StringRef& str) const
+	{
+		return find(str.data(), str.size());
+	}
+
+	/**
+	 * @return true if the string is in the map.
+	 */
+	inline bool contains(const StringRef& str) const
+	{
+		return find(str) != nullptr;
+	}
+
+	/**
+	 * Reverse lookup, for writing enum-like values back to JSON.
+	 * Scans the table, cost is linear in the map size.
+	 * @param value value to look for.
+	 * @return key of the value, nullptr if no key maps to the value.
+	 */
+	inline const char* findKey(const T& value) const
+	{
+		for (const Slot& slot : _slots)
+		{
+			if (slot.key && slot.value == value)
+			{
+				return slot.key;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @return number of keys in the map.
+	 */
+	constexpr size_t size() const
+	{
+		return N;
+	}
+
+private:
+	static constexpr size_t TABLE_SIZE = stringMapTableSize(N);
+	static constexpr size_t MASK = TABLE_SIZE - 1;
+	static constexpr uint32_t MAX_SEED = 1 << 16;
+
+	struct Slot
+	{
+		const char* key;
+		size_t keyLength;
+		T value;
+	};
+
+	/** FNV-1a hash, with seed mixed into the offset basis. */
+	static inline uint32_t hash(const char* str, size_t len, uint32_t seed)
+	{
+		uint32_t h = 2166136261u ^ (seed * 16777619u);
+		for (size_t i = 0; i < len; i++)
+		{
+			h = (h ^ static_cast<unsigned char>(str[i])) * 16777619u;
+		}
+		return h ^ (h >> 15);
+	}
+
+	inline size_t slotIndex(const char* str, size_t len) const
+	{
+		uint32_t seed = _seeds[hash(str, len, 0) & MASK];
+		return hash(str, len, seed) & MASK;
+	}
+
+	/**
+	 * Finds a seed that places all keys of the bucket to free slots and stores them.
+	 */
+	void placeBucket(std::initializer_list< std::pair<const char*, T> > values,
+	                 const std::array<size_t, N>& bucketOf,
+	                 size_t bucket)
+	{
+		for (uint32_t seed = 1; seed < MAX_SEED; seed++)
+		{
+			std::array<size_t, N> placed;
+			size_t placedCount = 0;
+			bool fits = true;
+
+			size_t index = 0;
+			for (const auto& value : values)
+			{
+				if (bucketOf[index++] != bucket)
+				{
+					continue;
+				}
+
+				size_t slot = hash(value.first, strlen(value.first), seed) & MASK;
+				for (size_t i = 0; i < placedCount && fits; i++)
+				{
+					fits = placed[i] != slot;
+				}
+
+				if (!fits || _slots[slot].key)
+				{
+					fits = false;
+					break;
+				}
+				placed[placedCount++] = slot;
+			}
+
+			if (fits)
+			{
+				_seeds[bucket] = seed;
+				index = 0;
+				placedCount = 0;
+				for (const auto& value : values)
+				{
+					if (bucketOf[index++] == bucket)
+					{
+						_slots[placed[placedCount++]] = Slot{value.first, strlen(value.first), value.second};
+					}
+				}
+				return;
+			}
+		}
+
+		// Equal keys always collide.
+		throw std::invalid_argument("StringMap: duplicate key");
+	}
+
+	std::array<uint32_t, TABLE_SIZE> _seeds;
+	std::array<Slot, TABLE_SIZE> _slots;
+};
+
+template<typename T, size_t N> constexpr size_t StringMap<T, N>::TABLE_SIZE;
+template<typename T, size_t N> constexpr size_t StringMap<T, N>::MASK;
+template<typename T, size_t N> constexpr uint32_t StringMap<T, N>::MAX_SEED;
+
+} // Namespace LSHelpers
@@ -0,0 +1,176 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace LSHelpers {
+
+/**
+ * @brief Non owning reference to a string - pointer and length.
+ * Use as JsonParser destination to read a string field without copying it.
+ *
+ * The reference points into the parsed JSON data and is valid only while the JSON value is alive,
+ * i.e. for the lifetime of the JsonParser, JsonRequest or JsonResponse it was read from.
+ * Call str() to keep a copy beyond that. Not valid for values read with getFromString,
+ * as the parsed string value is temporary.
+ *
+ * Example:
+ * @code
+ * StringRef appId;
+ * request.get("appId", appId);
+ * if (appId == "com.webos.app.settings") ...
+ * @endcode
+ */
+class StringRef
+{
+public:
+	StringRef()
+		: _data("")
+		, _size(0)
+	{}
+
+	StringRef(const char* data, size_t size)
+		: _data(data)
+		, _size(size)
+	{}
+
+	StringRef(const char* str)
+		: _data(str)
+		, _size(strlen(str))
+	{}
+
+	StringRef(const std::string& str)
+		: _data(str.data())
+		, _size(str.size())
+	{}
+
+	inline const char* data() const { return _data; }
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return _size == 0; }
+
+	/**
+	 * @return copy of the string.
+	 */
+	inline std::string str() const
+	{
+		return std::string(_data, _size);
+	}
+
+	inline int compare(const StringRef& other) const
+	{
+		int result = memcmp(_data, other._data, _size < other._size ? _size : other._size);
+		if (result == 0)
+		{
+			return _size < other._size ? -1 : (_size > other._size ? 1 : 0);
+		}
+		return result;
+	}
+
+	inline bool operator==(const StringRef& other) const
+	{
+		return _size == other._size && memcmp(_data, other._data, _size) == 0;
+	}
+
+	inline bool operator!=(const StringRef& other) const { return !(*this == other); }
+	inline bool operator<(const StringRef& other) const { return compare(other) < 0; }
+	inline bool operator>(const StringRef& other) const { return compare(other) > 0; }
+
+private:
+	const char* _data;
+	size_t _size;
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const StringRef& ref)
+{
+	return stream.write(ref.data(), ref.size());
+}
+
+/**
+ * @brief Handle to a string stored once in a process wide pool.
+ * Use as JsonParser destination for low cardinality strings that repeat across requests,
+ * like application ids or setting keys. Parsing a value that is already in the pool does not allocate.
+ * Handles are cheap to copy, never expire and compare equal in constant time.
+ *
+ * Strings are never removed from the pool, do not use for unbounded sets of values.
+ * Values parsed from requests are interned with tryIntern, so a client sending distinct values
+ * can add at most MAX_POOL_SIZE strings, further new values fail to parse.
+ *
+ * Multithreading: The pool is thread safe. Handles can be used from any thread.
+ */
+class InternedString
+{
+public:
+	/**
+	 * Creates handle to empty string.
+	 */
+	InternedString();
+
+	/** Number of strings tryIntern adds to the pool at most. */
+	static const size_t MAX_POOL_SIZE = 16384;
+
+	/**
+	 * Gets the handle for a string, adding the string to the pool if not there yet.
+	 * Not limited, use for strings from the program, not from clients.
+	 */
+	static InternedString intern(const StringRef& str);
+
+	/**
+	 * Gets the handle for a string, adding the string to the pool if not there yet
+	 * and the pool has less than MAX_POOL_SIZE strings.
+	 * @param str string.
+	 * @param result set to the handle if found or added.
+	 * @return false if the string is not in the pool and the pool is full.
+	 */
+	static bool tryIntern(const StringRef& str, InternedString& result);
+
+	/**
+	 * @return number of strings in the pool.
+	 */
+	static size_t poolSize();
+
+	inline const std::string& str() const { return *_value; }
+	inline const char* c_str() const { return _value->c_str(); }
+	inline size_t size() const { return _value->size(); }
+	inline bool empty() const { return _value->empty(); }
+
+	inline operator const std::string&() const { return *_value; }
+
+	/** Handles of equal strings point to the same pool entry. */
+	inline bool operator==(const InternedString& other) const { return _value == other._value; }
+	inline bool operator!=(const InternedString& other) const { return _value != other._value; }
+	inline bool operator==(const StringRef& other) const { return StringRef(*_value) == other; }
+	inline bool operator!=(const StringRef& other) const { return !(StringRef(*_value) == other); }
+	inline bool operator<(const InternedString& other) const { return *_value < *other._value; }
+	inline bool operator>(const InternedString& other) const { return *_value > *other._value; }
+
+private:
+	explicit InternedString(const std::string* value)
+		: _value(value)
+	{}
+
+	const std::string* _value;
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const InternedString& str)
+{
+	return stream << str.str();
+}
+
+} // Namespace LSHelpers
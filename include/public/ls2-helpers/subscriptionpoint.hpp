@@ -119,6 +119,7 @@ public:
 	 */
 	~SubscriptionPoint()
 	{
+		mOffloaded.wait();
 		unsetCancelNotificationCallback();
 	}
 
@@ -132,6 +133,17 @@ public:
 		mDeduplicate = deduplicate;
 	}
 
+	/**
+	 * Serialize large posted values on a worker pool, see PayloadOffload.
+	 * Posts stay in order - a post made while an earlier one is being serialized is queued behind it.
+	 * Not thread safe, call before posting.
+	 * @param offload pool and size threshold. Default constructed to disable.
+	 */
+	void setPayloadOffload(const PayloadOffload& offload)
+	{
+		mOffload = offload;
+	}
+
 	/**
 	 * Speficy service to use for sending subscription replies.
 	 * Optional - the service handle will be derived from the first subscription added, if not set.
@@ -179,12 +191,32 @@ public:
 	/**
 	 * Post payload to all subscribers
 	 * @param payload posted data
+	 * @return Returns true if replies were posted successfully, or if queued for serialization on the
+	 *         offload pool.
+	 */
+	bool post(const pbnjson::JValue& payload) noexcept;
+
+	/**
+	 * Post pre-serialized payload to all subscribers
+	 * @param payload posted data, built with JsonWriter
+	 * @return Returns true if replies were posted successfully
+	 */
+	bool post(const JsonWriter& payload) noexcept
+	{
+		return post(payload.c_str());
+	}
+
+	/**
+	 * Post object derived from JsonWritable, like JsonStruct, to all subscribers
+	 * @param payload posted data
 	 * @return Returns true if replies were posted successfully
 	 */
-	bool post(const pbnjson::JValue& payload) noexcept
+	template<typename T>
+	typename std::enable_if<std::is_base_of<JsonWritable, T>::value, bool>::type post(const T& payload) noexcept
 	{
-		pbnjson::JValue p = payload;
-		return post(p.stringify().c_str());
+		JsonWriter writer;
+		payload.toJson(writer);
+		return post(writer);
 	}
 
 	/**
@@ -202,6 +234,8 @@ private:
 	bool mDeduplicate;
 	std::string mPreviousPayload;
 	std::mutex mSubscriptonsMutex; // Lock to access mSubscriptions and mPreviousPayload
+	PayloadOffload mOffload;
+	OrderedOffload mOffloaded; // Posts being serialized on the offload pool.
 
 	void setCancelNotificationCallback()
 	{
@@ -218,6 +252,7 @@ private:
 	static bool subscriberCancelCB(LSHandle *sh, const char *uniqueToken, void *context);
 	void subscriberStatusCB(SubscriptionItem* item, bool isUp);
 	static bool postSubscriptions(gpointer user_data);
+	bool postPayload(const char *payload) noexcept;
 	static bool doSubscribe(gpointer user_data);
 };
 
@@ -0,0 +1,257 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LSHelpers {
+
+/**
+ * @brief Position of a span in a trace - ids of the trace and of the span.
+ */
+struct TraceContext
+{
+	TraceContext()
+		: traceId(0)
+		, spanId(0)
+	{}
+
+	TraceContext(uint64_t _traceId, uint64_t _spanId)
+		: traceId(_traceId)
+		, spanId(_spanId)
+	{}
+
+	uint64_t traceId;
+	uint64_t spanId;
+
+	/**
+	 * @return true if this is a traced context.
+	 */
+	explicit operator bool() const
+	{
+		return traceId != 0;
+	}
+};
+
+/**
+ * @brief Kind of a span, decides how the span is shown in the trace file.
+ */
+enum class SpanKind : uint8_t
+{
+	Request, // Request from receiving to the first response, asynchronous.
+	Parse,   // Parsing and validating the request payload.
+	Handler, // Running the method handler.
+	Respond, // Serializing and sending a response.
+	Call     // Outgoing call from sending to the first reply, asynchronous.
+};
+
+/**
+ * @brief A finished span, as stored in the trace buffers.
+ */
+struct Span
+{
+	const char* name; // Interned with InternedString, null to name the span by its kind.
+	SpanKind kind;
+	uint64_t traceId;
+	uint64_t spanId;
+	uint64_t parentId; // 0 for the root span of a trace.
+	uint64_t remoteParentId; // Span of the caller in another process, 0 if none.
+	uint64_t startUs;
+	uint64_t durationUs;
+};
+
+/**
+ * @brief Process wide request tracing, exported as Chrome trace file.
+ *
+ * When started, ServicePoint records spans for parsing, handling and responding to requests
+ * and for outgoing calls. Calls to the services listed in start get the trace context in the
+ * reserved "$trace" field of the call payload, the called service removes the field before parsing,
+ * so the schemas and handlers do not see it. Services using ServicePoint then continue the trace
+ * of the caller, and spans of all processes in a call chain share the trace id.
+ *
+ * Spans are written to a fixed size lock free buffer of the recording thread and written to the
+ * trace file by a flusher thread. Spans are dropped if a buffer is full.
+ * The file uses the JSON array format of the Chrome trace event format. Open it in Perfetto UI or
+ * chrome://tracing, concatenate the arrays of several processes to see the whole call chain, the
+ * calls and requests are connected with flow arrows.
+ *
+ * Trace ids and timestamps are shared between processes - timestamps are monotonic clock microseconds.
+ *
+ * Example:
+ * @code
+ * LSHelpers::Tracer::start("/tmp/com.webos.service.trace.json", 1000, {"com.webos.service.other"});
+ * ...
+ * LSHelpers::Tracer::stop();
+ * @endcode
+ *
+ * Multithreading: This class is thread safe, except that start and stop must not be called concurrently.
+ */
+class Tracer
+{
+public:
+	/** Name of the reserved payload field with the trace context. */
+	static const char FIELD[];
+
+	/** Number of spans buffered per thread, the buffer takes 64 bytes per span. */
+	static const size_t BUFFER_SIZE = 4096;
+
+	/**
+	 * Start tracing to a file. Restarts if already started.
+	 * @param path trace file, overwritten.
+	 * @param flushIntervalMs how often the buffers are written to the file.
+	 * @param propagateTo names of the services whose calls get the trace context in the payload,
+	 *                    "*" for all services. Only list services that use ServicePoint, others
+	 *                    would reject the unknown field. By default the context is not propagated.
+	 * @return false if the file can not be opened.
+	 */
+	static bool start(const std::string& path,
+	                  uint32_t flushIntervalMs = 1000,
+	                  const std::vector<std::string>& propagateTo = {});
+
+	/**
+	 * Stop tracing, write the remaining spans and close the file.
+	 */
+	static void stop();
+
+	/**
+	 * Write the buffered spans to the file now.
+	 */
+	static void flush();
+
+	/**
+	 * @return true if tracing is started.
+	 */
+	static inline bool isEnabled()
+	{
+		return sEnabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @param uri luna uri of the called method.
+	 * @return true if tracing is started and the context is propagated to the called service.
+	 */
+	static bool isPropagating(const char* uri);
+
+	/**
+	 * @return number of spans dropped because a buffer was full.
+	 */
+	static uint64_t getDropped();
+
+	/**
+	 * @return context of the span running on this thread, see TraceScope. Not traced if none.
+	 */
+	static TraceContext current();
+
+	/**
+	 * @return new random span or trace id, never 0.
+	 */
+	static uint64_t newId();
+
+	/**
+	 * Store a finished span to the buffer of this thread. Ignored if tracing is not started.
+	 */
+	static void record(const Span& span);
+
+	/**
+	 * Add the trace context to a JSON object payload.
+	 * @param payload JSON object.
+	 * @param context context of the calling span.
+	 * @return payload with the context field, or the payload unchanged if it is not an object.
+	 */
+	static std::string inject(const char* payload, const TraceContext& context);
+
+	/**
+	 * Read and remove the trace context from a payload, if the caller added one.
+	 * @param payload JSON payload.
+	 * @param context set to the context of the calling span.
+	 * @param stripped set to the payload without the context field.
+	 * @return true if the payload has the context field.
+	 */
+	static bool extract(const char* payload, TraceContext& context, std::string& stripped);
+
+private:
+	static std::atomic<bool> sEnabled;
+	static std::shared_ptr<const std::vector<std::string> > sPropagateTo;
+};
+
+/**
+ * @brief Sets the current trace context of this thread for its lifetime.
+ * Outgoing calls made in the scope are recorded as children of the context. ServicePoint sets
+ * the scope for handlers and reply handlers, use it to continue a trace from deferred work.
+ *
+ * Example:
+ * @code
+ * TraceContext trace = request.getTraceContext();
+ * auto respond = request.defer();
+ * setTimeout(1000, [this, trace, respond]()
+ * {
+ *     TraceScope scope{trace};
+ *     mLunaClient.callOneReply(...);
+ * });
+ * @endcode
+ */
+class TraceScope
+{
+public:
+	explicit TraceScope(const TraceContext& context);
+	~TraceScope();
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	TraceContext mPrevious;
+};
+
+/**
+ * @brief Records a synchronous span for its lifetime, as a child of a traced context.
+ * Does nothing if the parent is not traced.
+ */
+class ScopedSpan
+{
+public:
+	ScopedSpan(SpanKind kind, const char* name, const TraceContext& parent);
+	~ScopedSpan();
+
+	ScopedSpan(const ScopedSpan&) = delete;
+	ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+	/**
+	 * @return context of this span, not traced if the parent is not.
+	 */
+	inline TraceContext getContext() const
+	{
+		return TraceContext{mSpan.traceId, mSpan.spanId};
+	}
+
+	/**
+	 * Link the span to the span of the caller in another process.
+	 */
+	inline void setRemoteParent(uint64_t spanId)
+	{
+		mSpan.remoteParentId = spanId;
+	}
+
+private:
+	Span mSpan;
+};
+
+} // namespace LSHelpers;
@@ -0,0 +1,131 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <pbnjson.hpp>
+
+namespace LSHelpers {
+
+/**
+ * @brief Counters of a method's schema validation.
+ */
+struct ValidationStats
+{
+	uint64_t validated; ///< Requests validated against the schema.
+	uint64_t skipped;   ///< Requests only parsed, not validated.
+	uint64_t failed;    ///< Validated requests that were valid JSON but failed the schema.
+};
+
+/**
+ * @brief Decides which requests to a method are validated against the method schema.
+ * Requests that are not validated are still parsed, a malformed payload is always rejected.
+ * Requests that fail validation are rejected, except with the sampled policy.
+ * Set per method with ServicePoint::registerMethod.
+ *
+ * Policies:
+ * - always() - validate every request. Default.
+ * - sampled(N) - validate every N-th request. Use to monitor callers that are known to be correct.
+ *   Failures are counted and logged, but the request is still handled, so a caller does not
+ *   fail only on the sampled requests.
+ * - trustedSenders(list) - skip validation for requests from the listed service names,
+ *   validate all others.
+ *
+ * Example:
+ * @code
+ * service.registerMethod("/", "setState", this, &MyService::setState, schema,
+ *                        ValidationPolicy::trustedSenders({"com.webos.service.settings"}));
+ * @endcode
+ *
+ * Multithreading: selectSchema and the counters are thread safe.
+ */
+class ValidationPolicy
+{
+public:
+	enum class Mode : uint8_t
+	{
+		Always,
+		Sampled,
+		TrustedSenders
+	};
+
+	/**
+	 * @return policy validating all requests.
+	 */
+	static ValidationPolicy always();
+
+	/**
+	 * @param interval validate one of every interval requests. 0 and 1 validate all requests.
+	 * @return policy validating a sample of requests.
+	 */
+	static ValidationPolicy sampled(uint32_t interval);
+
+	/**
+	 * @param senders service names of trusted senders.
+	 * @return policy validating requests from all senders except the listed ones.
+	 */
+	static ValidationPolicy trustedSenders(std::vector<std::string> senders);
+
+	/** Copies the policy settings, the counters of the copy start from zero. */
+	ValidationPolicy(const ValidationPolicy& other);
+	ValidationPolicy& operator=(const ValidationPolicy&) = delete;
+
+	inline Mode getMode() const { return mMode; }
+
+	/**
+	 * @return true if requests failing validation are counted and logged, but not rejected.
+	 */
+	inline bool isMonitoring() const { return mMode == Mode::Sampled; }
+
+	/**
+	 * Selects the schema for a request and counts it.
+	 * @param schema schema of the method.
+	 * @param senderServiceName service name of the sender, may be null.
+	 * @return schema if the request is to be validated, otherwise JSchema::AllSchema().
+	 */
+	const pbnjson::JSchema& selectSchema(const pbnjson::JSchema& schema, const char* senderServiceName);
+
+	/**
+	 * Counts a request that failed the validation.
+	 */
+	inline void recordFailure()
+	{
+		mFailed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return snapshot of the counters.
+	 */
+	ValidationStats getStats() const;
+
+private:
+	ValidationPolicy(Mode mode, uint32_t interval, std::vector<std::string> senders);
+
+	bool isTrusted(const char* senderServiceName) const;
+
+	Mode mMode;
+	uint32_t mInterval;
+	std::vector<std::string> mTrustedSenders; // Sorted.
+	std::atomic<uint64_t> mRequests;
+	std::atomic<uint64_t> mValidated;
+	std::atomic<uint64_t> mFailed;
+};
+
+} // namespace LSHelpers;
@@ -0,0 +1,169 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <luna-service2/lunaservice.hpp>
+
+namespace LSHelpers {
+
+class WorkerPool;
+
+/**
+ * @brief Bounded pool of worker threads.
+ * Runs tasks off the main loop thread. Tasks submitted with a key run in submission order
+ * on the same worker, tasks without a key run on any free worker.
+ *
+ * The destructor stops accepting tasks, runs the tasks already queued and joins the threads.
+ *
+ * Multithreading: This class is thread safe.
+ *
+ * Example:
+ * @code
+ * WorkerPool pool(4);
+ * service.registerMethod("/", "scan", this, &Scanner::scan, schema,
+ *                        ValidationPolicy::always(), MethodExecutor::perSender(pool));
+ * @endcode
+ */
+class WorkerPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 * @param threadCount number of worker threads, at least one is started.
+	 * @param queueCapacity maximum number of queued tasks. Submit fails when the queue is full.
+	 */
+	explicit WorkerPool(size_t threadCount, size_t queueCapacity = 1024);
+	~WorkerPool();
+
+	/** Not copyable. */
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	/**
+	 * Queue a task to run on any worker.
+	 * @param task task to run. Exceptions thrown by the task are logged and ignored.
+	 * @return false if the queue is full or the pool is stopping.
+	 */
+	bool submit(Task task);
+
+	/**
+	 * Queue a task to run after the tasks previously submitted with the same key.
+	 * @param task task to run. Exceptions thrown by the task are logged and ignored.
+	 * @param key ordering key, for example hash of the sender.
+	 * @return false if the queue is full or the pool is stopping.
+	 */
+	bool submit(Task task, size_t key);
+
+	/**
+	 * @return number of worker threads.
+	 */
+	inline size_t getThreadCount() const { return mThreads.size(); }
+
+	/**
+	 * @return number of queued tasks, not including the running ones.
+	 */
+	size_t getQueueSize() const;
+
+private:
+	bool enqueue(Task&& task, std::deque<Task>& queue);
+	void run(size_t worker);
+
+	mutable std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<Task> mSharedQueue; // Tasks without a key.
+	std::vector< std::deque<Task> > mWorkerQueues; // Keyed tasks, per worker.
+	std::vector<std::thread> mThreads;
+	size_t mQueueCapacity;
+	size_t mQueueSize;
+	bool mStopping;
+};
+
+/**
+ * @brief Where a method handler runs. Set per method with ServicePoint::registerMethod.
+ *
+ * By default handlers run on the main loop thread. With a worker pool, parsing, validation and
+ * the handler run on a worker, and the responses are passed back to the main loop to be sent.
+ * A request is then handled like a deferred one - the main loop is free to dispatch other calls
+ * while the handler runs. Requests are rejected with a busy error if the pool queue is full.
+ */
+struct MethodExecutor
+{
+	/** Order of requests handled on the pool. */
+	enum class Ordering : uint8_t
+	{
+		None,      ///< Requests may run concurrently, in any order.
+		PerSender, ///< Requests from the same sender run one at a time, in order.
+		PerKey     ///< Requests with the same key run one at a time, in order.
+	};
+
+	/** Key function for Ordering::PerKey. Runs on the main loop thread, keep it cheap. */
+	typedef std::function<size_t(const LS::Message& message)> KeyFunction;
+
+	/**
+	 * Run on the main loop thread.
+	 */
+	MethodExecutor()
+			: pool(nullptr)
+			, ordering(Ordering::None)
+	{}
+
+	/**
+	 * Run on the pool, in any order.
+	 */
+	static MethodExecutor concurrent(WorkerPool& pool)
+	{
+		return MethodExecutor(&pool, Ordering::None, KeyFunction());
+	}
+
+	/**
+	 * Run on the pool, requests from the same sender in order.
+	 */
+	static MethodExecutor perSender(WorkerPool& pool)
+	{
+		return MethodExecutor(&pool, Ordering::PerSender, KeyFunction());
+	}
+
+	/**
+	 * Run on the pool, requests with the same key in order.
+	 * @param key returns the ordering key of a request.
+	 */
+	static MethodExecutor perKey(WorkerPool& pool, const KeyFunction& key)
+	{
+		return MethodExecutor(&pool, Ordering::PerKey, key);
+	}
+
+	WorkerPool* pool;
+	Ordering ordering;
+	KeyFunction key;
+
+private:
+	MethodExecutor(WorkerPool* _pool, Ordering _ordering, const KeyFunction& _key)
+			: pool(_pool)
+			, ordering(_ordering)
+			, key(_key)
+	{}
+};
+
+} // namespace LSHelpers;
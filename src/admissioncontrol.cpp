@@ -0,0 +1,272 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "admissioncontrol.hpp"
+
+namespace LSHelpers {
+
+const size_t AdmissionControl::MAX_BUCKETS;
+
+static uint64_t monotonicMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AdmissionControl::Decision AdmissionControl::admit(const LS::Message& message, LS::Message& displaced, uint64_t arrivalUs)
+{
+	if (mLimits.rate <= 0 && mLimits.quantum == 0)
+	{
+		return admit(message, std::string(), 1, displaced, 0, arrivalUs);
+	}
+
+	const char* sender = nullptr;
+	if (mLimits.key == AdmissionLimits::SenderKey::ApplicationId)
+	{
+		sender = message.getApplicationID();
+	}
+	if (!sender)
+	{
+		sender = message.getSender();
+	}
+
+	// One unit plus one per KiB of payload.
+	uint32_t cost = 1;
+	if (mLimits.quantum > 0)
+	{
+		cost += static_cast<uint32_t>(strlen(message.getPayload()) / 1024);
+	}
+
+	return admit(message, sender ? sender : "", cost, displaced, monotonicMs(), arrivalUs);
+}
+
+AdmissionControl::Decision AdmissionControl::admit(const LS::Message& message,
+                                                   const std::string& sender,
+                                                   uint32_t cost,
+                                                   LS::Message& displaced,
+                                                   uint64_t nowMs,
+                                                   uint64_t arrivalUs)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (mLimits.rate > 0 && !takeToken(sender, nowMs))
+	{
+		mStats.rateLimited++;
+		return Decision::RateLimited;
+	}
+
+	if (mLimits.maxInFlight == 0 || mInFlight < mLimits.maxInFlight)
+	{
+		mInFlight++;
+		mStats.admitted++;
+		return Decision::Admit;
+	}
+
+	if (mLimits.quantum > 0)
+	{
+		bool isDisplaced = false;
+		if (enqueueFair(Queued{message, cost, arrivalUs}, sender, displaced, isDisplaced))
+		{
+			mStats.queued++;
+			if (isDisplaced)
+			{
+				mStats.rejected++;
+			}
+			return Decision::Queue;
+		}
+	}
+	else if (mQueued < mLimits.maxQueued)
+	{
+		mQueue.push_back(Queued{message, cost, arrivalUs});
+		mQueued++;
+		mStats.queued++;
+		return Decision::Queue;
+	}
+
+	mStats.rejected++;
+	return Decision::Reject;
+}
+
+bool AdmissionControl::release(LS::Message& next, uint64_t* arrivalUs)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (mQueued == 0)
+	{
+		if (mInFlight > 0)
+		{
+			mInFlight--;
+		}
+		return false;
+	}
+
+	Queued queued;
+	if (mLimits.quantum > 0)
+	{
+		queued = dequeueFair();
+	}
+	else
+	{
+		queued = mQueue.front();
+		mQueue.pop_front();
+	}
+	next = queued.message;
+	if (arrivalUs)
+	{
+		*arrivalUs = queued.arrivalUs;
+	}
+	mQueued--;
+	mStats.admitted++;
+	return true;
+}
+
+AdmissionStats AdmissionControl::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	AdmissionStats stats = mStats;
+	stats.inFlight = mInFlight;
+	stats.queueDepth = mQueued;
+	return stats;
+}
+
+size_t AdmissionControl::getQueueDepth(const std::string& sender) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto found = mFlows.find(sender);
+	return found != mFlows.end() ? found->second.queue.size() : 0;
+}
+
+bool AdmissionControl::takeToken(const std::string& sender, uint64_t nowMs)
+{
+	auto found = mBuckets.find(sender);
+	if (found == mBuckets.end())
+	{
+		if (mBuckets.size() >= MAX_BUCKETS)
+		{
+			// Forget the least recently used sender, its bucket is the most likely to have refilled.
+			auto oldest = mBuckets.find(*mBucketOrder.front());
+			mBucketOrder.pop_front();
+			mBuckets.erase(oldest);
+		}
+
+		found = mBuckets.emplace(sender, Bucket{double(mLimits.burst), nowMs, mBucketOrder.end()}).first;
+		found->second.order = mBucketOrder.insert(mBucketOrder.end(), &found->first);
+	}
+	else
+	{
+		mBucketOrder.splice(mBucketOrder.end(), mBucketOrder, found->second.order);
+	}
+
+	Bucket& bucket = found->second;
+	if (nowMs > bucket.updatedMs)
+	{
+		bucket.tokens = std::min(double(mLimits.burst),
+		                         bucket.tokens + (nowMs - bucket.updatedMs) * mLimits.rate / 1000);
+		bucket.updatedMs = nowMs;
+	}
+
+	if (bucket.tokens < 1)
+	{
+		return false;
+	}
+	bucket.tokens -= 1;
+	return true;
+}
+
+bool AdmissionControl::enqueueFair(const Queued& queued,
+                                   const std::string& sender,
+                                   LS::Message& displaced,
+                                   bool& isDisplaced)
+{
+	auto found = mFlows.find(sender);
+	size_t senderQueued = found != mFlows.end() ? found->second.queue.size() : 0;
+
+	if (mQueued >= mLimits.maxQueued)
+	{
+		// Displace the newest request of the longest queue, if longer than the sender's own.
+		Flow* longest = nullptr;
+		for (Flow* flow : mActiveFlows)
+		{
+			if (!longest || flow->queue.size() > longest->queue.size())
+			{
+				longest = flow;
+			}
+		}
+
+		if (!longest || longest->queue.size() <= senderQueued + 1)
+		{
+			return false;
+		}
+
+		displaced = longest->queue.back().message;
+		isDisplaced = true;
+		longest->queue.pop_back();
+		mQueued--;
+	}
+
+	Flow& flow = mFlows[sender];
+	if (flow.queue.empty())
+	{
+		flow.sender = sender;
+		flow.deficit = 0;
+		flow.granted = false;
+		mActiveFlows.push_back(&flow);
+	}
+	flow.queue.push_back(queued);
+	mQueued++;
+	return true;
+}
+
+AdmissionControl::Queued AdmissionControl::dequeueFair()
+{
+	// Deficit round robin: each round a sender gets quantum units and is served while they cover
+	// the cost of its next request.
+	for (;;)
+	{
+		Flow* flow = mActiveFlows.front();
+		if (!flow->granted)
+		{
+			flow->deficit += mLimits.quantum;
+			flow->granted = true;
+		}
+
+		if (flow->queue.front().cost <= flow->deficit)
+		{
+			flow->deficit -= flow->queue.front().cost;
+			Queued queued = flow->queue.front();
+			flow->queue.pop_front();
+
+			if (flow->queue.empty())
+			{
+				mActiveFlows.pop_front();
+				mFlows.erase(flow->sender);
+			}
+			return queued;
+		}
+
+		flow->granted = false;
+		mActiveFlows.pop_front();
+		mActiveFlows.push_back(flow);
+	}
+}
+
+} // namespace LSHelpers
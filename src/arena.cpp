@@ -0,0 +1,159 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "arena.hpp"
+
+namespace LSHelpers {
+
+/** Blocks larger than this are not kept for reuse on reset. */
+static const size_t MAX_RETAINED_BLOCK_SIZE = 64 * 1024;
+
+/** Number of arenas kept per thread. */
+static const size_t ARENA_CACHE_SIZE = 4;
+
+/**
+ * Per thread cache of released arenas.
+ */
+struct ArenaCache
+{
+	~ArenaCache()
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			delete arenas[i];
+		}
+	}
+
+	Arena* arenas[ARENA_CACHE_SIZE];
+	size_t count = 0;
+};
+
+static thread_local ArenaCache arenaCache;
+
+Arena::Arena(size_t blockSize)
+	: mBlockSize(blockSize > 0 ? blockSize : 4096)
+	, mBlocks(nullptr)
+	, mCurrent(nullptr)
+	, mEnd(nullptr)
+	, mBytesAllocated(0)
+{
+}
+
+Arena::~Arena()
+{
+	while (mBlocks)
+	{
+		Block* next = mBlocks->next;
+		free(mBlocks);
+		mBlocks = next;
+	}
+}
+
+void Arena::addBlock(size_t minSize)
+{
+	size_t size = mBlocks ? mBlocks->size * 2 : mBlockSize;
+	if (size < minSize + sizeof(Block))
+	{
+		size = minSize + sizeof(Block);
+	}
+
+	Block* block = static_cast<Block*>(malloc(size));
+	if (!block)
+	{
+		throw std::bad_alloc();
+	}
+
+	block->next = mBlocks;
+	block->size = size;
+	mBlocks = block;
+	mCurrent = reinterpret_cast<char*>(block + 1);
+	mEnd = reinterpret_cast<char*>(block) + size;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+	uintptr_t current = reinterpret_cast<uintptr_t>(mCurrent);
+	uintptr_t aligned = (current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+	if (!mCurrent || aligned + size > reinterpret_cast<uintptr_t>(mEnd))
+	{
+		addBlock(size + alignment);
+		current = reinterpret_cast<uintptr_t>(mCurrent);
+		aligned = (current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+
+	mCurrent = reinterpret_cast<char*>(aligned + size);
+	mBytesAllocated += size;
+	return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::reset()
+{
+	// Keep the newest block, it's the largest one.
+	Block* keep = mBlocks && mBlocks->size <= MAX_RETAINED_BLOCK_SIZE ? mBlocks : nullptr;
+	Block* block = keep ? keep->next : mBlocks;
+
+	while (block)
+	{
+		Block* next = block->next;
+		free(block);
+		block = next;
+	}
+
+	mBlocks = keep;
+	if (keep)
+	{
+		keep->next = nullptr;
+		mCurrent = reinterpret_cast<char*>(keep + 1);
+		mEnd = reinterpret_cast<char*>(keep) + keep->size;
+	}
+	else
+	{
+		mCurrent = nullptr;
+		mEnd = nullptr;
+	}
+	mBytesAllocated = 0;
+}
+
+Arena::Ptr Arena::acquire()
+{
+	if (arenaCache.count > 0)
+	{
+		return Ptr(arenaCache.arenas[--arenaCache.count]);
+	}
+
+	return Ptr(new Arena());
+}
+
+void Arena::Releaser::operator()(Arena* arena) const
+{
+	arena->reset();
+
+	if (arenaCache.count < ARENA_CACHE_SIZE)
+	{
+		arenaCache.arenas[arenaCache.count++] = arena;
+	}
+	else
+	{
+		delete arena;
+	}
+}
+
+} // Namespace LSHelpers
@@ -14,8 +14,13 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <pbnjson.h>
 #include "jsonparser.hpp"
+#include "numberparser.hpp"
 #include "util.hpp"
 
 using namespace pbnjson;
@@ -30,215 +35,437 @@ JsonParseError::JsonParseError(const std::string& format, ...)
 	va_end(args);
 }
 
+/**
+ * @return error message describing failed conversion result.
+ */
+static const char* conversionErrorMessage(ConversionResultFlags result)
+{
+	if (CONV_HAS_OVERFLOW(result))
+	{
+		return "Integer value out of bounds";
+	} else if (CONV_HAS_NOT_A_NUM(result))
+	{
+		return "Integer value not a number";
+	} else if (CONV_HAS_PRECISION_LOSS(result))
+	{
+		return "Integer requested, but fractional value provided";
+	} else
+	{
+		return "parse failed";
+	}
+}
+
 void checkConversionResultOrThrow(ConversionResultFlags result)
 {
 	if (result != CONV_OK)
 	{
-		const char* message;
+		throw JsonParseError(conversionErrorMessage(result));
+	}
+}
 
-		if (CONV_HAS_OVERFLOW(result))
-		{
-			message = "Integer value out of bounds";
-		} else if (CONV_HAS_NOT_A_NUM(result))
-		{
-			message = "Integer value not a number";
-		} else if (CONV_HAS_PRECISION_LOSS(result))
-		{
-			message = "Integer requested, but fractional value provided";
-		} else
+std::string ParseDiagnostic::getLocation() const
+{
+	std::string location;
+
+	if (!field.empty())
+	{
+		location.reserve(field.size() + 1);
+		location += '/';
+		for (char c : field)
 		{
-			message = "parse failed";
+			// JSON pointer escapes
+			if (c == '~')
+			{
+				location += "~0";
+			}
+			else if (c == '/')
+			{
+				location += "~1";
+			}
+			else
+			{
+				location += c;
+			}
 		}
+	}
+
+	if (index >= 0)
+	{
+		location += '/';
+		location += std::to_string(index);
+	}
 
-		throw JsonParseError(message);
+	return location;
+}
+
+std::string ParseDiagnostic::toString() const
+{
+	if (code == ParseErrorCode::MalformedJson)
+	{
+		return getMessage();
+	}
+
+	std::string text = "Failed to validate against schema: Field '";
+	text.append(field).append("' ");
+	if (index >= 0)
+	{
+		text.append("element ").append(std::to_string(index)).append(": ");
 	}
+	text.append(getMessage());
+	return text;
 }
 
+const size_t JsonParser::MAX_DIAGNOSTICS;
+
 void JsonParser::recordError(const char* fieldName, const char* message)
 {
-	std::stringstream s;
-	s << "Failed to validate against schema: Field '" << fieldName << "' " << message;
-	LOG_LS_WARNING(MSGID_LS_JSON_PARSE_ERROR, 0, "%s", s.str().c_str());
+	recordError(ParseDiagnostic(ParseErrorCode::InvalidValue, fieldName, "", -1, message));
+}
 
-	if (_parseError.empty())
+void JsonParser::recordError(ParseDiagnostic&& diagnostic)
+{
+	// Formatted and logged only when read, see finishParse.
+	if (_diagnostics.size() < MAX_DIAGNOSTICS)
 	{
-		_parseError = s.str();
+		_diagnostics.push_back(std::move(diagnostic));
 	}
 }
 
 /**
- * Converts jvalue to number. Tries to parse string values to numbers as well.
- * @param value
- * @param destination
- * @return
+ * Gets the text of a number or a numeric string without copying.
+ * @param value the value.
+ * @param text set to the text of the number.
+ * @return false if the value is a number that has no text, i.e. it was created from a C++ number, not parsed.
+ * @throw JsonParseError if the value is not a number or string.
  */
-template<typename T>
-static ConversionResultFlags asNumber(const JValue& value, T& destination)
+static bool getNumericText(const JValue& value, raw_buffer& text)
 {
-	ConversionResultFlags f;
-
 	if (value.isNumber())
 	{
-		f = value.asNumber(destination);
+		return jnumber_get_raw(value.peekRaw(), &text) == CONV_OK;
 	}
 	else if (value.isString()) //Try to parse the string as number
 	{
-		f = JValue(NumericString(value.asString())).asNumber(destination);
+		text = jstring_get_fast(value.peekRaw());
+		return true;
 	}
 	else
 	{
 		throw JsonParseError("not a number");
 	}
-
-	return f;
 }
 
-/* parseValue specializations*/
-
-template<>
-void JsonParser::parseValue<uint8_t>(const JValue& value,
-                         uint8_t& destination)
+/**
+ * Converts jvalue to integer. Parses string values to numbers as well.
+ * Numbers are decoded from their text, exactly over the whole range of the destination type.
+ * @param value
+ * @param destination
+ * @throw JsonParseError on parse error
+ */
+template<typename T>
+static void parseInteger(const JValue& value, T& destination)
 {
-	int32_t val = 0;
-	ConversionResultFlags f = asNumber(value, val);
-	if (val < 0)
+	ConversionResultFlags f;
+	raw_buffer text;
+
+	if (likely(getNumericText(value, text)))
 	{
-		f |= CONV_NEGATIVE_OVERFLOW;
+		f = decodeInteger(text.m_str, static_cast<size_t>(text.m_len), destination);
 	}
-	else if (val > UINT8_MAX)
+	else
 	{
-		f |= CONV_POSITIVE_OVERFLOW;
+		// Created from a C++ number - stored as int64 or double.
+		int64_t val = 0;
+		f = value.asNumber(val);
+
+		if (f == CONV_OK)
+		{
+			f = narrowInteger(val, destination);
+		}
+		else if ((f & CONV_POSITIVE_OVERFLOW) && std::is_same<T, uint64_t>::value)
+		{
+			// Above int64 range, only representable as double.
+			double d = 0;
+			value.asNumber(d);
+			if (d < 18446744073709551616.0 && std::floor(d) == d)
+			{
+				f = CONV_OK;
+				destination = static_cast<T>(d);
+			}
+		}
 	}
 
 	checkConversionResultOrThrow(f);
-	destination = static_cast<uint8_t>(val);
+}
+
+/* parseValue specializations*/
+
+template<>
+void JsonParser::parseValue<uint8_t>(const JValue& value,
+                         uint8_t& destination)
+{
+	parseInteger(value, destination);
 }
 
 template<>
 void JsonParser::parseValue<int8_t>(const JValue& value,
                          int8_t& destination)
 {
-	int32_t val = 0;
-	ConversionResultFlags f = asNumber(value, val);
-	if (val < INT8_MIN)
-	{
-		f |= CONV_NEGATIVE_OVERFLOW;
-	} else if (val > INT8_MAX)
-	{
-		f |= CONV_POSITIVE_OVERFLOW;
-	}
-
-	checkConversionResultOrThrow(f);
-	destination = static_cast<int8_t>(val);
+	parseInteger(value, destination);
 }
 
-
 template<>
 void JsonParser::parseValue<uint16_t>(const JValue& value,
                           uint16_t& destination)
 {
-	int32_t val = 0;
-	ConversionResultFlags f = asNumber(value, val);
-	if (val < 0)
-	{
-		f |= CONV_NEGATIVE_OVERFLOW;
-	} else if (val > UINT16_MAX)
-	{
-		f |= CONV_POSITIVE_OVERFLOW;
-	}
-
-	checkConversionResultOrThrow(f);
-	destination = static_cast<uint16_t>(val);
+	parseInteger(value, destination);
 }
 
 template<>
 void JsonParser::parseValue<int16_t>(const JValue& value,
                           int16_t& destination)
 {
-	int32_t val = 0;
-	ConversionResultFlags f = asNumber(value, val);
-	if (val < INT16_MIN)
-	{
-		f |= CONV_NEGATIVE_OVERFLOW;
-	} else if (val > INT16_MAX)
-	{
-		f |= CONV_POSITIVE_OVERFLOW;
-	}
-
-	checkConversionResultOrThrow(f);
-	destination = static_cast<int16_t>(val);
+	parseInteger(value, destination);
 }
 
-
 template<>
 void JsonParser::parseValue<int32_t>(const JValue& value,
                          int32_t& destination)
 {
-	ConversionResultFlags f = asNumber(value, destination);
-	checkConversionResultOrThrow(f);
+	parseInteger(value, destination);
 }
 
 template<>
 void JsonParser::parseValue<uint32_t>(const JValue& value,
                           uint32_t& destination)
 {
-	int64_t val = 0;
-	ConversionResultFlags f = asNumber(value, val);
-	if (val < 0)
-	{
-		f |= CONV_NEGATIVE_OVERFLOW;
-	}
-	else if (val > UINT32_MAX)
-	{
-		f |= CONV_POSITIVE_OVERFLOW;
-	}
-
-	checkConversionResultOrThrow(f);
-	destination = static_cast<uint32_t>(val);
+	parseInteger(value, destination);
 }
 
 template<>
 void JsonParser::parseValue<int64_t>(const JValue& value,
                          int64_t& destination)
 {
-	ConversionResultFlags f = asNumber(value, destination);
-	checkConversionResultOrThrow(f);
+	parseInteger(value, destination);
 }
 
 template<>
 void JsonParser::parseValue<uint64_t>(const JValue& value,
                           uint64_t& destination)
 {
-	double val = 0;
-	double intVal = 0;
-	ConversionResultFlags f = asNumber(value, val);
-	if (val < 0)
+	parseInteger(value, destination);
+}
+
+template<>
+void JsonParser::parseValue<double>(const JValue& value,
+                        double& destination)
+{
+	ConversionResultFlags f;
+	raw_buffer text;
+
+	if (likely(getNumericText(value, text)))
 	{
-		f |= CONV_NEGATIVE_OVERFLOW;
+		f = decodeDouble(text.m_str, static_cast<size_t>(text.m_len), destination);
 	}
-	else if (val > UINT64_MAX)
+	else
 	{
-		f |= CONV_POSITIVE_OVERFLOW;
+		f = value.asNumber(destination);
+		// Ignore precision loss - may contain more fraction digits than double can hold.
+		f &= ~static_cast<int>(CONV_PRECISION_LOSS);
 	}
-	else if (std::modf(val,&intVal) != 0)
+
+	checkConversionResultOrThrow(f);
+}
+
+bool JsonParser::getStringData(const JValue& value, const char*& data, size_t& length)
+{
+	if (!value.isString())
 	{
-		f |= CONV_PRECISION_LOSS;
+		return false;
 	}
 
-	checkConversionResultOrThrow(f);
-	destination = static_cast<uint64_t>(intVal);
+	raw_buffer text = jstring_get_fast(value.peekRaw());
+	data = text.m_str;
+	length = static_cast<size_t>(text.m_len);
+	return true;
+}
+
+/* Bulk numeric array decoding */
+
+/**
+ * Widest type a numeric array element is decoded to before narrowing to the destination type.
+ */
+template<typename T> struct WideNumber { typedef int64_t type; };
+template<> struct WideNumber<uint64_t> { typedef uint64_t type; };
+template<> struct WideNumber<float> { typedef double type; };
+template<> struct WideNumber<double> { typedef double type; };
+
+/**
+ * Decodes single array element to integer, without throwing.
+ * @return CONV_OK or conversion error flags.
+ */
+template<typename W>
+static ConversionResultFlags decodeElement(jvalue_ref element, W& destination)
+{
+	raw_buffer text;
+
+	if (jis_number(element))
+	{
+		if (likely(jnumber_get_raw(element, &text) == CONV_OK))
+		{
+			return decodeInteger(text.m_str, static_cast<size_t>(text.m_len), destination);
+		}
+
+		// Created from a C++ number
+		int64_t val = 0;
+		ConversionResultFlags f = jnumber_get_i64(element, &val);
+		return f == CONV_OK ? narrowInteger(val, destination) : f;
+	}
+	else if (jis_string(element))
+	{
+		text = jstring_get_fast(element);
+		return decodeInteger(text.m_str, static_cast<size_t>(text.m_len), destination);
+	}
+
+	return CONV_NOT_A_NUM;
 }
 
 template<>
-void JsonParser::parseValue<double>(const JValue& value,
-                        double& destination)
+ConversionResultFlags decodeElement<double>(jvalue_ref element, double& destination)
 {
-	ConversionResultFlags f = asNumber(value, destination);
-	// Ignore precision loss - may contain more fraction digits than double can hold.
-	f &= ~static_cast<int>(CONV_PRECISION_LOSS);
-	checkConversionResultOrThrow(f);
+	raw_buffer text;
+
+	if (jis_number(element))
+	{
+		if (likely(jnumber_get_raw(element, &text) == CONV_OK))
+		{
+			return decodeDouble(text.m_str, static_cast<size_t>(text.m_len), destination);
+		}
+
+		// Created from a C++ number, ignore precision loss like parseValue<double>
+		return jnumber_get_f64(element, &destination) & ~static_cast<int>(CONV_PRECISION_LOSS);
+	}
+	else if (jis_string(element))
+	{
+		text = jstring_get_fast(element);
+		return decodeDouble(text.m_str, static_cast<size_t>(text.m_len), destination);
+	}
+
+	return CONV_NOT_A_NUM;
+}
+
+/**
+ * Checks that all values of the block fit into T.
+ * Branch free min/max reduction, so the compiler can vectorize it.
+ * @return index of first value out of range or count if all fit.
+ */
+template<typename T, typename W>
+static size_t checkRange(const W* values, size_t count)
+{
+	if (std::is_same<T, W>::value)
+	{
+		return count;
+	}
+
+	W low = std::numeric_limits<W>::max();
+	W high = std::numeric_limits<W>::lowest();
+	for (size_t i = 0; i < count; i++)
+	{
+		low = values[i] < low ? values[i] : low;
+		high = values[i] > high ? values[i] : high;
+	}
+
+	const W lowest = static_cast<W>(std::numeric_limits<T>::lowest());
+	const W highest = static_cast<W>(std::numeric_limits<T>::max());
+	if (likely(low >= lowest && high <= highest))
+	{
+		return count;
+	}
+
+	size_t i = 0;
+	while (values[i] >= lowest && values[i] <= highest)
+	{
+		i++;
+	}
+	return i;
+}
+
+bool JsonParser::getArrayValue(const char* name, JValue& array, bool& valueRead, bool& isNull)
+{
+	get(name, array).optional().checkValueRead(valueRead);
+
+	if (!valueRead)
+	{
+		return false;
+	}
+
+	isNull = array.isNull();
+	if (isNull)
+	{
+		return false;
+	}
+
+	if (!array.isArray())
+	{
+		recordError(name, ParseErrorCode::InvalidValue, "array expected but did not get one.");
+		return false;
+	}
+
+	return true;
+}
+
+template<typename T>
+bool JsonParser::decodeNumericArray(const char* name, const JValue& array, T* destination)
+{
+	typedef typename WideNumber<T>::type W;
+	static const size_t BLOCK_SIZE = 256;
+
+	jvalue_ref raw = array.peekRaw();
+	const size_t size = static_cast<size_t>(array.arraySize());
+	W block[BLOCK_SIZE];
+
+	for (size_t start = 0; start < size; start += BLOCK_SIZE)
+	{
+		const size_t count = std::min(BLOCK_SIZE, size - start);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			ConversionResultFlags f = decodeElement(jarray_get(raw, static_cast<ssize_t>(start + i)), block[i]);
+			if (unlikely(f != CONV_OK))
+			{
+				recordError(ParseDiagnostic(CONV_HAS_OVERFLOW(f) ? ParseErrorCode::OutOfRange : ParseErrorCode::InvalidValue,
+				                            name, conversionErrorMessage(f), (ssize_t)(start + i)));
+				return false;
+			}
+		}
+
+		size_t valid = checkRange<T>(block, count);
+		if (unlikely(valid != count))
+		{
+			recordError(ParseDiagnostic(ParseErrorCode::OutOfRange, name, "value out of bounds", (ssize_t)(start + valid)));
+			return false;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[start + i] = static_cast<T>(block[i]);
+		}
+	}
+
+	return true;
 }
 
+template bool JsonParser::decodeNumericArray<int8_t>(const char*, const JValue&, int8_t*);
+template bool JsonParser::decodeNumericArray<uint8_t>(const char*, const JValue&, uint8_t*);
+template bool JsonParser::decodeNumericArray<int16_t>(const char*, const JValue&, int16_t*);
+template bool JsonParser::decodeNumericArray<uint16_t>(const char*, const JValue&, uint16_t*);
+template bool JsonParser::decodeNumericArray<int32_t>(const char*, const JValue&, int32_t*);
+template bool JsonParser::decodeNumericArray<uint32_t>(const char*, const JValue&, uint32_t*);
+template bool JsonParser::decodeNumericArray<int64_t>(const char*, const JValue&, int64_t*);
+template bool JsonParser::decodeNumericArray<uint64_t>(const char*, const JValue&, uint64_t*);
+template bool JsonParser::decodeNumericArray<float>(const char*, const JValue&, float*);
+template bool JsonParser::decodeNumericArray<double>(const char*, const JValue&, double*);
+
 template<>
 void JsonParser::parseValue<bool>(const JValue& value, bool& destination)
 {
@@ -264,6 +491,54 @@ void JsonParser::parseValue<std::string>(const JValue& value,
 	checkConversionResultOrThrow(f);
 }
 
+template<>
+void JsonParser::parseValue<ArenaString>(const JValue& value,
+                             ArenaString& destination)
+{
+	const char* data;
+	size_t length;
+
+	if (!getStringData(value, data, length))
+	{
+		throw JsonParseError("not a string");
+	}
+
+	destination.assign(data, length);
+}
+
+template<>
+void JsonParser::parseValue<StringRef>(const JValue& value,
+                           StringRef& destination)
+{
+	const char* data;
+	size_t length;
+
+	if (!getStringData(value, data, length))
+	{
+		throw JsonParseError("not a string");
+	}
+
+	destination = StringRef(data, length);
+}
+
+template<>
+void JsonParser::parseValue<InternedString>(const JValue& value,
+                                InternedString& destination)
+{
+	const char* data;
+	size_t length;
+
+	if (!getStringData(value, data, length))
+	{
+		throw JsonParseError("not a string");
+	}
+
+	if (!InternedString::tryIntern(StringRef(data, length), destination))
+	{
+		throw JsonParseError("too many distinct string values");
+	}
+}
+
 template<>
 void JsonParser::parseValue<JsonDataObject>(const JValue& value,
                                 JsonDataObject& destination)
@@ -283,6 +558,23 @@ void JsonParser::parseValue<JValue>(const JValue& value,
 	destination = value;
 }
 
+void JsonParser::parsePending() const
+{
+	const char* json = _pendingJson;
+	_pendingJson = nullptr;
+
+	_jsonValue = JDomParser::fromString(json, JSchema::AllSchema());
+
+	if (!_jsonValue.isValid())
+	{
+		LOG_ERROR(MSGID_LS_JSON_PARSE_ERROR, 0,
+		          "Failed to parse JSON: %s, error: %s",
+		          json,
+		          _jsonValue.errorString().c_str());
+		_diagnostics.emplace_back(ParseErrorCode::MalformedJson, "", "Malformed JSON.");
+	}
+}
+
 JsonParser JsonParser::getObject(const char* name)
 {
 	pbnjson::JValue obj;
@@ -290,7 +582,7 @@ JsonParser JsonParser::getObject(const char* name)
 
 	if (!obj.isObject())
 	{
-		recordError(name, "object expected but got something else");
+		recordError(name, ParseErrorCode::InvalidValue, "object expected but got something else");
 		return JsonParser(pbnjson::JValue());
 	}
 
@@ -299,12 +591,21 @@ JsonParser JsonParser::getObject(const char* name)
 
 bool JsonParser::finishParse(bool strict)
 {
+	ensureParsed();
+
 	if (strict && this->_numberOfFields != _jsonValue.objectSize())
 	{
-		recordError("", "unexpected fields in strict mode");
+		recordError("", ParseErrorCode::UnexpectedFields, "unexpected fields in strict mode");
+	}
+
+	if (!_diagnostics.empty())
+	{
+		LOG_LS_WARNING(MSGID_LS_JSON_PARSE_ERROR, 0, "%s (%zu errors)",
+		               _diagnostics.front().toString().c_str(), _diagnostics.size());
+		return false;
 	}
 
-	return !hasError();
+	return true;
 }
 
 void JsonParser::finishParseOrThrow(bool strict)
@@ -313,7 +614,7 @@ void JsonParser::finishParseOrThrow(bool strict)
 
 	if (hasError())
 	{
-		throw JsonParseError(_parseError);
+		throw JsonParseError("%s", getError().c_str());
 	}
 }
 
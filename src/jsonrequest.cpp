@@ -14,7 +14,9 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <cstring>
 #include <errno.h>
+#include <new>
 #include <sstream>
 
 #include "util.hpp"
@@ -25,11 +27,24 @@ using namespace pbnjson;
 
 namespace LSHelpers {
 
+// Main loop for responses to requests handled on this thread.
+static thread_local GMainContext* tResponseContext = nullptr;
+
+struct PendingResponse
+{
+	LS::Message message;
+	std::string payload;
+};
+
 JsonRequest::JsonRequest(const LS::Message& message, const pbnjson::JValue params)
 		: JsonParser(params)
 		, mMessage(message)
+		, mResponseContext(tResponseContext)
+		, mStartUs(0)
+		, mTrace()
 		, mDeferred(false)
 		, mResponded(false)
+		, mRespondedDirectly(false)
 {
 
 }
@@ -40,60 +55,246 @@ JsonRequest::~JsonRequest()
 	{
 		respond(API_ERROR_NO_RESPONSE);
 	}
+	finishTrace();
+	complete();
 }
 
-bool JsonRequest::handleLunaCall(LSMessage* msg, const JsonRequest::Handler& handler, const JSchema& schema)
+bool JsonRequest::handleLunaCall(LSMessage* msg,
+                                 const JsonRequest::Handler& handler,
+                                 const JSchema& schema,
+                                 PayloadCache* cache,
+                                 bool useArena,
+                                 ValidationPolicy* policy,
+                                 const PayloadOffload* offload)
 {
 	LS::Message message{msg};
 
-	try
+	const JSchema& validationSchema = policy ? policy->selectSchema(schema, message.getSenderServiceName()) : schema;
+	DispatchOptions options;
+	JValue value = parsePayload(message, validationSchema, cache, policy, nullptr, &options.trace);
+	if (unlikely(!value.isValid()))
+	{
+		return true;
+	}
+
+	options.useArena = useArena;
+	options.offload = offload;
+	return dispatch(message, value, handler, options);
+}
+
+// Start the request span, continuing the trace of the caller if it has one.
+static void startTrace(LS::Message& message, const TraceContext& caller, Span& trace)
+{
+	std::string name = message.getCategory();
+	if (name.empty() || name.back() != '/')
+	{
+		name += '/';
+	}
+	name += message.getMethod();
+
+	trace = Span{InternedString::intern(name).c_str(),
+	             SpanKind::Request,
+	             caller ? caller.traceId : Tracer::newId(),
+	             Tracer::newId(),
+	             caller.spanId,
+	             0,
+	             MethodMetrics::nowUs(),
+	             0};
+}
+
+JValue JsonRequest::parsePayload(LS::Message& message,
+                                 const JSchema& schema,
+                                 PayloadCache* cache,
+                                 ValidationPolicy* policy,
+                                 int32_t* errorCode,
+                                 Span* trace)
+{
+	const char* payload = message.getPayload();
+
+	// Calls from traced services carry the trace context, it is not part of the method API.
+	TraceContext caller;
+	std::string stripped;
+	if (unlikely(Tracer::extract(payload, caller, stripped)))
+	{
+		payload = stripped.c_str();
+	}
+
+	TraceContext parent;
+	if (unlikely(trace && Tracer::isEnabled()))
+	{
+		startTrace(message, caller, *trace);
+		parent = TraceContext{trace->traceId, trace->spanId};
+	}
+
+	JValue value;
+	{
+		ScopedSpan span(SpanKind::Parse, nullptr, parent);
+		span.setRemoteParent(caller.spanId);
+		value = cache ? cache->parse(payload, schema) : JDomParser::fromString(payload, schema);
+	}
+
+	if (unlikely(!value.isValid()))
 	{
-		const char* payload = message.getPayload();
-		JValue value = JDomParser::fromString(payload, schema);
+		//Figure out if the Josn is invalid or just does not validate against the schema.
+		JValue unvalidated = JDomParser::fromString(payload, JSchema::AllSchema());
 
-		if (unlikely(!value.isValid()))
+		if (unvalidated.isValid() && policy && policy->isMonitoring())
 		{
-			LOG_ERROR(MSGID_LS_CALL_JSON_PARSE_FAILED, 0,
-			             "Failed to validate luna request against schema: %s, error: %s",
-			             payload,
-			             value.errorString().c_str());
+			// Sampled validation only monitors the callers, handle the request anyway.
+			policy->recordFailure();
+			LOG_LS_WARNING(MSGID_LS_SAMPLED_VALIDATION_FAILED, 0,
+			               "Sampled luna request failed schema validation: %s, error: %s",
+			               payload,
+			               value.errorString().c_str());
+			return unvalidated;
+		}
 
-			//Figure out if the Josn is invalid or just does not validate against the schema.
-			if (!JDomParser::fromString(payload, JSchema::AllSchema()).isValid())
+		LOG_ERROR(MSGID_LS_CALL_JSON_PARSE_FAILED, 0,
+		             "Failed to validate luna request against schema: %s, error: %s",
+		             payload,
+		             value.errorString().c_str());
+
+		//Respond directly, invalid requests should not cost an exception.
+		if (!unvalidated.isValid())
+		{
+			if (errorCode)
 			{
-				throw API_ERROR_MALFORMED_JSON;
+				*errorCode = API_ERROR_CODE_MALFORMED_JSON;
 			}
-			else
+			sendResponse(message, API_ERROR_MALFORMED_JSON.stringify().c_str(), tResponseContext);
+		}
+		else
+		{
+			if (policy)
+			{
+				policy->recordFailure();
+			}
+			if (errorCode)
 			{
-				throw API_ERROR_SCHEMA_VALIDATION( "Failed to validate luna request against schema");
+				*errorCode = API_ERROR_CODE_SCHEMA_VALIDATION;
 			}
+			sendResponse(message,
+			             API_ERROR_SCHEMA_VALIDATION("Failed to validate luna request against schema").stringify().c_str(),
+			             tResponseContext);
 		}
 
-		std::shared_ptr<JsonRequest> request( new JsonRequest{message, value} );
+		if (unlikely(parent))
+		{
+			trace->durationUs = MethodMetrics::nowUs() - trace->startUs;
+			Tracer::record(*trace);
+		}
+	}
+
+	return value;
+}
+
+// Error code of a response object, if it is an error response.
+static bool getErrorCode(const JValue& response, int32_t& code)
+{
+	JValue returnValue = response["returnValue"];
+	if (!returnValue.isBoolean() || returnValue.asBool())
+	{
+		return false;
+	}
+
+	JValue errorCode = response["errorCode"];
+	code = errorCode.isNumber() ? errorCode.asNumber<int32_t>() : -1;
+	return true;
+}
+
+bool JsonRequest::dispatch(LS::Message& message,
+                           const JValue& value,
+                           const JsonRequest::Handler& handler,
+                           const DispatchOptions& options)
+{
+	MethodMetrics* metrics = options.metrics.get();
+
+	try
+	{
+		std::shared_ptr<JsonRequest> request;
+		if (options.useArena)
+		{
+			// Place the request in its own arena. The arena is released after the request is destroyed.
+			Arena::Ptr arena = Arena::acquire();
+			void* memory = arena->allocate(sizeof(JsonRequest), alignof(JsonRequest));
+			JsonRequest* raw = new (memory) JsonRequest{message, value};
+			raw->mArena = std::move(arena);
+
+			request.reset(raw, [](JsonRequest* r)
+			{
+				Arena::Ptr requestArena = std::move(r->mArena);
+				r->~JsonRequest();
+			});
+		}
+		else
+		{
+			request.reset(new JsonRequest{message, value});
+		}
 		request->mWeakPtr = request;
 		request->mResponded = true; // For the exception cases
+		if (options.offload)
+		{
+			request->mOffload = *options.offload;
+		}
+		if (options.onComplete)
+		{
+			request->mOnComplete = options.onComplete;
+		}
 
-		JValue result = handler(*request.get());
+		if (unlikely(metrics))
+		{
+			request->mMetrics = options.metrics;
+			request->mStartUs = options.startUs;
+		}
 
-		if (!request->mDeferred)
+		uint64_t handlerStartUs = unlikely(metrics) ? MethodMetrics::nowUs() : 0;
+		JValue result;
+		if (unlikely(options.trace.traceId))
 		{
-			request->respond(result);
+			request->mTrace = options.trace;
+
+			// Calls made by the handler are children of the handler span.
+			ScopedSpan span(SpanKind::Handler, options.trace.name, request->getTraceContext());
+			TraceScope scope(span.getContext());
+			result = handler(*request.get());
 		}
 		else
 		{
-			request->mResponded = false;
+			result = handler(*request.get());
+		}
+		if (unlikely(metrics))
+		{
+			metrics->handlerUs.record(MethodMetrics::nowUs() - handlerStartUs);
+		}
+
+		if (request->mDeferred)
+		{
+			request->mResponded = request->mRespondedDirectly;
+		}
+		else if (!request->mRespondedDirectly)
+		{
+			request->respond(result);
 		}
 
 		return true;
 	}
 	catch (const JsonParseError& e)
 	{
-		message.respond(API_ERROR_SCHEMA_VALIDATION(e.what()).stringify().c_str());
+		if (unlikely(metrics))
+		{
+			metrics->recordError(API_ERROR_CODE_SCHEMA_VALIDATION);
+		}
+		sendResponse(message, API_ERROR_SCHEMA_VALIDATION(std::string(e.what())).stringify().c_str(), tResponseContext);
 		return true;
 	}
 	catch (ErrorResponse& e)
 	{
-		message.respond(e.stringify().c_str());
+		int32_t code;
+		if (unlikely(metrics) && getErrorCode(e, code))
+		{
+			metrics->recordError(code);
+		}
+		sendResponse(message, e.stringify().c_str(), tResponseContext);
 		return true;
 	}
 	catch (const std::exception& e)
@@ -132,8 +333,25 @@ JsonRequest::DeferredResponseFunction JsonRequest::defer()
 	};
 }
 
+Arena& JsonRequest::getArena()
+{
+	if (!mArena)
+	{
+		mArena = Arena::acquire();
+	}
+
+	return *mArena;
+}
+
+ErrorResponse JsonRequest::getErrorResponse() const
+{
+	return API_ERROR_SCHEMA_VALIDATION(getError());
+}
+
 void JsonRequest::respond(const pbnjson::JValue& response)
 {
+	ScopedSpan span(SpanKind::Respond, nullptr, getTraceContext());
+
 	// Get away from const, this is reference counted pointer, no copying.
 	JValue result = response;
 
@@ -142,8 +360,9 @@ void JsonRequest::respond(const pbnjson::JValue& response)
 		if (result.isBoolean() && result.asBool())
 		{
 			// This is just a "true", converted to JValue.
-			// Replace with a basic {"returnValue":true}.
-			result = JObject{{"returnValue", true}};
+			// Send a basic {"returnValue":true}, no need to build the object.
+			respond("{\"returnValue\":true}");
+			return;
 		}
 		else
 		{
@@ -153,8 +372,174 @@ void JsonRequest::respond(const pbnjson::JValue& response)
 		}
 	}
 
-	mMessage.respond(result.stringify().c_str());
+	int32_t code;
+	if (unlikely(mMetrics) && getErrorCode(result, code))
+	{
+		mMetrics->recordError(code);
+	}
+
+	if (unlikely(mOffload.pool) && respondOffloaded(result, mOffload.isLarge(result)))
+	{
+		return;
+	}
+
+	respond(result.stringify().c_str());
+}
+
+bool JsonRequest::respondOffloaded(const pbnjson::JValue& response, bool large)
+{
+	std::shared_ptr<JsonRequest> self = mWeakPtr.lock();
+	if (!self || (!large && !mOffloaded))
+	{
+		return false;
+	}
+
+	if (!mOffloaded)
+	{
+		// From now on all responses are queued to the main loop, behind the offloaded ones.
+		mOffloaded.reset(new OrderedOffload());
+		if (!mResponseContext)
+		{
+			mResponseContext = LSGmainGetContext(LSMessageGetConnection(mMessage.get()), nullptr);
+		}
+	}
+
+	// The task holds the request, the request holds the ordering state.
+	JValue result = response;
+	if (!mOffloaded->offload(mOffload, large, [self, result]() mutable
+	                         {
+		                         std::string payload = result.stringify();
+		                         if (self->mMetrics)
+		                         {
+			                         self->mMetrics->responseBytes.record(payload.size());
+		                         }
+		                         sendResponse(self->mMessage, payload.c_str(), self->mResponseContext, true);
+	                         }))
+	{
+		return false;
+	}
+
+	recordResponse(nullptr);
+	mResponded = true;
+	complete();
+	return true;
+}
+
+void JsonRequest::respond(const JsonWriter& response)
+{
+	ScopedSpan span(SpanKind::Respond, nullptr, getTraceContext());
+	respond(response.c_str());
+	mRespondedDirectly = true;
+}
+
+JsonWriter& JsonRequest::getResponseWriter()
+{
+	static thread_local JsonWriter writer;
+	writer.clear();
+	return writer;
+}
+
+void JsonRequest::respond(const char* payload)
+{
+	if (unlikely(mOffloaded))
+	{
+		std::shared_ptr<JsonRequest> self = mWeakPtr.lock();
+		std::string copy = payload;
+		if (!self || !mOffloaded->offload(mOffload, false, [self, copy]()
+		                                  {
+			                                  sendResponse(self->mMessage, copy.c_str(), self->mResponseContext, true);
+		                                  }))
+		{
+			sendResponse(mMessage, payload, mResponseContext, true);
+		}
+		recordResponse(payload);
+		mResponded = true;
+		complete();
+		return;
+	}
+
+	sendResponse(mMessage, payload, mResponseContext);
+	recordResponse(payload);
 	mResponded = true;
+	complete();
+}
+
+void JsonRequest::recordResponse(const char* payload)
+{
+	if (unlikely(mMetrics))
+	{
+		if (mStartUs)
+		{
+			mMetrics->respondUs.record(MethodMetrics::nowUs() - mStartUs);
+			mStartUs = 0;
+		}
+		if (payload)
+		{
+			mMetrics->responseBytes.record(strlen(payload));
+		}
+	}
+	finishTrace();
+}
+
+void JsonRequest::finishTrace()
+{
+	if (unlikely(mTrace.startUs))
+	{
+		mTrace.durationUs = MethodMetrics::nowUs() - mTrace.startUs;
+		Tracer::record(mTrace);
+		mTrace.startUs = 0;
+	}
+}
+
+void JsonRequest::complete()
+{
+	if (unlikely(mOnComplete))
+	{
+		std::function<void()> onComplete = std::move(mOnComplete);
+		mOnComplete = nullptr;
+		onComplete();
+	}
+}
+
+void JsonRequest::setThreadResponseContext(GMainContext* context)
+{
+	tResponseContext = context;
+}
+
+void JsonRequest::sendResponse(LS::Message& message, const char* payload, GMainContext* context, bool queued)
+{
+	if (!context || (!queued && g_main_context_is_owner(context)))
+	{
+		message.respond(payload);
+		return;
+	}
+
+	// Same as subscription posts - send from the main loop, responses are dispatched in order.
+	std::unique_ptr<PendingResponse> response(new PendingResponse{message, payload});
+
+	GSource* source = g_timeout_source_new(0);
+	g_source_set_callback(source,
+	                      [](gpointer data) -> gboolean
+	                      {
+		                      PendingResponse* response = static_cast<PendingResponse*>(data);
+		                      try
+		                      {
+			                      response->message.respond(response->payload.c_str());
+		                      }
+		                      catch (LS::Error& e)
+		                      {
+			                      e.log(PmLogGetLibContext(), "LS_RESPONSE_FAIL");
+		                      }
+		                      return G_SOURCE_REMOVE;
+	                      },
+	                      response.release(),
+	                      [](gpointer data)
+	                      {
+		                      delete static_cast<PendingResponse*>(data);
+	                      });
+
+	g_source_attach(source, context);
+	g_source_unref(source);
 }
 
 ErrorResponse::ErrorResponse(int error_code, const char* format, ...)
@@ -14,7 +14,9 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <ctype.h>
 #include <errno.h>
+#include <string.h>
 #include <sstream>
 #include <pbnjson.hpp>
 
@@ -25,46 +27,301 @@ using namespace pbnjson;
 
 namespace LSHelpers {
 
-bool JsonResponse::handleLunaResponse(LSMessage* msg,
-                                      const JsonResponse::Handler& handler,
-                                      const pbnjson::JSchema& schema) noexcept
+static inline const char* skipWhitespace(const char* p)
 {
-	LS::Message message{msg};
+	while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+	{
+		p++;
+	}
+	return p;
+}
 
-	// Parse the message.
-	JValue payload {}; // Null by default
-	bool success;
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
 
-	if (message.isHubError())
+/**
+ * Skips a JSON string, checking escapes and UTF-8 encoding.
+ * @param p pointer to the opening quote.
+ * @return pointer past the closing quote, nullptr if the string is not valid.
+ */
+static const char* skipString(const char* p)
+{
+	for (p++; *p != '"'; p++)
 	{
-		LOG_ERROR(MSGID_LS_HUB_ERROR,
-		             0,
-		             "Hub error during luna call, method: %s, payload: %s",
-		             message.getMethod(),
-		             message.getPayload());
-		success = false;
+		unsigned char c = (unsigned char)*p;
+
+		if (c < 0x20)
+		{
+			// Control characters and the terminator.
+			return nullptr;
+		}
+		else if (c == '\\')
+		{
+			p++;
+			if (*p == 'u')
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					if (!isxdigit((unsigned char)*++p))
+					{
+						return nullptr;
+					}
+				}
+			}
+			else if (*p == '\0' || !strchr("\"\\/bfnrt", *p))
+			{
+				return nullptr;
+			}
+		}
+		else if (c >= 0x80)
+		{
+			int continuation = c >= 0xC2 && c <= 0xDF ? 1 :
+			                   c >= 0xE0 && c <= 0xEF ? 2 :
+			                   c >= 0xF0 && c <= 0xF4 ? 3 : -1;
+			if (continuation < 0)
+			{
+				return nullptr;
+			}
+			for (int i = 0; i < continuation; i++)
+			{
+				if ((*++p & 0xC0) != 0x80)
+				{
+					return nullptr;
+				}
+			}
+		}
+	}
+	return p + 1;
+}
+
+/**
+ * Skips a JSON number.
+ * @return pointer past the number, nullptr if the number is not valid.
+ */
+static const char* skipNumber(const char* p)
+{
+	if (*p == '-')
+	{
+		p++;
+	}
+
+	if (*p == '0')
+	{
+		p++;
+	}
+	else if (isDigit(*p))
+	{
+		while (isDigit(*p)) p++;
 	}
 	else
 	{
-		JValue value = JDomParser::fromString(message.getPayload(), schema);
+		return nullptr;
+	}
 
-		if (!value.isValid())
+	if (*p == '.')
+	{
+		if (!isDigit(*++p))
 		{
-			LOG_ERROR(MSGID_LS_RESPONSE_JSON_PARSE_FAILED, 0,
-			             "Failed to parse luna response to JSON: %s, error: %s",
-			             message.getPayload(),
-			             value.errorString().c_str());
-			success = false;
+			return nullptr;
 		}
-		else
+		while (isDigit(*p)) p++;
+	}
+
+	if (*p == 'e' || *p == 'E')
+	{
+		p++;
+		if (*p == '+' || *p == '-')
+		{
+			p++;
+		}
+		if (!isDigit(*p))
+		{
+			return nullptr;
+		}
+		while (isDigit(*p)) p++;
+	}
+
+	return p;
+}
+
+static inline const char* skipLiteral(const char* p, const char* literal, size_t length)
+{
+	return strncmp(p, literal, length) == 0 ? p + length : nullptr;
+}
+
+/** Nesting deeper than this is left to the full parser. */
+static const int MAX_SCAN_DEPTH = 32;
+
+static const char* skipValue(const char* p, int depth);
+
+/**
+ * Skips a JSON object or array.
+ * @param p pointer to the opening bracket.
+ * @return pointer past the closing bracket, nullptr if the value is not valid.
+ */
+static const char* skipContainer(const char* p, int depth)
+{
+	bool isObject = *p == '{';
+	char close = isObject ? '}' : ']';
+
+	p = skipWhitespace(p + 1);
+	if (*p == close)
+	{
+		return p + 1;
+	}
+
+	for (;;)
+	{
+		if (isObject)
+		{
+			if (*p != '"' || !(p = skipString(p)))
+			{
+				return nullptr;
+			}
+			p = skipWhitespace(p);
+			if (*p != ':')
+			{
+				return nullptr;
+			}
+			p = skipWhitespace(p + 1);
+		}
+
+		p = skipValue(p, depth);
+		if (!p)
+		{
+			return nullptr;
+		}
+
+		p = skipWhitespace(p);
+		if (*p == close)
 		{
-			success = true;
-			payload = value;
+			return p + 1;
 		}
+		if (*p != ',')
+		{
+			return nullptr;
+		}
+		p = skipWhitespace(p + 1);
+	}
+}
+
+/**
+ * Skips a JSON value, checking that it is valid JSON.
+ * @param p pointer to the first character of the value.
+ * @param depth nesting depth of the value.
+ * @return pointer past the value, nullptr if the value is not valid or nested too deep.
+ */
+static const char* skipValue(const char* p, int depth)
+{
+	switch (*p)
+	{
+		case '"':
+			return skipString(p);
+		case '{':
+		case '[':
+			return depth < MAX_SCAN_DEPTH ? skipContainer(p, depth + 1) : nullptr;
+		case 't':
+			return skipLiteral(p, "true", 4);
+		case 'f':
+			return skipLiteral(p, "false", 5);
+		case 'n':
+			return skipLiteral(p, "null", 4);
+		default:
+			return skipNumber(p);
 	}
+}
 
-	JsonResponse response {msg, payload, success};
+int scanReturnValue(const char* payload)
+{
+	static const char RETURN_VALUE_KEY[] = "\"returnValue\"";
+	static const size_t RETURN_VALUE_KEY_LEN = sizeof(RETURN_VALUE_KEY) - 1;
 
+	int result = -1;
+	const char* p = skipWhitespace(payload);
+	if (*p != '{')
+	{
+		return -1;
+	}
+
+	p = skipWhitespace(p + 1);
+	while (*p != '}')
+	{
+		if (*p != '"')
+		{
+			return -1;
+		}
+
+		const char* key = p;
+		p = skipString(p);
+		if (!p)
+		{
+			return -1;
+		}
+		bool isReturnValue = size_t(p - key) == RETURN_VALUE_KEY_LEN &&
+		                     memcmp(key, RETURN_VALUE_KEY, RETURN_VALUE_KEY_LEN) == 0;
+
+		// A unicode escape could spell returnValue, leave it to the full parser.
+		for (const char* c = key + 1; c + 1 < p; c++)
+		{
+			if (*c == '\\' && *++c == 'u')
+			{
+				return -1;
+			}
+		}
+
+		p = skipWhitespace(p);
+		if (*p != ':')
+		{
+			return -1;
+		}
+
+		p = skipWhitespace(p + 1);
+		const char* value = p;
+		p = skipValue(p, 1);
+		if (!p)
+		{
+			return -1;
+		}
+
+		if (isReturnValue)
+		{
+			if (p - value == 4 && memcmp(value, "true", 4) == 0)
+			{
+				result = 1;
+			}
+			else if (p - value == 5 && memcmp(value, "false", 5) == 0)
+			{
+				result = 0;
+			}
+			else
+			{
+				return -1;
+			}
+		}
+
+		p = skipWhitespace(p);
+		if (*p == ',')
+		{
+			p = skipWhitespace(p + 1);
+			if (*p != '"')
+			{
+				return -1;
+			}
+		}
+		else if (*p != '}')
+		{
+			return -1;
+		}
+	}
+
+	// Nothing but whitespace allowed after the object.
+	return *skipWhitespace(p + 1) == '\0' ? result : -1;
+}
+
+static void callHandler(const JsonResponse::Handler& handler, JsonResponse& response) noexcept
+{
 	try
 	{
 		handler(response);
@@ -81,8 +338,109 @@ bool JsonResponse::handleLunaResponse(LSMessage* msg,
 	{
 		LOG_ERROR(MSGID_LS_UNEXPECTED_EXCEPTION, 0, "Exception thrown while processing luna response handler");
 	}
+}
+
+bool JsonResponse::handleLunaResponse(LSMessage* msg,
+                                      const JsonResponse::Handler& handler,
+                                      const pbnjson::JSchema& schema,
+                                      PayloadCache* cache,
+                                      Outcome* outcome) noexcept
+{
+	LS::Message message{msg};
+	bool cached = cache && cache->isCacheable(message.getPayload());
+
+	if (message.isHubError())
+	{
+		LOG_ERROR(MSGID_LS_HUB_ERROR,
+		             0,
+		             "Hub error during luna call, method: %s, payload: %s",
+		             message.getMethod(),
+		             message.getPayload());
+
+		JsonResponse response {msg, JValue(), false};
+		callHandler(handler, response);
+		if (outcome)
+		{
+			*outcome = Outcome::HubError;
+		}
+	}
+	else if (!cached && &schema == &JSchema::AllSchema())
+	{
+		// No validation needed - defer the parse until the handler accesses the payload.
+		JsonResponse response {msg};
+		callHandler(handler, response);
+		if (outcome)
+		{
+			*outcome = response.getOutcome();
+		}
+	}
+	else
+	{
+		JValue value = cached ? cache->parse(message.getPayload(), schema)
+		                      : JDomParser::fromString(message.getPayload(), schema);
+
+		if (!value.isValid())
+		{
+			LOG_ERROR(MSGID_LS_RESPONSE_JSON_PARSE_FAILED, 0,
+			             "Failed to parse luna response to JSON: %s, error: %s",
+			             message.getPayload(),
+			             value.errorString().c_str());
+
+			JsonResponse response {msg, JValue(), false};
+			callHandler(handler, response);
+			if (outcome)
+			{
+				*outcome = Outcome::ParseError;
+			}
+		}
+		else
+		{
+			JsonResponse response {msg, value, true};
+			callHandler(handler, response);
+			if (outcome)
+			{
+				*outcome = response.getOutcome();
+			}
+		}
+	}
 
 	return true;
 }
 
+bool JsonResponse::isSuccess()
+{
+	if (mStatus == Status::Unknown)
+	{
+		int returnValue = isParsePending() ? scanReturnValue(LSMessageGetPayload(mMessage)) : -1;
+
+		if (returnValue < 0)
+		{
+			ensureParsed();
+
+			if (!_jsonValue.isValid())
+			{
+				returnValue = 0;
+			}
+			else
+			{
+				JValue result = _jsonValue.isObject() ? _jsonValue["returnValue"] : JValue();
+				returnValue = result.isBoolean() && !result.asBool() ? 0 : 1;
+			}
+		}
+
+		mStatus = returnValue ? Status::Success : Status::Failure;
+	}
+
+	return mStatus == Status::Success;
+}
+
+JsonResponse::Outcome JsonResponse::getOutcome()
+{
+	if (isSuccess())
+	{
+		return Outcome::Success;
+	}
+	return !isParsePending() && !_jsonValue.isValid() ? Outcome::ParseError : Outcome::Error;
+}
+
 } // namespace LSHelpers;
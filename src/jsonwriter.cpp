@@ -0,0 +1,260 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "jsonwriter.hpp"
+
+namespace LSHelpers {
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/**
+ * @return true if the character must be escaped in a JSON string.
+ */
+static inline bool needsEscape(unsigned char c)
+{
+	return c < 0x20 || c == '"' || c == '\\';
+}
+
+JsonWriter::JsonWriter(size_t capacity)
+		: mNeedComma(false)
+{
+	mBuffer.reserve(capacity);
+}
+
+void JsonWriter::clear()
+{
+	mBuffer.clear();
+	mNeedComma = false;
+}
+
+JsonWriter& JsonWriter::beginObject()
+{
+	separate();
+	mBuffer.push_back('{');
+	mNeedComma = false;
+	return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+	mBuffer.push_back('}');
+	mNeedComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::beginArray()
+{
+	separate();
+	mBuffer.push_back('[');
+	mNeedComma = false;
+	return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+	mBuffer.push_back(']');
+	mNeedComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::key(const StringRef& name)
+{
+	separate();
+	writeString(name.data(), name.size());
+	mBuffer.push_back(':');
+	mNeedComma = false; // The value follows the key without a comma.
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(bool value)
+{
+	separate();
+	if (value)
+	{
+		mBuffer.append("true", 4);
+	}
+	else
+	{
+		mBuffer.append("false", 5);
+	}
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* value)
+{
+	if (!value)
+	{
+		return null();
+	}
+
+	separate();
+	writeString(value, strlen(value));
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& value)
+{
+	separate();
+	writeString(value.data(), value.size());
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const StringRef& value)
+{
+	separate();
+	writeString(value.data(), value.size());
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(double value)
+{
+	if (!std::isfinite(value))
+	{
+		return null();
+	}
+
+	separate();
+
+	// Use the shortest precision that reads back exactly, 17 digits always do.
+	char buffer[32];
+	int length = 0;
+	for (int precision = 15; precision <= 17; precision++)
+	{
+		length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+		if (precision == 17 || strtod(buffer, nullptr) == value)
+		{
+			break;
+		}
+	}
+
+	// Some locales use decimal comma.
+	for (int i = 0; i < length; i++)
+	{
+		if (buffer[i] == ',')
+		{
+			buffer[i] = '.';
+		}
+	}
+
+	mBuffer.append(buffer, length);
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const pbnjson::JValue& value)
+{
+	separate();
+	// Shallow copy to remove const, stringify is not const.
+	pbnjson::JValue local = value;
+	mBuffer.append(local.stringify());
+	return *this;
+}
+
+JsonWriter& JsonWriter::null()
+{
+	separate();
+	mBuffer.append("null", 4);
+	return *this;
+}
+
+JsonWriter& JsonWriter::raw(const StringRef& json)
+{
+	separate();
+	mBuffer.append(json.data(), json.size());
+	return *this;
+}
+
+void JsonWriter::writeString(const char* str, size_t length)
+{
+	mBuffer.reserve(mBuffer.size() + length + 2);
+	mBuffer.push_back('"');
+
+	// Copy runs of characters that do not need escaping in one go.
+	size_t runStart = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		unsigned char c = static_cast<unsigned char>(str[i]);
+		if (!needsEscape(c))
+		{
+			continue;
+		}
+
+		mBuffer.append(str + runStart, i - runStart);
+		runStart = i + 1;
+
+		switch (c)
+		{
+			case '"': mBuffer.append("\\\"", 2); break;
+			case '\\': mBuffer.append("\\\\", 2); break;
+			case '\b': mBuffer.append("\\b", 2); break;
+			case '\f': mBuffer.append("\\f", 2); break;
+			case '\n': mBuffer.append("\\n", 2); break;
+			case '\r': mBuffer.append("\\r", 2); break;
+			case '\t': mBuffer.append("\\t", 2); break;
+			default:
+			{
+				char escape[6] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF]};
+				mBuffer.append(escape, sizeof(escape));
+			}
+		}
+	}
+
+	mBuffer.append(str + runStart, length - runStart);
+	mBuffer.push_back('"');
+}
+
+JsonWriter& JsonWriter::writeInt(int64_t value)
+{
+	separate();
+	if (value < 0)
+	{
+		mBuffer.push_back('-');
+		// Negate in unsigned, INT64_MIN has no positive counterpart.
+		appendDigits(0 - static_cast<uint64_t>(value));
+	}
+	else
+	{
+		appendDigits(static_cast<uint64_t>(value));
+	}
+	return *this;
+}
+
+JsonWriter& JsonWriter::writeUInt(uint64_t value)
+{
+	separate();
+	appendDigits(value);
+	return *this;
+}
+
+void JsonWriter::appendDigits(uint64_t value)
+{
+	char buffer[20];
+	char* end = buffer + sizeof(buffer);
+	char* start = end;
+	do
+	{
+		*--start = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value);
+
+	mBuffer.append(start, end - start);
+}
+
+} // namespace LSHelpers
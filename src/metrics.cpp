@@ -0,0 +1,182 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <chrono>
+
+#include "metrics.hpp"
+
+using namespace pbnjson;
+
+namespace LSHelpers {
+
+const uint32_t Histogram::SUB_BUCKET_BITS;
+const uint32_t Histogram::SUB_BUCKETS;
+const uint32_t Histogram::MAX_VALUE_BITS;
+const uint32_t Histogram::BUCKETS;
+
+Histogram::Histogram()
+		: mCount(0)
+		, mSum(0)
+		, mMax(0)
+{
+	for (auto& bucket : mBuckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+uint32_t Histogram::bucketIndex(uint64_t value)
+{
+	if (value < SUB_BUCKETS)
+	{
+		return static_cast<uint32_t>(value);
+	}
+
+	// Position of the highest bit selects the power of two range, the next bits the sub bucket.
+	uint32_t highBit = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+	if (highBit >= MAX_VALUE_BITS)
+	{
+		return BUCKETS - 1;
+	}
+	uint32_t shift = highBit - SUB_BUCKET_BITS;
+	return (shift + 1) * SUB_BUCKETS + static_cast<uint32_t>((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t Histogram::bucketLimit(uint32_t index)
+{
+	if (index < SUB_BUCKETS)
+	{
+		return index;
+	}
+
+	uint32_t shift = index / SUB_BUCKETS - 1;
+	uint64_t subBucket = index % SUB_BUCKETS;
+	return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+	mBuckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	mCount.fetch_add(1, std::memory_order_relaxed);
+	mSum.fetch_add(value, std::memory_order_relaxed);
+
+	uint64_t max = mMax.load(std::memory_order_relaxed);
+	while (value > max && !mMax.compare_exchange_weak(max, value, std::memory_order_relaxed))
+	{
+	}
+}
+
+uint64_t Histogram::getCount() const
+{
+	return mCount.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getMax() const
+{
+	return mMax.load(std::memory_order_relaxed);
+}
+
+double Histogram::getMean() const
+{
+	uint64_t count = getCount();
+	return count ? double(mSum.load(std::memory_order_relaxed)) / count : 0;
+}
+
+uint64_t Histogram::getPercentile(double percentile) const
+{
+	uint64_t count = getCount();
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	uint64_t rank = static_cast<uint64_t>(percentile / 100 * count + 0.5);
+	rank = rank < 1 ? 1 : (rank > count ? count : rank);
+
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < BUCKETS; i++)
+	{
+		seen += mBuckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			// The bucket limit may overshoot the largest value.
+			uint64_t limit = bucketLimit(i);
+			uint64_t max = getMax();
+			return limit < max ? limit : max;
+		}
+	}
+	return getMax();
+}
+
+JValue Histogram::toJson() const
+{
+	return JObject{{"count", int64_t(getCount())},
+	               {"mean", getMean()},
+	               {"p50", int64_t(getPercentile(50))},
+	               {"p90", int64_t(getPercentile(90))},
+	               {"p99", int64_t(getPercentile(99))},
+	               {"max", int64_t(getMax())}};
+}
+
+uint64_t MethodMetrics::nowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void MethodMetrics::recordError(int32_t code)
+{
+	std::lock_guard<std::mutex> lock(mErrorsMutex);
+	mErrors[code]++;
+}
+
+std::map<int32_t, uint64_t> MethodMetrics::getErrors() const
+{
+	std::lock_guard<std::mutex> lock(mErrorsMutex);
+	return mErrors;
+}
+
+JValue MethodMetrics::toJson() const
+{
+	JObject errors;
+	for (const auto& error : getErrors())
+	{
+		errors.put(std::to_string(error.first), int64_t(error.second));
+	}
+
+	return JObject{{"calls", int64_t(calls.load(std::memory_order_relaxed))},
+	               {"errors", errors},
+	               {"parseUs", parseUs.toJson()},
+	               {"handlerUs", handlerUs.toJson()},
+	               {"respondUs", respondUs.toJson()},
+	               {"requestBytes", requestBytes.toJson()},
+	               {"responseBytes", responseBytes.toJson()}};
+}
+
+JValue CallMetrics::toJson() const
+{
+	return JObject{{"calls", int64_t(calls.load(std::memory_order_relaxed))},
+	               {"replies", int64_t(replies.load(std::memory_order_relaxed))},
+	               {"errors", int64_t(errors.load(std::memory_order_relaxed))},
+	               {"hubErrors", int64_t(hubErrors.load(std::memory_order_relaxed))},
+	               {"parseErrors", int64_t(parseErrors.load(std::memory_order_relaxed))},
+	               {"cancelled", int64_t(cancelled.load(std::memory_order_relaxed))},
+	               {"slow", int64_t(slow.load(std::memory_order_relaxed))},
+	               {"roundTripUs", roundTripUs.toJson()},
+	               {"updateIntervalUs", updateIntervalUs.toJson()}};
+}
+
+} // namespace LSHelpers
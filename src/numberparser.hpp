@@ -0,0 +1,312 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <pbnjson.hpp>
+
+namespace LSHelpers {
+
+/**
+ * Positions of the parts of a decimal number in numeric text.
+ * [-]int[.frac][e[+-]exp]
+ */
+struct NumberText
+{
+	bool negative;
+	const char* intBegin;
+	const char* intEnd;
+	const char* fracBegin;
+	const char* fracEnd;
+	int32_t exponent;
+};
+
+/**
+ * Splits numeric text into parts. Accepts JSON number syntax, plus leading + and leading zeros.
+ * @param str text to scan, does not need to be null terminated.
+ * @param len length of the text.
+ * @param number output.
+ * @return true if the whole text is a number.
+ */
+inline bool scanNumber(const char* str, size_t len, NumberText& number)
+{
+	const char* p = str;
+	const char* end = str + len;
+
+	number.negative = false;
+	if (p != end && (*p == '-' || *p == '+'))
+	{
+		number.negative = *p == '-';
+		p++;
+	}
+
+	number.intBegin = p;
+	while (p != end && unsigned(*p - '0') < 10u)
+	{
+		p++;
+	}
+	number.intEnd = p;
+
+	number.fracBegin = number.fracEnd = p;
+	if (p != end && *p == '.')
+	{
+		number.fracBegin = ++p;
+		while (p != end && unsigned(*p - '0') < 10u)
+		{
+			p++;
+		}
+		number.fracEnd = p;
+
+		if (number.fracBegin == number.fracEnd)
+		{
+			return false;
+		}
+	}
+
+	if (number.intBegin == number.intEnd)
+	{
+		return false;
+	}
+
+	number.exponent = 0;
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool negativeExponent = false;
+		if (p != end && (*p == '-' || *p == '+'))
+		{
+			negativeExponent = *p == '-';
+			p++;
+		}
+
+		if (p == end)
+		{
+			return false;
+		}
+
+		int32_t exponent = 0;
+		while (p != end && unsigned(*p - '0') < 10u)
+		{
+			// Clamp, anything this large over- or underflows any destination type.
+			if (exponent < 100000)
+			{
+				exponent = exponent * 10 + (*p - '0');
+			}
+			p++;
+		}
+		number.exponent = negativeExponent ? -exponent : exponent;
+	}
+
+	return p == end;
+}
+
+/**
+ * Decodes numeric text to an integer. Exact over the whole range of the destination type.
+ * Fractional values are accepted only if the fraction is zero, e.g "2.0" or "1.5e1".
+ * @param str text to decode, does not need to be null terminated.
+ * @param len length of the text.
+ * @param destination set to the value if the result is CONV_OK.
+ * @return CONV_OK or the pbnjson conversion error flags.
+ */
+template<typename T>
+ConversionResultFlags decodeInteger(const char* str, size_t len, T& destination)
+{
+	static_assert(std::is_integral<T>::value, "integer type expected");
+
+	NumberText number;
+	if (!scanNumber(str, len, number))
+	{
+		return CONV_NOT_A_NUM;
+	}
+
+	// Digits before the decimal point, after applying the exponent.
+	const int64_t intDigits = number.intEnd - number.intBegin;
+	const int64_t totalDigits = intDigits + (number.fracEnd - number.fracBegin);
+	const int64_t pointPosition = intDigits + number.exponent;
+
+	uint64_t magnitude = 0;
+	bool overflow = false;
+	bool fraction = false;
+
+	for (int64_t i = 0; i < totalDigits; i++)
+	{
+		const char c = i < intDigits ? number.intBegin[i] : number.fracBegin[i - intDigits];
+		const unsigned digit = unsigned(c - '0');
+
+		if (i >= pointPosition)
+		{
+			fraction |= digit != 0;
+		}
+		else if (magnitude > (UINT64_MAX - digit) / 10)
+		{
+			overflow = true;
+		}
+		else
+		{
+			magnitude = magnitude * 10 + digit;
+		}
+	}
+
+	// Trailing zeros from the exponent.
+	for (int64_t i = totalDigits; i < pointPosition && magnitude != 0 && !overflow; i++)
+	{
+		if (magnitude > UINT64_MAX / 10)
+		{
+			overflow = true;
+		}
+		magnitude *= 10;
+	}
+
+	if (fraction)
+	{
+		return CONV_PRECISION_LOSS;
+	}
+
+	typedef typename std::make_unsigned<T>::type UT;
+	const uint64_t maxPositive = static_cast<UT>(std::numeric_limits<T>::max());
+	const uint64_t maxNegative = std::is_signed<T>::value ? maxPositive + 1 : 0;
+
+	if (number.negative)
+	{
+		if (overflow || magnitude > maxNegative)
+		{
+			return CONV_NEGATIVE_OVERFLOW;
+		}
+		// Negate in unsigned arithmetic, the conversion back to T is well defined for in range values.
+		destination = magnitude == 0 ? T(0) : static_cast<T>(-static_cast<int64_t>(magnitude - 1) - 1);
+	}
+	else
+	{
+		if (overflow || magnitude > maxPositive)
+		{
+			return CONV_POSITIVE_OVERFLOW;
+		}
+		destination = static_cast<T>(magnitude);
+	}
+
+	return CONV_OK;
+}
+
+/**
+ * Converts an int64_t to a narrower integer type with range checks.
+ * @param value the value to convert.
+ * @param destination set to the value if the result is CONV_OK.
+ * @return CONV_OK or overflow flags.
+ */
+template<typename T>
+ConversionResultFlags narrowInteger(int64_t value, T& destination)
+{
+	static_assert(std::is_integral<T>::value, "integer type expected");
+
+	if (value < 0 && (std::is_unsigned<T>::value || value < static_cast<int64_t>(std::numeric_limits<T>::min())))
+	{
+		return CONV_NEGATIVE_OVERFLOW;
+	}
+
+	if (value > 0 && static_cast<uint64_t>(value) > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+	{
+		return CONV_POSITIVE_OVERFLOW;
+	}
+
+	destination = static_cast<T>(value);
+	return CONV_OK;
+}
+
+/**
+ * Decodes numeric text to a double, correctly rounded.
+ * @param str text to decode, does not need to be null terminated.
+ * @param len length of the text.
+ * @param destination set to the value if the result is CONV_OK.
+ * @return CONV_OK or the pbnjson conversion error flags.
+ */
+inline ConversionResultFlags decodeDouble(const char* str, size_t len, double& destination)
+{
+	static const double POWERS_OF_10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	NumberText number;
+	if (!scanNumber(str, len, number))
+	{
+		return CONV_NOT_A_NUM;
+	}
+
+	// Fast path: mantissa and power of ten both exactly representable, a single
+	// multiplication or division is then correctly rounded.
+	uint64_t mantissa = 0;
+	int64_t exponent = number.exponent - (number.fracEnd - number.fracBegin);
+	int digits = 0;
+	for (const char* p = number.intBegin; p != number.fracEnd; p++)
+	{
+		if (p == number.intEnd)
+		{
+			p = number.fracBegin;
+			if (p == number.fracEnd)
+			{
+				break;
+			}
+		}
+		mantissa = mantissa * 10 + unsigned(*p - '0');
+		if (mantissa != 0 && ++digits > 19)
+		{
+			break;
+		}
+	}
+
+	if (digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+	{
+		double value = static_cast<double>(mantissa);
+		value = exponent < 0 ? value / POWERS_OF_10[-exponent] : value * POWERS_OF_10[exponent];
+		destination = number.negative ? -value : value;
+		return CONV_OK;
+	}
+
+	// Slow path: strtod needs null terminated text.
+	char buffer[64];
+	std::string longText;
+	const char* text = buffer;
+	if (len < sizeof(buffer))
+	{
+		memcpy(buffer, str, len);
+		buffer[len] = '\0';
+	}
+	else
+	{
+		longText.assign(str, len);
+		text = longText.c_str();
+	}
+
+	errno = 0;
+	double value = strtod(text, nullptr);
+	if (errno == ERANGE && (value == HUGE_VAL || value == -HUGE_VAL))
+	{
+		return value > 0 ? CONV_POSITIVE_OVERFLOW : CONV_NEGATIVE_OVERFLOW;
+	}
+
+	destination = value;
+	return CONV_OK;
+}
+
+} // namespace LSHelpers
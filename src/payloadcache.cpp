@@ -0,0 +1,117 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+
+#include "payloadcache.hpp"
+
+using namespace pbnjson;
+
+namespace LSHelpers {
+
+/**
+ * FNV-1a hash of the payload and schema address.
+ */
+static size_t payloadHash(const char* payload, size_t length, const JSchema* schema)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		hash = (hash ^ static_cast<uint8_t>(payload[i])) * 1099511628211ULL;
+	}
+
+	hash = (hash ^ reinterpret_cast<uintptr_t>(schema)) * 1099511628211ULL;
+	return static_cast<size_t>(hash);
+}
+
+PayloadCache::PayloadCache(size_t capacity, size_t maxPayloadSize)
+		: mMaxPayloadSize(maxPayloadSize)
+		, mEntries(capacity > 0 ? capacity : 1)
+		, mHits(0)
+		, mMisses(0)
+{
+}
+
+bool PayloadCache::isCacheable(const char* payload) const
+{
+	return payload && strnlen(payload, mMaxPayloadSize + 1) <= mMaxPayloadSize;
+}
+
+JValue PayloadCache::parse(const char* payload, const JSchema& schema)
+{
+	if (!isCacheable(payload))
+	{
+		return JDomParser::fromString(payload ? payload : "", schema);
+	}
+
+	size_t length = strlen(payload);
+	size_t hash = payloadHash(payload, length, &schema);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		Entry& entry = mEntries[hash % mEntries.size()];
+
+		if (entry.hash == hash &&
+		    entry.schema == &schema &&
+		    entry.payload.size() == length &&
+		    memcmp(entry.payload.data(), payload, length) == 0)
+		{
+			mHits++;
+			return entry.value;
+		}
+
+		mMisses++;
+	}
+
+	// Parse outside the lock.
+	JValue value = JDomParser::fromString(payload, schema);
+
+	if (value.isValid())
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		Entry& entry = mEntries[hash % mEntries.size()];
+		entry.hash = hash;
+		entry.schema = &schema;
+		entry.payload.assign(payload, length);
+		entry.value = value;
+	}
+
+	return value;
+}
+
+uint64_t PayloadCache::getHits() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mHits;
+}
+
+uint64_t PayloadCache::getMisses() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMisses;
+}
+
+void PayloadCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& entry : mEntries)
+	{
+		entry = Entry();
+	}
+}
+
+} // namespace LSHelpers
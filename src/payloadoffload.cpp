@@ -0,0 +1,126 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "payloadoffload.hpp"
+
+using namespace pbnjson;
+
+namespace LSHelpers {
+
+const size_t PayloadOffload::DEFAULT_THRESHOLD;
+
+static void addSize(const JValue& value, size_t limit, size_t& size)
+{
+	if (value.isObject())
+	{
+		size += 2;
+		for (const JValue::KeyValue& member : value.children())
+		{
+			if (size >= limit)
+			{
+				return;
+			}
+			size += static_cast<size_t>(jstring_get_fast(member.first.peekRaw()).m_len) + 4;
+			addSize(member.second, limit, size);
+		}
+	}
+	else if (value.isArray())
+	{
+		size += 2;
+		ssize_t count = value.arraySize();
+		for (ssize_t i = 0; i < count && size < limit; i++)
+		{
+			addSize(value[static_cast<int>(i)], limit, size);
+			size++;
+		}
+	}
+	else if (value.isString())
+	{
+		size += static_cast<size_t>(jstring_get_fast(value.peekRaw()).m_len) + 2;
+	}
+	else
+	{
+		size += 8; // Number, boolean or null.
+	}
+}
+
+size_t PayloadOffload::estimateSize(const JValue& value, size_t limit)
+{
+	size_t size = 0;
+	addSize(value, limit, size);
+	return size;
+}
+
+bool PayloadOffload::isLarge(const JValue& value) const
+{
+	return pool && estimateSize(value, threshold) >= threshold;
+}
+
+OrderedOffload::~OrderedOffload()
+{
+	wait();
+}
+
+bool OrderedOffload::offload(const PayloadOffload& config, bool large, const WorkerPool::Task& task)
+{
+	if (!config.pool)
+	{
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!large && mPending == 0)
+	{
+		return false;
+	}
+	mPending++;
+	lock.unlock();
+
+	// Same key for all tasks of this owner - they run in order on one worker.
+	bool queued = config.pool->submit([this, task]()
+	                                  {
+		                                  struct Finish
+		                                  {
+			                                  OrderedOffload* self;
+			                                  ~Finish() { self->finish(); }
+		                                  } finish{this};
+		                                  task();
+	                                  },
+	                                  std::hash<const void*>()(this));
+
+	if (!queued)
+	{
+		// Queue full. Let the earlier tasks finish, so the inline task does not overtake them.
+		finish();
+		wait();
+	}
+	return queued;
+}
+
+void OrderedOffload::wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this]() { return mPending == 0; });
+}
+
+void OrderedOffload::finish()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mPending--;
+	mIdle.notify_all();
+}
+
+} // namespace LSHelpers
@@ -25,9 +25,15 @@ using namespace pbnjson;
 
 namespace LSHelpers  {
 
+const size_t ServicePoint::MAX_CALL_URIS;
 
 ServicePoint::ServicePoint(LS::Handle* handle)
 		: mHandle(handle)
+		, mRequestArena(false)
+		, mMetricsEnabled(false)
+		, mCallMetricsEnabled(false)
+		, mSlowCallUs(0)
+		, mExecutorState(std::make_shared<ExecutorState>())
 {
 }
 
@@ -38,6 +44,13 @@ ServicePoint::~ServicePoint()
 		unregisterMethodImpl(*method);
 	}
 
+	// Queued handlers are skipped, wait for the running ones to finish.
+	{
+		std::unique_lock<std::mutex> lock(mExecutorState->mutex);
+		mExecutorState->stopped = true;
+		mExecutorState->finished.wait(lock, [this]() { return mExecutorState->running == 0; });
+	}
+
 	//TODO: Potential raciness with call responses being dispatched in other threads.
 	// There is no clean way to kill a call (it might be in the callback method).
 
@@ -55,7 +68,9 @@ ServicePoint::~ServicePoint()
 void ServicePoint::registerMethod(const std::string& category,
                                       const std::string& methodName,
                                       const JsonRequest::Handler& handler,
-                                      const JSchema& schema)
+                                      const JSchema& schema,
+                                      const ValidationPolicy& policy,
+                                      const MethodExecutor& executor)
 {
 	if (unlikely(!mHandle))
 	{
@@ -90,7 +105,11 @@ void ServicePoint::registerMethod(const std::string& category,
 		throw error;
 	}
 
-	std::unique_ptr<MethodInfo> method {new MethodInfo(this, handler, schema, category, methodName)};
+	std::unique_ptr<MethodInfo> method {new MethodInfo(this, handler, schema, policy, executor, category, methodName)};
+	if (mMetricsEnabled)
+	{
+		method->metrics = std::make_shared<MethodMetrics>();
+	}
 	registerMethodImpl(*method);
 	mMethods.emplace_back(std::move(method));
 }
@@ -153,6 +172,150 @@ void ServicePoint::registerSignal(const std::string& category, const std::string
 	mHandle->registerCategoryAppend(category.c_str(), nullptr, signals);
 }
 
+ServicePoint::MethodInfo& ServicePoint::findMethod(const std::string& category, const std::string& methodName) const
+{
+	for (auto& method: mMethods)
+	{
+		if (method->method == methodName && method->category == category)
+		{
+			return *method;
+		}
+	}
+
+	std::stringstream error;
+	error << "Method " << category << "/" << methodName << " not registered";
+	throw std::logic_error(error.str());
+}
+
+ValidationStats ServicePoint::getValidationStats(const std::string& category, const std::string& methodName) const
+{
+	return findMethod(category, methodName).policy.getStats();
+}
+
+void ServicePoint::setAdmissionLimits(const std::string& category,
+                                      const std::string& methodName,
+                                      const AdmissionLimits& limits)
+{
+	findMethod(category, methodName).admission = std::make_shared<AdmissionControl>(limits);
+}
+
+void ServicePoint::enableMetrics()
+{
+	mMetricsEnabled = true;
+	for (auto& method: mMethods)
+	{
+		if (!method->metrics)
+		{
+			method->metrics = std::make_shared<MethodMetrics>();
+		}
+	}
+}
+
+JValue ServicePoint::getMetrics() const
+{
+	JObject methods;
+	for (auto& method: mMethods)
+	{
+		if (!method->metrics)
+		{
+			continue;
+		}
+
+		JValue metrics = method->metrics->toJson();
+
+		ValidationStats validation = method->policy.getStats();
+		metrics.put("validation", JObject{{"validated", int64_t(validation.validated)},
+		                                  {"skipped", int64_t(validation.skipped)},
+		                                  {"failed", int64_t(validation.failed)}});
+
+		if (method->admission)
+		{
+			AdmissionStats admission = method->admission->getStats();
+			metrics.put("admission", JObject{{"admitted", int64_t(admission.admitted)},
+			                                 {"queued", int64_t(admission.queued)},
+			                                 {"rejected", int64_t(admission.rejected)},
+			                                 {"rateLimited", int64_t(admission.rateLimited)},
+			                                 {"inFlight", int64_t(admission.inFlight)},
+			                                 {"queueDepth", int64_t(admission.queueDepth)}});
+		}
+
+		const std::string& category = method->category;
+		methods.put(category.back() == '/' ? category + method->method : category + "/" + method->method, metrics);
+	}
+
+	JObject calls;
+	{
+		std::lock_guard<std::mutex> lock(mCallMetricsMutex);
+		for (const auto& uri: mCallMetrics)
+		{
+			calls.put(uri.first, uri.second->toJson());
+		}
+	}
+
+	return JObject{{"methods", methods}, {"calls", calls}};
+}
+
+void ServicePoint::registerStatsMethod(const std::string& category, const std::string& methodName)
+{
+	registerMethod(category, methodName, [this](JsonRequest& request) -> JValue
+	{
+		request.finishParseOrThrow(false);
+
+		JValue response = getMetrics();
+		response.put("returnValue", true);
+		return response;
+	});
+}
+
+void ServicePoint::enableCallMetrics(uint32_t slowCallMs)
+{
+	mCallMetricsEnabled = true;
+	mSlowCallUs = uint64_t(slowCallMs) * 1000;
+}
+
+std::shared_ptr<const CallMetrics> ServicePoint::getCallMetrics(const std::string& uri) const
+{
+	std::lock_guard<std::mutex> lock(mCallMetricsMutex);
+	auto iter = mCallMetrics.find(uri);
+	return iter != mCallMetrics.end() ? iter->second : nullptr;
+}
+
+std::shared_ptr<CallMetrics> ServicePoint::findCallMetrics(const std::string& uri)
+{
+	std::lock_guard<std::mutex> lock(mCallMetricsMutex);
+	auto iter = mCallMetrics.find(uri);
+	if (iter != mCallMetrics.end())
+	{
+		return iter->second;
+	}
+
+	// Bound the memory if URIs are generated, count the rest together.
+	auto& metrics = mCallMetrics.size() < MAX_CALL_URIS ? mCallMetrics[uri] : mCallMetrics["*"];
+	if (!metrics)
+	{
+		metrics = std::make_shared<CallMetrics>();
+	}
+	return metrics;
+}
+
+AdmissionStats ServicePoint::getAdmissionStats(const std::string& category, const std::string& methodName) const
+{
+	MethodInfo& method = findMethod(category, methodName);
+	return method.admission ? method.admission->getStats() : AdmissionStats();
+}
+
+void ServicePoint::setPayloadCache(size_t capacity, size_t maxPayloadSize)
+{
+	if (capacity > 0)
+	{
+		mPayloadCache.reset(new PayloadCache(capacity, maxPayloadSize));
+	}
+	else
+	{
+		mPayloadCache.reset();
+	}
+}
+
 // ---------------------
 // Section: calls
 // ---------------------
@@ -161,6 +324,14 @@ LSMessageToken ServicePoint::makeCall(const std::string& uri,
                                           const pbnjson::JValue& params,
                                           bool oneReply,
                                           const JsonResponse::Handler& handler)
+{
+	return makeCall(uri, JGenerator::serialize(params, JSchema::AllSchema()).c_str(), oneReply, handler);
+}
+
+LSMessageToken ServicePoint::makeCall(const std::string& uri,
+                                      const char* params,
+                                      bool oneReply,
+                                      const JsonResponse::Handler& handler)
 {
 	LSMessageToken token = 0;
 	LS::Error error;
@@ -171,12 +342,47 @@ LSMessageToken ServicePoint::makeCall(const std::string& uri,
 		throw error;
 	}
 
+	// Calls made while handling a traced request continue its trace.
+	Span trace = Span();
+	std::string tracedParams;
+	if (unlikely(Tracer::isEnabled()))
+	{
+		TraceContext parent = Tracer::current();
+		trace = Span{InternedString::intern(uri).c_str(),
+		             SpanKind::Call,
+		             parent ? parent.traceId : Tracer::newId(),
+		             Tracer::newId(),
+		             parent.spanId,
+		             0,
+		             MethodMetrics::nowUs(),
+		             0};
+
+		if (Tracer::isPropagating(uri.c_str()))
+		{
+			tracedParams = Tracer::inject(params, TraceContext{trace.traceId, trace.spanId});
+			params = tracedParams.c_str();
+		}
+	}
+
+	std::shared_ptr<CallMetrics> metrics;
+	if (mCallMetricsEnabled)
+	{
+		metrics = findCallMetrics(uri);
+		metrics->calls.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	if (handler)
 	{
 		std::unique_ptr<Call> call {new Call(this, 0, handler, oneReply)};
+		if (metrics)
+		{
+			call->metrics = std::move(metrics);
+			call->uri = uri;
+			call->sentUs = MethodMetrics::nowUs();
+		}
+		call->trace = trace;
 
-		LSCall(mHandle->get(), uri.c_str(),
-		       JGenerator::serialize(params, JSchema::AllSchema()).c_str(),
+		LSCall(mHandle->get(), uri.c_str(), params,
 		       &ServicePoint::callResponseHandler, call.get(), &token, error.get());
 
 		if (error.isSet())
@@ -196,14 +402,19 @@ LSMessageToken ServicePoint::makeCall(const std::string& uri,
 			throw std::logic_error("Multi reply requires handler method");
 		}
 
-		LSCallOneReply(mHandle->get(), uri.c_str(),
-		               JGenerator::serialize(params, JSchema::AllSchema()).c_str(),
+		LSCallOneReply(mHandle->get(), uri.c_str(), params,
 		               nullptr, nullptr, &token, error.get());
 
 		if (error.isSet())
 		{
 			throw error;
 		}
+
+		// No reply to wait for, the span only links to the called service.
+		if (unlikely(trace.traceId))
+		{
+			Tracer::record(trace);
+		}
 	}
 
 	return token;
@@ -222,6 +433,10 @@ void ServicePoint::cancelCall(LSMessageToken token)
 	else
 	{
 		auto& call = iter->second;
+		if (call->metrics)
+		{
+			call->metrics->cancelled.fetch_add(1, std::memory_order_relaxed);
+		}
 		LSCallCancel(mHandle->get(), call->token, nullptr);
 		mCalls.erase(call->token);
 	}
@@ -239,6 +454,18 @@ void ServicePoint::cancelCall(ServicePoint::Call* call)
 // ---------------------------
 
 void ServicePoint::sendSignal(const std::string& category, const std::string& method, const pbnjson::JValue& payload)
+{
+	//JValue is reference counted, this is a shallow copy to remove const.
+	JValue payloadLocal = payload;
+	sendSignalImpl(category, method, payloadLocal.stringify().c_str());
+}
+
+void ServicePoint::sendSignal(const std::string& category, const std::string& method, const JsonWriter& payload)
+{
+	sendSignalImpl(category, method, payload.c_str());
+}
+
+void ServicePoint::sendSignalImpl(const std::string& category, const std::string& method, const char* payload)
 {
 	LS::Error error;
 	if (unlikely(!mHandle))
@@ -261,10 +488,8 @@ void ServicePoint::sendSignal(const std::string& category, const std::string& me
 
 	// The SignalSend cares only about category and method.
 	std::string uri = "luna://com.bogusuri" + category + "/" + method;
-	//JValue is reference counted, this is a shallow copy to remove const.
-	JValue payloadLocal = payload;
 
-	if (!LSSignalSend(mHandle->get(), uri.c_str(), payloadLocal.stringify().c_str(), error.get()))
+	if (!LSSignalSend(mHandle->get(), uri.c_str(), payload, error.get()))
 	{
 		throw error;
 	}
@@ -274,7 +499,50 @@ void ServicePoint::sendSignal(const std::string& category, const std::string& me
 // Section: callback handler methods.
 //----------------------------
 
-bool ServicePoint::methodHandler(LSHandle *, LSMessage *msg, void *method_context)
+static void respondCanned(LS::Message& message, const std::string& payload)
+{
+	try
+	{
+		message.respond(payload.c_str());
+	}
+	catch (LS::Error& e)
+	{
+		e.log(PmLogGetLibContext(), "LS_RESPONSE_FAIL");
+	}
+}
+
+static void respondBusy(LS::Message& message)
+{
+	static const std::string busy = API_ERROR_BUSY.stringify();
+	respondCanned(message, busy);
+}
+
+static void respondRateLimited(LS::Message& message)
+{
+	static const std::string rateLimited = API_ERROR_RATE_LIMITED.stringify();
+	respondCanned(message, rateLimited);
+}
+
+// Run a function from the main loop of the context.
+static void invokeOnContext(GMainContext* context, std::function<void()> func)
+{
+	GSource* source = g_timeout_source_new(0);
+	g_source_set_callback(source,
+	                      [](gpointer data) -> gboolean
+	                      {
+		                      (*static_cast<std::function<void()>*>(data))();
+		                      return G_SOURCE_REMOVE;
+	                      },
+	                      new std::function<void()>(std::move(func)),
+	                      [](gpointer data)
+	                      {
+		                      delete static_cast<std::function<void()>*>(data);
+	                      });
+	g_source_attach(source, context);
+	g_source_unref(source);
+}
+
+bool ServicePoint::methodHandler(LSHandle *sh, LSMessage *msg, void *method_context)
 {
 	MethodInfo* method = static_cast<MethodInfo*>(method_context);
 
@@ -285,7 +553,318 @@ bool ServicePoint::methodHandler(LSHandle *, LSMessage *msg, void *method_contex
 		return false;
 	}
 
-	return JsonRequest::handleLunaCall(msg, method->handler, method->schema);
+	MethodMetrics* metrics = method->metrics.get();
+	uint64_t arrivalUs = 0;
+	if (unlikely(metrics))
+	{
+		metrics->calls.fetch_add(1, std::memory_order_relaxed);
+		arrivalUs = MethodMetrics::nowUs();
+	}
+
+	if (unlikely(method->admission))
+	{
+		// Decide before parsing, rejecting must stay cheap under overload.
+		LS::Message message{msg};
+		LS::Message displaced;
+		AdmissionControl::Decision decision = method->admission->admit(message, displaced, arrivalUs);
+		if (displaced)
+		{
+			respondBusy(displaced);
+			if (metrics)
+			{
+				metrics->recordError(API_ERROR_CODE_BUSY);
+			}
+		}
+
+		switch (decision)
+		{
+			case AdmissionControl::Decision::Queue:
+				return true;
+			case AdmissionControl::Decision::Reject:
+				respondBusy(message);
+				if (metrics)
+				{
+					metrics->recordError(API_ERROR_CODE_BUSY);
+				}
+				return true;
+			case AdmissionControl::Decision::RateLimited:
+				respondRateLimited(message);
+				if (metrics)
+				{
+					metrics->recordError(API_ERROR_CODE_RATE_LIMITED);
+				}
+				return true;
+			default:
+				break;
+		}
+	}
+
+	return dispatchMethod(sh, msg, method, arrivalUs);
+}
+
+bool ServicePoint::dispatchMethod(LSHandle *sh, LSMessage *msg, MethodInfo* method, uint64_t arrivalUs)
+{
+	std::function<void()> onComplete = makeCompletion(sh, method);
+
+	if (method->executor.pool)
+	{
+		return handleOnExecutor(sh, msg, method, onComplete, arrivalUs);
+	}
+
+	const PayloadOffload& offload = method->service->mPayloadOffload;
+	if (unlikely(offload.pool) && offload.isLarge(strlen(LSMessageGetPayload(msg))) &&
+	    handleLargePayload(sh, msg, method, onComplete, arrivalUs))
+	{
+		return true;
+	}
+
+	if (likely(!onComplete && !method->metrics))
+	{
+		return JsonRequest::handleLunaCall(msg,
+		                                   method->handler,
+		                                   method->schema,
+		                                   method->service->mPayloadCache.get(),
+		                                   method->service->mRequestArena,
+		                                   &method->policy,
+		                                   offload.pool ? &offload : nullptr);
+	}
+
+	LS::Message message{msg};
+	return handleCall(message, method, offload.pool ? &offload : nullptr, onComplete, arrivalUs);
+}
+
+bool ServicePoint::handleCall(LS::Message& message,
+                              MethodInfo* method,
+                              const PayloadOffload* offload,
+                              const std::function<void()>& onComplete,
+                              uint64_t arrivalUs)
+{
+	JsonRequest::DispatchOptions options;
+	options.useArena = method->service->mRequestArena;
+	options.offload = offload;
+	options.onComplete = onComplete;
+	options.metrics = method->metrics;
+
+	MethodMetrics* metrics = method->metrics.get();
+	uint64_t parseStartUs = 0;
+	if (metrics)
+	{
+		parseStartUs = MethodMetrics::nowUs();
+		options.startUs = arrivalUs ? arrivalUs : parseStartUs;
+		metrics->requestBytes.record(strlen(message.getPayload()));
+	}
+
+	const JSchema& schema = method->policy.selectSchema(method->schema, message.getSenderServiceName());
+	int32_t errorCode = 0;
+	JValue value = JsonRequest::parsePayload(message, schema, method->service->mPayloadCache.get(), &method->policy,
+	                                         &errorCode, &options.trace);
+	if (metrics)
+	{
+		metrics->parseUs.record(MethodMetrics::nowUs() - parseStartUs);
+	}
+
+	if (unlikely(!value.isValid()))
+	{
+		if (metrics)
+		{
+			metrics->recordError(errorCode);
+		}
+		if (onComplete)
+		{
+			onComplete();
+		}
+		return true;
+	}
+
+	return JsonRequest::dispatch(message, value, method->handler, options);
+}
+
+std::function<void()> ServicePoint::makeCompletion(LSHandle *sh, MethodInfo* method)
+{
+	if (likely(!method->admission))
+	{
+		return std::function<void()>();
+	}
+
+	std::shared_ptr<AdmissionControl> admission = method->admission;
+	std::shared_ptr<ExecutorState> state = method->service->mExecutorState;
+	GMainContext* context = LSGmainGetContext(sh, nullptr);
+
+	return [sh, method, admission, state, context]()
+	{
+		LS::Message next;
+		uint64_t arrivalUs = 0;
+		if (!admission->release(next, &arrivalUs))
+		{
+			return;
+		}
+
+		// The slot may be released on a worker thread or from within a handler.
+		// Dispatch the next request from the main loop.
+		invokeOnContext(context, [sh, method, state, next, arrivalUs]() mutable
+		{
+			if (!state->enter())
+			{
+				return; // Service point destroyed, the method info is gone.
+			}
+			dispatchMethod(sh, next.get(), method, arrivalUs);
+			state->leave();
+		});
+	};
+}
+
+bool ServicePoint::handleOnExecutor(LSHandle *sh,
+                                    LSMessage *msg,
+                                    MethodInfo* method,
+                                    const std::function<void()>& onComplete,
+                                    uint64_t arrivalUs)
+{
+	LS::Message message{msg};
+	GMainContext* context = LSGmainGetContext(sh, nullptr);
+	std::shared_ptr<ExecutorState> state = method->service->mExecutorState;
+
+	auto task = [message, method, context, state, onComplete, arrivalUs]() mutable
+	{
+		if (!state->enter())
+		{
+			return; // Service point destroyed, the method info is gone.
+		}
+
+		JsonRequest::setThreadResponseContext(context);
+		if (onComplete || method->metrics)
+		{
+			handleCall(message, method, nullptr, onComplete, arrivalUs);
+		}
+		else
+		{
+			JsonRequest::handleLunaCall(message.get(),
+			                            method->handler,
+			                            method->schema,
+			                            method->service->mPayloadCache.get(),
+			                            method->service->mRequestArena,
+			                            &method->policy);
+		}
+		JsonRequest::setThreadResponseContext(nullptr);
+
+		state->leave();
+	};
+
+	bool queued;
+	const char* sender;
+	switch (method->executor.ordering)
+	{
+		case MethodExecutor::Ordering::PerSender:
+			sender = message.getSender();
+			queued = method->executor.pool->submit(task, std::hash<std::string>()(sender ? sender : ""));
+			break;
+		case MethodExecutor::Ordering::PerKey:
+			queued = method->executor.pool->submit(task, method->executor.key(message));
+			break;
+		default:
+			queued = method->executor.pool->submit(task);
+	}
+
+	if (!queued)
+	{
+		respondBusy(message);
+		if (method->metrics)
+		{
+			method->metrics->recordError(API_ERROR_CODE_BUSY);
+		}
+		if (onComplete)
+		{
+			onComplete();
+		}
+	}
+
+	return true;
+}
+
+bool ServicePoint::handleLargePayload(LSHandle *sh,
+                                      LSMessage *msg,
+                                      MethodInfo* method,
+                                      const std::function<void()>& onComplete,
+                                      uint64_t arrivalUs)
+{
+	LS::Message message{msg};
+	GMainContext* context = LSGmainGetContext(sh, nullptr);
+	std::shared_ptr<ExecutorState> state = method->service->mExecutorState;
+	JSchema schema = method->policy.selectSchema(method->schema, message.getSenderServiceName());
+
+	// Parse on the pool, then call the handler back on the main loop.
+	return method->service->mPayloadOffload.pool->submit([message, method, context, state, schema, onComplete, arrivalUs]() mutable
+	{
+		if (!state->enter())
+		{
+			return;
+		}
+
+		JsonRequest::DispatchOptions options;
+		options.useArena = method->service->mRequestArena;
+		options.offload = &method->service->mPayloadOffload;
+		options.onComplete = onComplete;
+		options.metrics = method->metrics;
+		uint64_t parseStartUs = 0;
+		if (options.metrics)
+		{
+			parseStartUs = MethodMetrics::nowUs();
+			options.startUs = arrivalUs ? arrivalUs : parseStartUs;
+			options.metrics->requestBytes.record(strlen(message.getPayload()));
+		}
+
+		JsonRequest::setThreadResponseContext(context);
+		int32_t errorCode = 0;
+		JValue value = JsonRequest::parsePayload(message, schema, nullptr, &method->policy, &errorCode, &options.trace);
+		JsonRequest::setThreadResponseContext(nullptr);
+
+		if (options.metrics)
+		{
+			options.metrics->parseUs.record(MethodMetrics::nowUs() - parseStartUs);
+			if (!value.isValid())
+			{
+				options.metrics->recordError(errorCode);
+			}
+		}
+		state->leave();
+
+		if (!value.isValid())
+		{
+			if (onComplete)
+			{
+				onComplete();
+			}
+			return;
+		}
+
+		invokeOnContext(context, [message, value, method, state, options]() mutable
+		{
+			if (!state->enter())
+			{
+				return;
+			}
+
+			JsonRequest::dispatch(message, value, method->handler, options);
+			state->leave();
+		});
+	});
+}
+
+bool ServicePoint::ExecutorState::enter()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (stopped)
+	{
+		return false;
+	}
+	running++;
+	return true;
+}
+
+void ServicePoint::ExecutorState::leave()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	running--;
+	finished.notify_all();
 }
 
 /**
@@ -324,13 +903,83 @@ bool ServicePoint::callResponseHandler(LSHandle* sh, LSMessage* msg, void* ctx)
 	// Clean up before the handler method. Handler may delete the client and we will not be able to
 	// do it afterwards.
 	auto handler = call->handler;
+	PayloadCache* cache = call->service->mPayloadCache.get();
+	std::shared_ptr<CallMetrics> metrics = call->metrics;
+	if (metrics)
+	{
+		recordReply(*call);
+	}
+
+	TraceContext trace{call->trace.traceId, call->trace.spanId};
+	if (unlikely(call->trace.startUs))
+	{
+		call->trace.durationUs = MethodMetrics::nowUs() - call->trace.startUs;
+		Tracer::record(call->trace);
+		call->trace.startUs = 0;
+	}
+
 	if (call->oneReply)
 	{
 		// Invalidates call object!!!
 		call->service->cancelCall(call);
 	}
 
-	return JsonResponse::handleLunaResponse(msg, handler, JSchema::AllSchema());
+	// Calls made from the reply handler continue the trace.
+	TraceScope scope(trace);
+	return handleReply(msg, handler, cache, metrics.get());
+}
+
+bool ServicePoint::handleReply(LSMessage* msg, const JsonResponse::Handler& handler, PayloadCache* cache,
+                               CallMetrics* metrics)
+{
+	if (!metrics)
+	{
+		return JsonResponse::handleLunaResponse(msg, handler, JSchema::AllSchema(), cache);
+	}
+
+	JsonResponse::Outcome outcome = JsonResponse::Outcome::Success;
+	JsonResponse::handleLunaResponse(msg, handler, JSchema::AllSchema(), cache, &outcome);
+	switch (outcome)
+	{
+		case JsonResponse::Outcome::Success:
+			break;
+		case JsonResponse::Outcome::Error:
+			metrics->errors.fetch_add(1, std::memory_order_relaxed);
+			break;
+		case JsonResponse::Outcome::HubError:
+			metrics->hubErrors.fetch_add(1, std::memory_order_relaxed);
+			break;
+		case JsonResponse::Outcome::ParseError:
+			metrics->parseErrors.fetch_add(1, std::memory_order_relaxed);
+			break;
+	}
+	return true;
+}
+
+void ServicePoint::recordReply(Call& call)
+{
+	CallMetrics& metrics = *call.metrics;
+	uint64_t now = MethodMetrics::nowUs();
+	metrics.replies.fetch_add(1, std::memory_order_relaxed);
+
+	if (call.lastReplyUs)
+	{
+		metrics.updateIntervalUs.record(now - call.lastReplyUs);
+	}
+	else
+	{
+		uint64_t roundTripUs = now - call.sentUs;
+		metrics.roundTripUs.record(roundTripUs);
+
+		uint64_t slowCallUs = call.service->mSlowCallUs;
+		if (slowCallUs && roundTripUs > slowCallUs)
+		{
+			metrics.slow.fetch_add(1, std::memory_order_relaxed);
+			LOG_LS_WARNING(MSGID_LS_SLOW_CALL, 0, "Slow luna call to %s, round trip %llu ms",
+			               call.uri.c_str(), static_cast<unsigned long long>(roundTripUs / 1000));
+		}
+	}
+	call.lastReplyUs = now;
 }
 
 } // Namespace LSHelpers
@@ -0,0 +1,119 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "stringref.hpp"
+
+namespace LSHelpers {
+
+const size_t InternedString::MAX_POOL_SIZE;
+
+/**
+ * FNV-1a hash of the string.
+ */
+struct StringRefHash
+{
+	size_t operator()(const StringRef& str) const
+	{
+		uint64_t hash = 14695981039346656037ULL;
+
+		for (size_t i = 0; i < str.size(); i++)
+		{
+			hash = (hash ^ static_cast<uint8_t>(str.data()[i])) * 1099511628211ULL;
+		}
+
+		return static_cast<size_t>(hash);
+	}
+};
+
+/**
+ * Process wide pool of interned strings.
+ * Keyed by references to the pooled strings, so lookups by StringRef do not allocate.
+ */
+struct InternPool
+{
+	std::mutex mutex;
+	std::unordered_map<StringRef, std::unique_ptr<std::string>, StringRefHash> strings;
+	const std::string empty;
+};
+
+static InternPool& internPool()
+{
+	// Never destroyed, handles may be used from static destructors.
+	static InternPool* pool = new InternPool();
+	return *pool;
+}
+
+InternedString::InternedString()
+	: _value(&internPool().empty)
+{
+}
+
+/**
+ * Finds the pooled string, adding it if the pool has less than limit strings.
+ * @return pooled string, nullptr if not found and the pool is full.
+ */
+static const std::string* findOrAdd(const StringRef& str, size_t limit)
+{
+	InternPool& pool = internPool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+
+	auto iter = pool.strings.find(str);
+	if (iter != pool.strings.end())
+	{
+		return iter->second.get();
+	}
+
+	if (pool.strings.size() >= limit)
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<std::string> value(new std::string(str.data(), str.size()));
+	const std::string* result = value.get();
+	pool.strings.emplace(StringRef(*result), std::move(value));
+	return result;
+}
+
+InternedString InternedString::intern(const StringRef& str)
+{
+	return InternedString(findOrAdd(str, SIZE_MAX));
+}
+
+bool InternedString::tryIntern(const StringRef& str, InternedString& result)
+{
+	const std::string* value = findOrAdd(str, MAX_POOL_SIZE);
+	if (!value)
+	{
+		return false;
+	}
+
+	result = InternedString(value);
+	return true;
+}
+
+size_t InternedString::poolSize()
+{
+	InternPool& pool = internPool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	return pool.strings.size();
+}
+
+} // Namespace LSHelpers
@@ -76,7 +76,51 @@ bool SubscriptionPoint::postSubscriptions(gpointer user_data)
 // is made and passed into the timeout callback. This also ensures a correct
 // snapshot of subscriptions is addressed in case of concurrently added
 // subscriptions.
+bool SubscriptionPoint::post(const pbnjson::JValue& payload) noexcept
+{
+	pbnjson::JValue p = payload;
+
+	try
+	{
+		if (unlikely(mOffload.pool) && mOffloaded.offload(mOffload, mOffload.isLarge(p), [this, p]() mutable
+		                                                   {
+			                                                   postPayload(p.stringify().c_str());
+		                                                   }))
+		{
+			return true;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR(MSGID_LS_UNEXPECTED_EXCEPTION, 0, "Failed to offload subscription post: %s", e.what());
+	}
+
+	return postPayload(p.stringify().c_str());
+}
+
 bool SubscriptionPoint::post(const char *payload) noexcept
+{
+	if (unlikely(mOffload.pool))
+	{
+		// Keep behind the posts still being serialized.
+		try
+		{
+			std::string copy = payload;
+			if (mOffloaded.offload(mOffload, false, [this, copy]() { postPayload(copy.c_str()); }))
+			{
+				return true;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			LOG_ERROR(MSGID_LS_UNEXPECTED_EXCEPTION, 0, "Failed to offload subscription post: %s", e.what());
+		}
+	}
+
+	return postPayload(payload);
+}
+
+bool SubscriptionPoint::postPayload(const char *payload) noexcept
 {
 	if (!mServiceHandle)
 		return false;
@@ -0,0 +1,487 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "util.hpp"
+#include "jsonwriter.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+
+#define TRACE_FIELD "$trace"
+
+namespace LSHelpers {
+
+const char Tracer::FIELD[] = TRACE_FIELD;
+const size_t Tracer::BUFFER_SIZE;
+std::atomic<bool> Tracer::sEnabled{false};
+std::shared_ptr<const std::vector<std::string> > Tracer::sPropagateTo;
+
+namespace {
+
+// Payload prefix written by inject: the field is always the first one.
+const char TRACE_PREFIX[] = "{\"" TRACE_FIELD "\":\"";
+const size_t TRACE_PREFIX_LENGTH = sizeof(TRACE_PREFIX) - 1;
+const size_t TRACE_ID_LENGTH = 16;
+
+const char* const KIND_NAMES[] = {"request", "parse", "handler", "respond", "call"};
+
+// Spans of one thread. Single producer - the thread, single consumer - the flush.
+struct ThreadBuffer
+{
+	std::array<Span, Tracer::BUFFER_SIZE> spans;
+	std::atomic<uint64_t> head{0}; // Next span to write, advanced by the thread.
+	std::atomic<uint64_t> tail{0}; // Next span to read, advanced by the flush.
+	std::atomic<bool> exited{false}; // The thread is gone, remove once drained.
+	uint64_t tid = 0;
+};
+
+struct TraceState
+{
+	std::mutex mutex; // Lock access to buffers and file.
+	std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+	FILE* file = nullptr;
+	bool empty = true; // No events written to the file yet.
+	JsonWriter writer;
+
+	std::mutex flusherMutex; // Lock access to stopping.
+	std::condition_variable wakeup;
+	bool stopping = false;
+	std::thread flusher;
+};
+
+TraceState& state()
+{
+	static TraceState* traceState = new TraceState(); // Not destroyed, threads may record at exit.
+	return *traceState;
+}
+
+std::atomic<uint64_t> sDropped{0};
+
+// Registers the buffer on first use, marks it exited with the thread.
+struct ThreadBufferHandle
+{
+	~ThreadBufferHandle()
+	{
+		if (buffer)
+		{
+			buffer->exited.store(true, std::memory_order_release);
+		}
+	}
+
+	ThreadBuffer& get()
+	{
+		if (!buffer)
+		{
+			buffer = std::make_shared<ThreadBuffer>();
+			buffer->tid = static_cast<uint64_t>(syscall(SYS_gettid));
+
+			TraceState& s = state();
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	std::shared_ptr<ThreadBuffer> buffer;
+};
+
+thread_local ThreadBufferHandle tBuffer;
+thread_local TraceContext tCurrent;
+
+std::string toHex(uint64_t id)
+{
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), "0x%016llx", static_cast<unsigned long long>(id));
+	return buffer;
+}
+
+bool parseHex(const char* str, uint64_t& id)
+{
+	id = 0;
+	for (size_t i = 0; i < TRACE_ID_LENGTH; i++)
+	{
+		char c = str[i];
+		uint64_t digit;
+		if (c >= '0' && c <= '9')
+		{
+			digit = c - '0';
+		}
+		else if (c >= 'a' && c <= 'f')
+		{
+			digit = c - 'a' + 10;
+		}
+		else
+		{
+			return false;
+		}
+		id = (id << 4) | digit;
+	}
+	return true;
+}
+
+void beginEvent(JsonWriter& writer, const char* name, const char* category, const char* phase,
+                uint64_t timestampUs, uint64_t tid)
+{
+	static const int64_t pid = getpid();
+
+	writer.clear();
+	writer.beginObject()
+	      .field("name", name)
+	      .field("cat", category)
+	      .field("ph", phase)
+	      .field("ts", timestampUs)
+	      .field("pid", pid)
+	      .field("tid", tid);
+}
+
+void endEvent(TraceState& s)
+{
+	s.writer.endObject();
+	fputs(s.empty ? "\n" : ",\n", s.file);
+	fputs(s.writer.c_str(), s.file);
+	s.empty = false;
+}
+
+void writeArgs(JsonWriter& writer, const Span& span)
+{
+	writer.key("args").beginObject()
+	      .field("traceId", toHex(span.traceId))
+	      .field("spanId", toHex(span.spanId));
+	if (span.parentId)
+	{
+		writer.field("parentId", toHex(span.parentId));
+	}
+	writer.endObject();
+}
+
+// Requests and calls may end on another thread, so they are async events. The rest nest on the thread.
+void writeSpan(TraceState& s, const Span& span, uint64_t tid)
+{
+	JsonWriter& writer = s.writer;
+	const char* category = KIND_NAMES[static_cast<size_t>(span.kind)];
+	const char* name = span.name ? span.name : category;
+
+	if (span.kind == SpanKind::Request || span.kind == SpanKind::Call)
+	{
+		beginEvent(writer, name, category, "b", span.startUs, tid);
+		writer.field("id", toHex(span.spanId));
+		writeArgs(writer, span);
+		endEvent(s);
+
+		beginEvent(writer, name, category, "e", span.startUs + span.durationUs, tid);
+		writer.field("id", toHex(span.spanId));
+		endEvent(s);
+
+		if (span.kind == SpanKind::Call)
+		{
+			// Arrow to the request span of the called service.
+			beginEvent(writer, "call", "flow", "s", span.startUs, tid);
+			writer.field("id", toHex(span.spanId));
+			endEvent(s);
+		}
+		return;
+	}
+
+	if (span.remoteParentId)
+	{
+		beginEvent(writer, "call", "flow", "f", span.startUs, tid);
+		writer.field("bp", "e").field("id", toHex(span.remoteParentId));
+		endEvent(s);
+	}
+
+	beginEvent(writer, name, category, "X", span.startUs, tid);
+	writer.field("dur", span.durationUs);
+	writeArgs(writer, span);
+	endEvent(s);
+}
+
+// Drain all buffers to the file, or discard the spans if there is no file.
+void flushLocked(TraceState& s)
+{
+	for (auto iter = s.buffers.begin(); iter != s.buffers.end();)
+	{
+		ThreadBuffer& buffer = **iter;
+		bool exited = buffer.exited.load(std::memory_order_acquire);
+		uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+		uint64_t head = buffer.head.load(std::memory_order_acquire);
+
+		for (; s.file && tail < head; tail++)
+		{
+			writeSpan(s, buffer.spans[tail % Tracer::BUFFER_SIZE], buffer.tid);
+		}
+		buffer.tail.store(head, std::memory_order_release);
+
+		iter = exited ? s.buffers.erase(iter) : iter + 1;
+	}
+
+	if (s.file)
+	{
+		fflush(s.file);
+	}
+}
+
+} // namespace
+
+bool Tracer::start(const std::string& path, uint32_t flushIntervalMs, const std::vector<std::string>& propagateTo)
+{
+	stop();
+
+	TraceState& s = state();
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+		flushLocked(s); // Discard spans recorded after the last stop.
+
+		s.file = fopen(path.c_str(), "w");
+		if (!s.file)
+		{
+			LOG_ERROR(MSGID_LS_TRACE_FILE, 0, "Failed to open trace file %s: %s", path.c_str(), strerror(errno));
+			return false;
+		}
+
+		fputs("[", s.file);
+		s.empty = true;
+
+		beginEvent(s.writer, "process_name", "__metadata", "M", 0, 0);
+		s.writer.key("args").beginObject().field("name", program_invocation_short_name).endObject();
+		endEvent(s);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s.flusherMutex);
+		s.stopping = false;
+	}
+	s.flusher = std::thread([flushIntervalMs]()
+	{
+		TraceState& s = state();
+		std::unique_lock<std::mutex> lock(s.flusherMutex);
+		while (!s.wakeup.wait_for(lock, std::chrono::milliseconds(flushIntervalMs), [&s]() { return s.stopping; }))
+		{
+			lock.unlock();
+			flush();
+			lock.lock();
+		}
+	});
+
+	std::atomic_store(&sPropagateTo, std::make_shared<const std::vector<std::string> >(propagateTo));
+	sEnabled.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+void Tracer::stop()
+{
+	TraceState& s = state();
+	sEnabled.store(false, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(s.flusherMutex);
+		s.stopping = true;
+	}
+	s.wakeup.notify_all();
+	if (s.flusher.joinable())
+	{
+		s.flusher.join();
+	}
+
+	std::lock_guard<std::mutex> lock(s.mutex);
+	flushLocked(s);
+	if (s.file)
+	{
+		fputs("\n]\n", s.file);
+		fclose(s.file);
+		s.file = nullptr;
+	}
+}
+
+void Tracer::flush()
+{
+	TraceState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	flushLocked(s);
+}
+
+bool Tracer::isPropagating(const char* uri)
+{
+	if (!isEnabled())
+	{
+		return false;
+	}
+
+	std::shared_ptr<const std::vector<std::string> > targets = std::atomic_load(&sPropagateTo);
+	if (!targets || targets->empty())
+	{
+		return false;
+	}
+
+	// luna://service/method
+	const char* service = strstr(uri, "://");
+	service = service ? service + 3 : uri;
+	size_t length = strcspn(service, "/");
+
+	for (const std::string& target : *targets)
+	{
+		if (target == "*" || (target.size() == length && memcmp(target.data(), service, length) == 0))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t Tracer::getDropped()
+{
+	return sDropped.load(std::memory_order_relaxed);
+}
+
+TraceContext Tracer::current()
+{
+	return tCurrent;
+}
+
+uint64_t Tracer::newId()
+{
+	static thread_local std::mt19937_64 generator{(uint64_t(std::random_device()()) << 32) ^ std::random_device()()};
+
+	uint64_t id;
+	do
+	{
+		id = generator();
+	} while (id == 0);
+	return id;
+}
+
+void Tracer::record(const Span& span)
+{
+	if (!isEnabled())
+	{
+		return;
+	}
+
+	ThreadBuffer& buffer = tBuffer.get();
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	if (head - buffer.tail.load(std::memory_order_acquire) >= BUFFER_SIZE)
+	{
+		sDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.spans[head % BUFFER_SIZE] = span;
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+std::string Tracer::inject(const char* payload, const TraceContext& context)
+{
+	const char* p = payload;
+	while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+	{
+		p++;
+	}
+	if (*p != '{')
+	{
+		return payload;
+	}
+
+	do
+	{
+		p++;
+	} while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r');
+
+	char field[TRACE_PREFIX_LENGTH + 2 * TRACE_ID_LENGTH + 4];
+	snprintf(field, sizeof(field), "%s%016llx-%016llx\"", TRACE_PREFIX,
+	         static_cast<unsigned long long>(context.traceId),
+	         static_cast<unsigned long long>(context.spanId));
+
+	std::string result;
+	result.reserve(sizeof(field) + strlen(p));
+	result.append(field);
+	if (*p != '}')
+	{
+		result.push_back(',');
+	}
+	result.append(p);
+	return result;
+}
+
+bool Tracer::extract(const char* payload, TraceContext& context, std::string& stripped)
+{
+	if (strncmp(payload, TRACE_PREFIX, TRACE_PREFIX_LENGTH) != 0)
+	{
+		return false;
+	}
+
+	const char* p = payload + TRACE_PREFIX_LENGTH;
+	uint64_t traceId;
+	uint64_t spanId;
+	if (!parseHex(p, traceId) || p[TRACE_ID_LENGTH] != '-' ||
+	    !parseHex(p + TRACE_ID_LENGTH + 1, spanId) || p[2 * TRACE_ID_LENGTH + 1] != '"' || traceId == 0)
+	{
+		return false;
+	}
+
+	p += 2 * TRACE_ID_LENGTH + 2;
+	if (*p != ',' && *p != '}')
+	{
+		return false;
+	}
+
+	stripped.assign("{");
+	stripped.append(*p == ',' ? p + 1 : p);
+	context.traceId = traceId;
+	context.spanId = spanId;
+	return true;
+}
+
+TraceScope::TraceScope(const TraceContext& context)
+		: mPrevious(tCurrent)
+{
+	tCurrent = context;
+}
+
+TraceScope::~TraceScope()
+{
+	tCurrent = mPrevious;
+}
+
+ScopedSpan::ScopedSpan(SpanKind kind, const char* name, const TraceContext& parent)
+		: mSpan()
+{
+	if (parent)
+	{
+		mSpan = Span{name, kind, parent.traceId, Tracer::newId(), parent.spanId, 0, MethodMetrics::nowUs(), 0};
+	}
+}
+
+ScopedSpan::~ScopedSpan()
+{
+	if (mSpan.traceId)
+	{
+		mSpan.durationUs = MethodMetrics::nowUs() - mSpan.startUs;
+		Tracer::record(mSpan);
+	}
+}
+
+} // namespace LSHelpers
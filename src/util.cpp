@@ -14,9 +14,79 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <chrono>
 #include <memory>
+#include <unordered_map>
 #include "util.hpp"
 
+namespace LSHelpers {
+
+constexpr uint32_t LogRateLimiter::DEFAULT_BURST;
+constexpr uint32_t LogRateLimiter::DEFAULT_REFILL_INTERVAL_MS;
+
+LogRateLimiter::LogRateLimiter(uint32_t burst, uint32_t refillIntervalMs)
+	: _burst(burst)
+	, _refillIntervalMs(refillIntervalMs ? refillIntervalMs : 1)
+	, _tokens(burst)
+	, _suppressed(0)
+	, _lastRefillMs(0)
+{
+}
+
+bool LogRateLimiter::allow(uint32_t& suppressed, uint64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (nowMs > _lastRefillMs)
+	{
+		uint64_t refill = (nowMs - _lastRefillMs) / _refillIntervalMs;
+		if (refill >= _burst - _tokens)
+		{
+			_tokens = _burst;
+			_lastRefillMs = nowMs;
+		}
+		else if (refill > 0)
+		{
+			_tokens += static_cast<uint32_t>(refill);
+			_lastRefillMs += refill * _refillIntervalMs;
+		}
+	}
+
+	if (_tokens == 0)
+	{
+		_suppressed++;
+		return false;
+	}
+
+	_tokens--;
+	suppressed = _suppressed;
+	_suppressed = 0;
+	return true;
+}
+
+bool LogRateLimiter::allow(uint32_t& suppressed)
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return allow(suppressed, std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+}
+
+LogRateLimiter& LogRateLimiter::forMessage(const char* messageId)
+{
+	// Leaked, so that logging from static destructors keeps working.
+	static std::mutex* mutex = new std::mutex();
+	static auto* limiters = new std::unordered_map<std::string, std::unique_ptr<LogRateLimiter>>();
+
+	std::lock_guard<std::mutex> lock(*mutex);
+	std::unique_ptr<LogRateLimiter>& limiter = (*limiters)[messageId];
+	if (!limiter)
+	{
+		limiter.reset(new LogRateLimiter());
+	}
+	return *limiter;
+}
+
+} // Namespace LSHelpers
+
 std::string string_format_valist(const std::string& fmt_str, va_list ap)
 {
 	size_t n = fmt_str.size() * 2;
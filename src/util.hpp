@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
 #include <string>
 #include <luna-service2/lunaservice.h>
 #include <PmLogLib.h>
@@ -23,13 +25,99 @@
 #define likely(x)   __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
+namespace LSHelpers {
+
+/**
+ * @brief Token bucket limiting the rate of log messages with one message id.
+ * Allows bursts of up to burst messages, then one message per refill interval.
+ * Messages over the limit are counted and the count is reported with the next allowed message.
+ *
+ * Multithreading: Thread safe.
+ */
+class LogRateLimiter
+{
+public:
+	static constexpr uint32_t DEFAULT_BURST = 10;
+	static constexpr uint32_t DEFAULT_REFILL_INTERVAL_MS = 200;
+
+	explicit LogRateLimiter(uint32_t burst = DEFAULT_BURST,
+	                        uint32_t refillIntervalMs = DEFAULT_REFILL_INTERVAL_MS);
+
+	/**
+	 * Takes a token for one message.
+	 * @param suppressed OUT number of messages suppressed since the last allowed one. Set only when the message is allowed.
+	 * @param nowMs monotonic time in milliseconds.
+	 * @return true if the message should be logged.
+	 */
+	bool allow(uint32_t& suppressed, uint64_t nowMs);
+
+	/** Same as above, using the current monotonic time. */
+	bool allow(uint32_t& suppressed);
+
+	/**
+	 * @return limiter shared by all messages with the message id. Limiters are never freed.
+	 */
+	static LogRateLimiter& forMessage(const char* messageId);
+
+private:
+	std::mutex _mutex;
+	uint32_t _burst;
+	uint32_t _refillIntervalMs;
+	uint32_t _tokens;
+	uint32_t _suppressed;
+	uint64_t _lastRefillMs;
+};
+
+/**
+ * Scans the top level members of a JSON object for "returnValue" without building a DOM.
+ * The whole payload is checked to be valid JSON, nesting over 32 levels is not scanned.
+ * @param payload the JSON payload.
+ * @return 1 if returnValue is true, 0 if returnValue is false,
+ *         -1 if returnValue is not present, not a boolean or the payload could not be scanned.
+ */
+int scanReturnValue(const char* payload);
+
+} // Namespace LSHelpers
+
+/**
+ * Logs a message if the level is enabled and the message id is within its rate limit.
+ * Arguments are not evaluated if the level is disabled or the message is suppressed.
+ * The first message after suppression is preceded with the number of suppressed messages.
+ */
+#define LOG_LS_RATE_LIMITED(level, logFunc, msgid, kvcount, ...)                                      \
+do {                                                                                                 \
+    PmLogContext _logContext = PmLogGetLibContext();                                                 \
+    if (PmLogIsEnabled(_logContext, level))                                                          \
+    {                                                                                                \
+        static LSHelpers::LogRateLimiter& _logLimiter = LSHelpers::LogRateLimiter::forMessage(msgid); \
+        uint32_t _logSuppressed = 0;                                                                 \
+        if (_logLimiter.allow(_logSuppressed))                                                       \
+        {                                                                                            \
+            if (unlikely(_logSuppressed > 0))                                                        \
+            {                                                                                        \
+                (void) logFunc(_logContext, msgid, 1,                                                \
+                               PMLOGKFV("SUPPRESSED", "%u", _logSuppressed),                         \
+                               "Messages suppressed by rate limit");                                 \
+            }                                                                                        \
+            (void) logFunc(_logContext, msgid, kvcount, ##__VA_ARGS__);                              \
+        }                                                                                            \
+    }                                                                                                \
+} while (0)
+
 /** use these for key-value pair printing */
 #define LOG_LS_TRACE(...)                    PMLOG_TRACE(__VA_ARGS__)
-#define LOG_LS_DEBUG(...)                    (void) PmLogDebug(PmLogGetLibContext(), ##__VA_ARGS__)
-#define LOG_LS_INFO(msgid, kvcount, ...)     (void) PmLogInfo(PmLogGetLibContext(), msgid, kvcount, ##__VA_ARGS__)
-#define LOG_LS_WARNING(msgid, kvcount, ...)  (void) PmLogWarning(PmLogGetLibContext(), msgid, kvcount, ##__VA_ARGS__)
-#define LOG_ERROR(msgid, kvcount, ...)    (void) PmLogError(PmLogGetLibContext(), msgid, kvcount, ##__VA_ARGS__)
-#define LOG_LS_CRITICAL(msgid, kvcount, ...) (void) PmLogCritical(PmLogGetLibContext(), msgid, kvcount, ##__VA_ARGS__)
+#define LOG_LS_DEBUG(...)                                        \
+do {                                                             \
+    PmLogContext _logContext = PmLogGetLibContext();             \
+    if (PmLogIsEnabled(_logContext, kPmLogLevel_Debug))          \
+    {                                                            \
+        (void) PmLogDebug(_logContext, ##__VA_ARGS__);           \
+    }                                                            \
+} while (0)
+#define LOG_LS_INFO(msgid, kvcount, ...)     LOG_LS_RATE_LIMITED(kPmLogLevel_Info, PmLogInfo, msgid, kvcount, ##__VA_ARGS__)
+#define LOG_LS_WARNING(msgid, kvcount, ...)  LOG_LS_RATE_LIMITED(kPmLogLevel_Warning, PmLogWarning, msgid, kvcount, ##__VA_ARGS__)
+#define LOG_ERROR(msgid, kvcount, ...)       LOG_LS_RATE_LIMITED(kPmLogLevel_Error, PmLogError, msgid, kvcount, ##__VA_ARGS__)
+#define LOG_LS_CRITICAL(msgid, kvcount, ...) LOG_LS_RATE_LIMITED(kPmLogLevel_Critical, PmLogCritical, msgid, kvcount, ##__VA_ARGS__)
 
 std::string string_format_valist(const std::string& fmt_str, va_list ap);
 
@@ -41,21 +129,35 @@ std::string string_format_valist(const std::string& fmt_str, va_list ap);
 #define MSGID_LS_INVALID_URI                  "LS_INVALID_URI"  /* Uri not valid */
 #define MSGID_LS_INVALID_JVALUE               "LS_INVALID_JVALUE"  /* JValue not valid */
 #define MSGID_LS_CALL_JSON_PARSE_FAILED       "LS_CALL_PARSE_FAILED"  /* Failed to parse call payload to json*/
+#define MSGID_LS_SAMPLED_VALIDATION_FAILED    "LS_SAMPLED_VALIDATION_FAILED"  /* Sampled request failed the schema, handled anyway. */
 #define MSGID_LS_UNEXPECTED_EXCEPTION         "LS_UNEXPECTED_EXCEPTION"  /* Application throws exception while processing method call*/
 #define MSGID_LS_DOUBLE_DEFER                 "LS_DOUBLE_DEFER"  /* A request was deferred twice*/
 #define MSGID_LS_CALL_RESPONSE_INVALID_HANDLE "LS_CALL_RESPONSE_INVALID_HANDLE"  /* Invalid handle passed to call response handler*/
 #define MSGID_LS_HUB_ERROR                    "LS_HUB_ERROR"  /* Hub error in response. */
+#define MSGID_LS_SLOW_CALL                    "LS_SLOW_CALL"  /* Call round trip above the slow call threshold. */
+#define MSGID_LS_TRACE_FILE                   "LS_TRACE_FILE"  /* Failed to open the trace file. */
 #define MSGID_LS_RESPONSE_JSON_PARSE_FAILED   "LS_RESPONSE_JSON_PARSE_FAILED"  /* Json parse of the response failede. */
 #define MSGID_LS_RESPONSE_PARAMETERS_ERROR    "LS_RESPONSE_PARAMETERS_ERRO"  /* JsonRespose.get call failed. */
 #define MSGID_LS_INVALID_CATEGORY_NAME        "LS_INVALID_CATEGORY_NAME"  /* Category name not valid. */
 #define MSGID_LS_INVALID_METHOD_NAME          "LS_INVALID_METHOD_NAME"  /* Method name not valid. */
 
+// API error codes, also the keys of the method error counters.
+#define API_ERROR_CODE_UNKNOWN               1
+#define API_ERROR_CODE_MALFORMED_JSON        2
+#define API_ERROR_CODE_SCHEMA_VALIDATION     3
+#define API_ERROR_CODE_NO_RESPONSE           4
+#define API_ERROR_CODE_REMOVED               5
+#define API_ERROR_CODE_BUSY                  6
+#define API_ERROR_CODE_RATE_LIMITED          7
+
 // API error responses.
-#define API_ERROR_UNKNOWN                    ErrorResponse(1, "Unknown error")
-#define API_ERROR_MALFORMED_JSON             ErrorResponse(2, "Malformed JSON")
-#define API_ERROR_SCHEMA_VALIDATION(...)     ErrorResponse(3, __VA_ARGS__)
-#define API_ERROR_NO_RESPONSE                ErrorResponse(4, "The service did not send a reply")
-#define API_ERROR_REMOVED                    ErrorResponse(5, "Method is removed")
+#define API_ERROR_UNKNOWN                    ErrorResponse(API_ERROR_CODE_UNKNOWN, "Unknown error")
+#define API_ERROR_MALFORMED_JSON             ErrorResponse(API_ERROR_CODE_MALFORMED_JSON, "Malformed JSON")
+#define API_ERROR_SCHEMA_VALIDATION(...)     ErrorResponse(API_ERROR_CODE_SCHEMA_VALIDATION, __VA_ARGS__)
+#define API_ERROR_NO_RESPONSE                ErrorResponse(API_ERROR_CODE_NO_RESPONSE, "The service did not send a reply")
+#define API_ERROR_REMOVED                    ErrorResponse(API_ERROR_CODE_REMOVED, "Method is removed")
+#define API_ERROR_BUSY                       ErrorResponse(API_ERROR_CODE_BUSY, "Service is busy, try again later")
+#define API_ERROR_RATE_LIMITED               ErrorResponse(API_ERROR_CODE_RATE_LIMITED, "Too many requests, try again later")
 
 // Copy of LSError utility functions from luna-service2. Used to generate LS::Errors.
 
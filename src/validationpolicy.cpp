@@ -0,0 +1,109 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cstring>
+
+#include "validationpolicy.hpp"
+
+using namespace pbnjson;
+
+namespace LSHelpers {
+
+ValidationPolicy::ValidationPolicy(Mode mode, uint32_t interval, std::vector<std::string> senders)
+		: mMode(mode)
+		, mInterval(interval > 0 ? interval : 1)
+		, mTrustedSenders(std::move(senders))
+		, mRequests(0)
+		, mValidated(0)
+		, mFailed(0)
+{
+	std::sort(mTrustedSenders.begin(), mTrustedSenders.end());
+}
+
+ValidationPolicy::ValidationPolicy(const ValidationPolicy& other)
+		: ValidationPolicy(other.mMode, other.mInterval, other.mTrustedSenders)
+{
+}
+
+ValidationPolicy ValidationPolicy::always()
+{
+	return ValidationPolicy(Mode::Always, 1, {});
+}
+
+ValidationPolicy ValidationPolicy::sampled(uint32_t interval)
+{
+	return ValidationPolicy(Mode::Sampled, interval, {});
+}
+
+ValidationPolicy ValidationPolicy::trustedSenders(std::vector<std::string> senders)
+{
+	return ValidationPolicy(Mode::TrustedSenders, 1, std::move(senders));
+}
+
+const JSchema& ValidationPolicy::selectSchema(const JSchema& schema, const char* senderServiceName)
+{
+	uint64_t request = mRequests.fetch_add(1, std::memory_order_relaxed);
+
+	bool validate;
+	switch (mMode)
+	{
+		case Mode::Sampled:
+			validate = request % mInterval == 0;
+			break;
+		case Mode::TrustedSenders:
+			validate = !isTrusted(senderServiceName);
+			break;
+		default:
+			validate = true;
+	}
+
+	if (!validate)
+	{
+		return JSchema::AllSchema();
+	}
+
+	mValidated.fetch_add(1, std::memory_order_relaxed);
+	return schema;
+}
+
+bool ValidationPolicy::isTrusted(const char* senderServiceName) const
+{
+	if (!senderServiceName)
+	{
+		return false;
+	}
+
+	// Binary search without constructing a std::string for the sender.
+	auto iter = std::lower_bound(mTrustedSenders.begin(), mTrustedSenders.end(), senderServiceName,
+	                             [](const std::string& trusted, const char* sender)
+	                             {
+		                             return strcmp(trusted.c_str(), sender) < 0;
+	                             });
+
+	return iter != mTrustedSenders.end() && *iter == senderServiceName;
+}
+
+ValidationStats ValidationPolicy::getStats() const
+{
+	uint64_t requests = mRequests.load(std::memory_order_relaxed);
+	uint64_t validated = mValidated.load(std::memory_order_relaxed);
+	return ValidationStats{validated,
+	                       requests > validated ? requests - validated : 0,
+	                       mFailed.load(std::memory_order_relaxed)};
+}
+
+} // namespace LSHelpers
@@ -0,0 +1,134 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "util.hpp"
+#include "workerpool.hpp"
+
+namespace LSHelpers {
+
+WorkerPool::WorkerPool(size_t threadCount, size_t queueCapacity)
+		: mWorkerQueues(threadCount > 0 ? threadCount : 1)
+		, mQueueCapacity(queueCapacity)
+		, mQueueSize(0)
+		, mStopping(false)
+{
+	for (size_t worker = 0; worker < mWorkerQueues.size(); worker++)
+	{
+		mThreads.emplace_back(&WorkerPool::run, this, worker);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+
+	for (auto& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+bool WorkerPool::submit(Task task)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!enqueue(std::move(task), mSharedQueue))
+	{
+		return false;
+	}
+	lock.unlock();
+
+	mCondition.notify_one();
+	return true;
+}
+
+bool WorkerPool::submit(Task task, size_t key)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!enqueue(std::move(task), mWorkerQueues[key % mWorkerQueues.size()]))
+	{
+		return false;
+	}
+	lock.unlock();
+
+	// Only the owner of the queue can take the task, wake all to reach it.
+	mCondition.notify_all();
+	return true;
+}
+
+size_t WorkerPool::getQueueSize() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mQueueSize;
+}
+
+bool WorkerPool::enqueue(Task&& task, std::deque<Task>& queue)
+{
+	if (mStopping || mQueueSize >= mQueueCapacity)
+	{
+		return false;
+	}
+
+	queue.push_back(std::move(task));
+	mQueueSize++;
+	return true;
+}
+
+void WorkerPool::run(size_t worker)
+{
+	std::deque<Task>& ownQueue = mWorkerQueues[worker];
+
+	while (true)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this, &ownQueue]()
+			{
+				return mStopping || !ownQueue.empty() || !mSharedQueue.empty();
+			});
+
+			// Keyed tasks first, they can not run anywhere else.
+			std::deque<Task>& queue = !ownQueue.empty() ? ownQueue : mSharedQueue;
+			if (queue.empty())
+			{
+				return; // Stopping and nothing left to run.
+			}
+
+			task = std::move(queue.front());
+			queue.pop_front();
+			mQueueSize--;
+		}
+
+		try
+		{
+			task();
+		}
+		catch (const std::exception& e)
+		{
+			LOG_ERROR(MSGID_LS_UNEXPECTED_EXCEPTION, 0, "Worker task throws exception: %s", e.what());
+		}
+		catch (...)
+		{
+			LOG_ERROR(MSGID_LS_UNEXPECTED_EXCEPTION, 0, "Worker task throws exception");
+		}
+	}
+}
+
+} // namespace LSHelpers
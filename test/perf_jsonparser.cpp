@@ -0,0 +1,546 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Micro benchmarks for JsonParser. Run manually, results are printed to stdout.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace pbnjson;
+
+static volatile uint64_t sink; // Keeps the compiler from optimizing the benchmarked code away.
+
+template<typename F>
+static void benchmark(const char* name, size_t iterations, F func)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		func();
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+	printf("%-60s %10.1f ns/op\n", name, double(elapsed.count()) / iterations);
+}
+
+/* Number decoding: the previous implementation converted through JValue number conversions. */
+
+static void legacyParseUint64(const JValue& value, uint64_t& destination)
+{
+	double val = 0;
+	double intVal = 0;
+	ConversionResultFlags f = value.isNumber() ? value.asNumber(val)
+	                                           : JValue(NumericString(value.asString())).asNumber(val);
+	if (val < 0 || val > UINT64_MAX || std::modf(val, &intVal) != 0)
+	{
+		f |= CONV_PRECISION_LOSS;
+	}
+	destination = f == CONV_OK ? static_cast<uint64_t>(intVal) : 0;
+}
+
+static void legacyParseUint8(const JValue& value, uint8_t& destination)
+{
+	int32_t val = 0;
+	ConversionResultFlags f = value.isNumber() ? value.asNumber(val)
+	                                           : JValue(NumericString(value.asString())).asNumber(val);
+	destination = f == CONV_OK && val >= 0 && val <= UINT8_MAX ? static_cast<uint8_t>(val) : 0;
+}
+
+static void benchmarkNumbers()
+{
+	const size_t N = 1000000;
+	JValue json = JDomParser::fromString(R"json({
+"small": 200,
+"large": 18446744073709551615,
+"smallString": "200",
+"largeString": "18446744073709551615",
+"double": 3.14159,
+"doubleString": "3.14159"
+})json", JSchema::AllSchema());
+
+	JValue small = json["small"];
+	JValue large = json["large"];
+	JValue smallString = json["smallString"];
+	JValue largeString = json["largeString"];
+	JValue dbl = json["double"];
+	JValue dblString = json["doubleString"];
+
+	uint8_t u8 = 0;
+	uint64_t u64 = 0;
+	double d = 0;
+
+	benchmark("uint8_t from number, legacy", N, [&]() { legacyParseUint8(small, u8); sink += u8; });
+	benchmark("uint8_t from number", N, [&]() { LSHelpers::JsonParser::parseValue(small, u8); sink += u8; });
+	benchmark("uint8_t from string, legacy", N, [&]() { legacyParseUint8(smallString, u8); sink += u8; });
+	benchmark("uint8_t from string", N, [&]() { LSHelpers::JsonParser::parseValue(smallString, u8); sink += u8; });
+	benchmark("uint64_t from number, legacy (inexact)", N, [&]() { legacyParseUint64(large, u64); sink += u64; });
+	benchmark("uint64_t from number", N, [&]() { LSHelpers::JsonParser::parseValue(large, u64); sink += u64; });
+	benchmark("uint64_t from string, legacy (inexact)", N, [&]() { legacyParseUint64(largeString, u64); sink += u64; });
+	benchmark("uint64_t from string", N, [&]() { LSHelpers::JsonParser::parseValue(largeString, u64); sink += u64; });
+	benchmark("double from number, legacy", N, [&]() { dbl.asNumber(d); sink += uint64_t(d); });
+	benchmark("double from number", N, [&]() { LSHelpers::JsonParser::parseValue(dbl, d); sink += uint64_t(d); });
+	benchmark("double from string, legacy", N, [&]() { JValue(NumericString(dblString.asString())).asNumber(d); sink += uint64_t(d); });
+	benchmark("double from string", N, [&]() { LSHelpers::JsonParser::parseValue(dblString, d); sink += uint64_t(d); });
+}
+
+/* Arrays */
+
+static std::string makeIntArrayPayload(size_t size)
+{
+	std::string payload = "{\"array\":[";
+	for (size_t i = 0; i < size; i++)
+	{
+		payload += (i > 0 ? "," : "") + std::to_string(i % 1000);
+	}
+	payload += "]}";
+	return payload;
+}
+
+static void benchmarkArrays()
+{
+	const size_t N = 100;
+	const size_t SIZE = 10000;
+	LSHelpers::JsonParser parser(makeIntArrayPayload(SIZE));
+	std::vector<int32_t> values;
+
+	std::function<void(const JValue&, int32_t&)> stdFunction = &LSHelpers::JsonParser::parseValueOrDataObject<int32_t>;
+	benchmark("getArray 10k int32_t, std::function parser", N, [&]()
+	{
+		parser.getArray("array", values, stdFunction);
+		sink += values.size();
+	});
+
+	benchmark("getArray 10k int32_t, template parser", N, [&]()
+	{
+		parser.getArray("array", values);
+		sink += values.size();
+	});
+
+	benchmark("getNumericArray 10k int32_t", N, [&]()
+	{
+		parser.getNumericArray("array", values);
+		sink += values.size();
+	});
+
+	const size_t LARGE_SIZE = 100000;
+	std::string doublePayload = "{\"array\":[";
+	for (size_t i = 0; i < LARGE_SIZE; i++)
+	{
+		doublePayload += (i > 0 ? "," : "") + std::to_string(i * 0.25);
+	}
+	doublePayload += "]}";
+
+	LSHelpers::JsonParser largeParser(doublePayload);
+	std::vector<double> doubles;
+	std::vector<int16_t> shorts(LARGE_SIZE);
+	size_t count = 0;
+
+	benchmark("getArray 100k double", 10, [&]()
+	{
+		largeParser.getArray("array", doubles);
+		sink += doubles.size();
+	});
+
+	benchmark("getNumericArray 100k double", 10, [&]()
+	{
+		largeParser.getNumericArray("array", doubles);
+		sink += doubles.size();
+	});
+
+	LSHelpers::JsonParser intParser(makeIntArrayPayload(LARGE_SIZE));
+	benchmark("getNumericArray 100k int16_t to buffer", 10, [&]()
+	{
+		intParser.getNumericArray("array", shorts.data(), shorts.size(), count);
+		sink += count;
+	});
+}
+
+/* String to enum mapping */
+
+static void benchmarkEnums()
+{
+	const size_t N = 1000000;
+	LSHelpers::JsonParser parser(std::string(R"json({"state":"suspended"})json"));
+	int state = 0;
+
+	static const std::unordered_map<std::string, int> STATE_MAP {
+		{"idle", 0}, {"running", 1}, {"suspended", 2}, {"stopped", 3}};
+	static const LSHelpers::StringMap<int, 4> STATE_STRING_MAP {{
+		{"idle", 0}, {"running", 1}, {"suspended", 2}, {"stopped", 3}}};
+
+	benchmark("getAndMap unordered_map", N, [&]()
+	{
+		parser.getAndMap("state", state, STATE_MAP);
+		sink += state;
+	});
+
+	benchmark("getAndMap initializer_list", N, [&]()
+	{
+		parser.getAndMap<std::string, int>("state", state, {
+			{"idle", 0}, {"running", 1}, {"suspended", 2}, {"stopped", 3}});
+		sink += state;
+	});
+
+	benchmark("getAndMap StringMap", N, [&]()
+	{
+		parser.getAndMap("state", state, STATE_STRING_MAP);
+		sink += state;
+	});
+}
+
+/* Strings */
+
+static void benchmarkStrings()
+{
+	const size_t N = 1000000;
+	LSHelpers::JsonParser parser(std::string(R"json({"appId":"com.webos.app.mediaplayer.background"})json"));
+
+	benchmark("get std::string", N, [&]()
+	{
+		std::string value;
+		parser.get("appId", value);
+		sink += value.size();
+	});
+
+	benchmark("get StringRef", N, [&]()
+	{
+		LSHelpers::StringRef value;
+		parser.get("appId", value);
+		sink += value.size();
+	});
+
+	benchmark("get InternedString", N, [&]()
+	{
+		LSHelpers::InternedString value;
+		parser.get("appId", value);
+		sink += value.size();
+	});
+}
+
+/* Error path */
+
+/**
+ * Dispatches like JsonRequest::handleLunaCall - converts exceptions to error responses.
+ */
+template<typename H>
+static JValue dispatch(const H& handler, LSHelpers::JsonParser& request)
+{
+	try
+	{
+		return handler(request);
+	}
+	catch (const LSHelpers::JsonParseError& e)
+	{
+		return LSHelpers::ErrorResponse(3, std::string(e.what()));
+	}
+	catch (const LSHelpers::ErrorResponse& e)
+	{
+		return e;
+	}
+}
+
+static void benchmarkErrors()
+{
+	const size_t N = 100000;
+	LSHelpers::JsonParser invalidRequest(std::string(R"json({"id":"not a number"})json"));
+	LSHelpers::JsonParser validRequest(std::string(R"json({"id":5})json"));
+
+	auto throwingHandler = [](LSHelpers::JsonParser& request) -> JValue
+	{
+		int32_t id = 0;
+		request.clearError();
+		request.get("id", id);
+		request.finishParseOrThrow(true);
+
+		if (id > 1)
+		{
+			throw LSHelpers::ErrorResponse(105, std::string("Context not found"));
+		}
+		return true;
+	};
+
+	auto returningHandler = [](LSHelpers::JsonParser& request) -> JValue
+	{
+		int32_t id = 0;
+		request.clearError();
+		request.get("id", id);
+
+		if (!request.finishParse(true))
+		{
+			return LSHelpers::ErrorResponse(3, request.getError());
+		}
+
+		if (id > 1)
+		{
+			return LSHelpers::ErrorResponse(105, std::string("Context not found"));
+		}
+		return true;
+	};
+
+	benchmark("invalid parameter, throw JsonParseError", N, [&]()
+	{
+		sink += dispatch(throwingHandler, invalidRequest).isObject();
+	});
+
+	benchmark("invalid parameter, return error response", N, [&]()
+	{
+		sink += dispatch(returningHandler, invalidRequest).isObject();
+	});
+
+	benchmark("handler error, throw ErrorResponse", N, [&]()
+	{
+		sink += dispatch(throwingHandler, validRequest).isObject();
+	});
+
+	benchmark("handler error, return ErrorResponse", N, [&]()
+	{
+		sink += dispatch(returningHandler, validRequest).isObject();
+	});
+}
+
+/* Arrays of objects */
+
+class AppInfo : public LSHelpers::JsonDataObject
+{
+public:
+	std::string id;
+	int64_t size;
+	bool visible;
+
+	void parseFromJson(const JValue& value) override
+	{
+		LSHelpers::JsonParser parser(value);
+		parser.get("id", id);
+		parser.get("size", size);
+		parser.get("visible", visible).optional().defaultValue(true);
+		parser.finishParseOrThrow();
+	}
+};
+
+static void benchmarkObjectArrays()
+{
+	const size_t N = 10;
+	const size_t SIZE = 10000;
+
+	std::string payload = "{\"apps\":[";
+	for (size_t i = 0; i < SIZE; i++)
+	{
+		payload += (i > 0 ? "," : "");
+		payload += "{\"id\":\"com.app" + std::to_string(i) + "\",\"size\":" + std::to_string(i * 1024) + ",\"visible\":true}";
+	}
+	payload += "]}";
+
+	LSHelpers::JsonParser parser(payload);
+
+	std::vector<AppInfo> apps;
+	benchmark("getArray 10k JsonDataObject", N, [&]()
+	{
+		parser.getArray("apps", apps);
+		sink += apps.size();
+	});
+
+	AppInfo app;
+	benchmark("forEachElement 10k JsonDataObject, find middle", N, [&]()
+	{
+		parser.forEachElement("apps", app, [&](const AppInfo& a) { return a.size != int64_t(SIZE / 2 * 1024); });
+		sink += app.size;
+	});
+
+	std::vector<std::string> ids;
+	std::vector<int64_t> sizes;
+	std::vector<bool> visible;
+	size_t count = 0;
+	benchmark("getColumns 10k objects, 3 columns", N, [&]()
+	{
+		parser.getColumns("apps", count,
+		                  LSHelpers::column("id", ids),
+		                  LSHelpers::column("size", sizes),
+		                  LSHelpers::optionalColumn("visible", visible, true));
+		sink += count;
+	});
+}
+
+struct AppStruct : public LSHelpers::JsonStruct<AppStruct>
+{
+	std::string id;
+	int64_t size;
+	bool visible;
+
+	template<typename V>
+	void jsonFields(V& field)
+	{
+		field("id", id);
+		field("size", size);
+		field("visible", visible).optional().defaultValue(true);
+	}
+};
+
+static void benchmarkWriter()
+{
+	const size_t N = 100;
+	const size_t COUNT = 1000;
+	LSHelpers::JsonWriter writer;
+
+	benchmark("serialize 1k objects, JValue", N, [&]()
+	{
+		JArray apps;
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			apps.append(JObject{{"id", "com.webos.app.test"}, {"size", int64_t(i)}, {"visible", true}});
+		}
+		JValue response = JObject{{"returnValue", true}, {"apps", apps}};
+		sink += response.stringify().size();
+	});
+
+	benchmark("serialize 1k objects, JsonWriter", N, [&]()
+	{
+		writer.clear();
+		writer.beginObject().field("returnValue", true).key("apps").beginArray();
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			writer.beginObject()
+				.field("id", "com.webos.app.test")
+				.field("size", i)
+				.field("visible", true)
+				.endObject();
+		}
+		writer.endArray().endObject();
+		sink += writer.size();
+	});
+
+	std::vector<AppStruct> apps(COUNT);
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		apps[i].id = "com.webos.app.test";
+		apps[i].size = i;
+		apps[i].visible = true;
+	}
+
+	benchmark("serialize 1k objects, JsonStruct", N, [&]()
+	{
+		writer.clear();
+		writer.beginObject().field("returnValue", true).field("apps", apps).endObject();
+		sink += writer.size();
+	});
+}
+
+static void benchmarkOffload()
+{
+	const size_t N = 1000;
+	LSHelpers::PayloadOffload offload;
+
+	JValue small = JObject{{"returnValue", true}, {"appId", "com.webos.app.test"}, {"visible", true}};
+	JArray apps;
+	for (size_t i = 0; i < 10000; i++)
+	{
+		apps.append(JObject{{"id", "com.webos.app.test"}, {"size", int64_t(i)}, {"visible", true}});
+	}
+	JValue large = JObject{{"returnValue", true}, {"apps", apps}};
+
+	benchmark("small response, stringify", N * 100, [&]()
+	{
+		sink += small.stringify().size();
+	});
+
+	benchmark("small response, size estimate", N * 100, [&]()
+	{
+		sink += LSHelpers::PayloadOffload::estimateSize(small, offload.threshold);
+	});
+
+	benchmark("10k objects response, stringify", N / 10, [&]()
+	{
+		sink += large.stringify().size();
+	});
+
+	benchmark("10k objects response, size estimate to 256k", N / 10, [&]()
+	{
+		sink += LSHelpers::PayloadOffload::estimateSize(large, offload.threshold);
+	});
+}
+
+static void benchmarkMetrics()
+{
+	const size_t N = 10000000;
+	LSHelpers::Histogram histogram;
+	uint64_t value = 1;
+
+	benchmark("histogram record", N, [&]()
+	{
+		value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+		histogram.record(value >> 44);
+	});
+
+	benchmark("clock read", N, [&]()
+	{
+		sink += LSHelpers::MethodMetrics::nowUs();
+	});
+
+	sink += histogram.getPercentile(99);
+}
+
+static void benchmarkTracing()
+{
+	const size_t N = 1000000;
+	const char* payload = R"({"appId":"com.webos.app.test","visible":true})";
+	LSHelpers::TraceContext context{LSHelpers::Tracer::newId(), LSHelpers::Tracer::newId()};
+	std::string traced = LSHelpers::Tracer::inject(payload, context);
+	std::string stripped;
+
+	benchmark("trace field check, untraced payload", N * 10, [&]()
+	{
+		LSHelpers::TraceContext caller;
+		sink += LSHelpers::Tracer::extract(payload, caller, stripped);
+	});
+
+	benchmark("trace field extract", N, [&]()
+	{
+		LSHelpers::TraceContext caller;
+		sink += LSHelpers::Tracer::extract(traced.c_str(), caller, stripped);
+	});
+
+	benchmark("span, not traced", N * 10, [&]()
+	{
+		LSHelpers::ScopedSpan span(LSHelpers::SpanKind::Handler, nullptr, LSHelpers::TraceContext());
+	});
+
+	std::string path = "/tmp/perf-trace-" + std::to_string(getpid()) + ".json";
+	LSHelpers::Tracer::start(path, 10);
+	benchmark("span, traced", N, [&]()
+	{
+		LSHelpers::ScopedSpan span(LSHelpers::SpanKind::Handler, nullptr, context);
+	});
+	LSHelpers::Tracer::stop();
+	unlink(path.c_str());
+	sink += LSHelpers::Tracer::getDropped();
+}
+
+int main(int argc, char **argv)
+{
+	benchmarkNumbers();
+	benchmarkArrays();
+	benchmarkObjectArrays();
+	benchmarkEnums();
+	benchmarkStrings();
+	benchmarkErrors();
+	benchmarkWriter();
+	benchmarkOffload();
+	benchmarkMetrics();
+	benchmarkTracing();
+	return 0;
+}
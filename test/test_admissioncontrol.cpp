@@ -0,0 +1,249 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using LSHelpers::AdmissionControl;
+using LSHelpers::AdmissionLimits;
+using LSHelpers::AdmissionStats;
+
+typedef AdmissionControl::Decision Decision;
+
+// Admit a request of a sender, expecting nothing displaced.
+static Decision admit(AdmissionControl& control, const std::string& sender = "", uint64_t nowMs = 0)
+{
+	LS::Message message;
+	LS::Message displaced;
+	Decision decision = control.admit(message, sender, 1, displaced, nowMs);
+	EXPECT_FALSE(bool(displaced));
+	return decision;
+}
+
+TEST(TestAdmissionControl, Unlimited)
+{
+	AdmissionControl control{AdmissionLimits()};
+
+	for (int i = 0; i < 100; i++)
+	{
+		EXPECT_EQ(Decision::Admit, admit(control));
+	}
+
+	AdmissionStats stats = control.getStats();
+	EXPECT_EQ(100u, stats.admitted);
+	EXPECT_EQ(100u, stats.inFlight);
+	EXPECT_EQ(0u, stats.rejected);
+}
+
+TEST(TestAdmissionControl, QueueAndReject)
+{
+	AdmissionControl control{AdmissionLimits(2, 1)};
+	LS::Message next;
+
+	EXPECT_EQ(Decision::Admit, admit(control));
+	EXPECT_EQ(Decision::Admit, admit(control));
+	EXPECT_EQ(Decision::Queue, admit(control));
+	EXPECT_EQ(Decision::Reject, admit(control));
+
+	AdmissionStats stats = control.getStats();
+	EXPECT_EQ(2u, stats.admitted);
+	EXPECT_EQ(1u, stats.queued);
+	EXPECT_EQ(1u, stats.rejected);
+	EXPECT_EQ(2u, stats.inFlight);
+	EXPECT_EQ(1u, stats.queueDepth);
+
+	// Queued request takes over the released slot.
+	EXPECT_TRUE(control.release(next));
+	stats = control.getStats();
+	EXPECT_EQ(3u, stats.admitted);
+	EXPECT_EQ(2u, stats.inFlight);
+	EXPECT_EQ(0u, stats.queueDepth);
+
+	EXPECT_FALSE(control.release(next));
+	EXPECT_FALSE(control.release(next));
+	EXPECT_EQ(0u, control.getStats().inFlight);
+
+	EXPECT_EQ(Decision::Admit, admit(control));
+}
+
+TEST(TestAdmissionControl, ArrivalTime)
+{
+	AdmissionControl control{AdmissionLimits(1, 2)};
+	AdmissionControl fair{AdmissionLimits(1, 2).fairQueuing()};
+	LS::Message message;
+	LS::Message displaced;
+	LS::Message next;
+
+	// Queued requests keep their arrival time, the time to respond includes the wait.
+	for (AdmissionControl* queue : {&control, &fair})
+	{
+		uint64_t arrivalUs = 0;
+		EXPECT_EQ(Decision::Admit, queue->admit(message, "a", 1, displaced, 0, 100));
+		EXPECT_EQ(Decision::Queue, queue->admit(message, "a", 1, displaced, 0, 200));
+		EXPECT_EQ(Decision::Queue, queue->admit(message, "a", 1, displaced, 0, 300));
+
+		EXPECT_TRUE(queue->release(next, &arrivalUs));
+		EXPECT_EQ(200u, arrivalUs);
+		EXPECT_TRUE(queue->release(next, &arrivalUs));
+		EXPECT_EQ(300u, arrivalUs);
+		EXPECT_FALSE(queue->release(next, &arrivalUs));
+	}
+}
+
+TEST(TestAdmissionControl, NoQueue)
+{
+	AdmissionControl control{AdmissionLimits(1)};
+
+	EXPECT_EQ(Decision::Admit, admit(control));
+	EXPECT_EQ(Decision::Reject, admit(control));
+}
+
+TEST(TestAdmissionControl, SenderRate)
+{
+	// 10 per second, burst of 2.
+	AdmissionControl control{AdmissionLimits().senderRate(10, 2)};
+
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 1000));
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 1000));
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 1000));
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 1050));
+
+	// Other senders are not affected.
+	EXPECT_EQ(Decision::Admit, admit(control, "b", 1050));
+
+	// One token per 100 ms.
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 1100));
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 1100));
+
+	// Refills up to the burst.
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 5000));
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 5000));
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 5000));
+
+	EXPECT_EQ(4u, control.getStats().rateLimited);
+}
+
+TEST(TestAdmissionControl, SenderRateManySenders)
+{
+	AdmissionControl control{AdmissionLimits().senderRate(1, 1)};
+
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 1000));
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 1000));
+
+	// Time going back does not refill.
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 500));
+
+	// The least recently used senders are forgotten first.
+	for (int i = 0; i < 4095; i++)
+	{
+		EXPECT_EQ(Decision::Admit, admit(control, std::to_string(i), 1000));
+	}
+	EXPECT_EQ(Decision::RateLimited, admit(control, "a", 1000));
+	EXPECT_EQ(Decision::RateLimited, admit(control, "0", 1000));
+
+	for (int i = 4095; i < 8191; i++)
+	{
+		EXPECT_EQ(Decision::Admit, admit(control, std::to_string(i), 1000));
+	}
+	EXPECT_EQ(Decision::Admit, admit(control, "a", 1000));
+}
+
+TEST(TestAdmissionControl, FairQueuing)
+{
+	AdmissionControl control{AdmissionLimits(1, 100).fairQueuing()};
+	LS::Message message;
+	LS::Message displaced;
+	LS::Message next;
+
+	EXPECT_EQ(Decision::Admit, admit(control, "busy"));
+
+	// Chatty sender queues a lot, then others arrive.
+	for (int i = 0; i < 10; i++)
+	{
+		EXPECT_EQ(Decision::Queue, admit(control, "busy"));
+	}
+	EXPECT_EQ(Decision::Queue, admit(control, "a"));
+	EXPECT_EQ(Decision::Queue, admit(control, "b"));
+
+	// Served round robin: busy, a, b, then the rest of busy.
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_TRUE(control.release(next));
+	}
+	EXPECT_EQ(9u, control.getQueueDepth("busy"));
+	EXPECT_EQ(0u, control.getQueueDepth("a"));
+	EXPECT_EQ(0u, control.getQueueDepth("b"));
+
+	for (int i = 0; i < 9; i++)
+	{
+		EXPECT_TRUE(control.release(next));
+	}
+	EXPECT_FALSE(control.release(next));
+
+	AdmissionStats stats = control.getStats();
+	EXPECT_EQ(13u, stats.admitted);
+	EXPECT_EQ(0u, stats.queueDepth);
+}
+
+TEST(TestAdmissionControl, FairQueuingCost)
+{
+	AdmissionControl control{AdmissionLimits(1, 100).fairQueuing(2)};
+	LS::Message message;
+	LS::Message displaced;
+	LS::Message next;
+
+	EXPECT_EQ(Decision::Admit, admit(control, "a"));
+
+	// Large requests of sender a cost 4 units, b sends small ones.
+	for (int i = 0; i < 4; i++)
+	{
+		EXPECT_EQ(Decision::Queue, control.admit(message, "a", 4, displaced, 0));
+		EXPECT_EQ(Decision::Queue, control.admit(message, "b", 1, displaced, 0));
+	}
+	EXPECT_EQ(8u, control.getStats().queueDepth);
+
+	// Round 1: a has 2 units - nothing served, b gets 2 requests.
+	// Round 2: a has 4 units - one served, b gets 2 more units.
+	for (int i = 0; i < 4; i++)
+	{
+		EXPECT_TRUE(control.release(next));
+	}
+	EXPECT_EQ(3u, control.getQueueDepth("a"));
+	EXPECT_EQ(1u, control.getQueueDepth("b"));
+}
+
+TEST(TestAdmissionControl, FairQueuingDisplaces)
+{
+	AdmissionControl control{AdmissionLimits(1, 4).fairQueuing()};
+	LS::Message message;
+	LS::Message displaced;
+
+	EXPECT_EQ(Decision::Admit, admit(control, "busy"));
+	for (int i = 0; i < 4; i++)
+	{
+		EXPECT_EQ(Decision::Queue, admit(control, "busy"));
+	}
+
+	// Queue full - the chatty sender can not queue more, others displace its requests.
+	EXPECT_EQ(Decision::Reject, admit(control, "busy"));
+	EXPECT_EQ(Decision::Queue, control.admit(message, "a", 1, displaced, 0));
+	EXPECT_EQ(3u, control.getQueueDepth("busy"));
+	EXPECT_EQ(1u, control.getQueueDepth("a"));
+
+	AdmissionStats stats = control.getStats();
+	EXPECT_EQ(4u, stats.queueDepth);
+	EXPECT_EQ(2u, stats.rejected);
+}
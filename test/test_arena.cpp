@@ -0,0 +1,83 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+
+TEST(TestArena, Allocate)
+{
+	LSHelpers::Arena arena(64);
+
+	char* a = static_cast<char*>(arena.allocate(10, 1));
+	char* b = static_cast<char*>(arena.allocate(10, 1));
+	EXPECT_EQ(a + 10, b);
+
+	void* aligned = arena.allocate(8, 16);
+	EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(aligned) % 16);
+
+	// Larger than the block size.
+	void* large = arena.allocate(1000);
+	ASSERT_NE(nullptr, large);
+	memset(large, 0, 1000);
+	EXPECT_EQ(size_t{1028}, arena.getBytesAllocated());
+
+	arena.reset();
+	EXPECT_EQ(size_t{0}, arena.getBytesAllocated());
+	EXPECT_NE(nullptr, arena.allocate(100));
+}
+
+TEST(TestArena, AcquireReuse)
+{
+	LSHelpers::Arena* first;
+	{
+		LSHelpers::Arena::Ptr arena = LSHelpers::Arena::acquire();
+		first = arena.get();
+		arena->allocate(100);
+	}
+
+	LSHelpers::Arena::Ptr arena = LSHelpers::Arena::acquire();
+	EXPECT_EQ(first, arena.get());
+	EXPECT_EQ(size_t{0}, arena->getBytesAllocated());
+}
+
+TEST(TestArena, ParseDestinations)
+{
+	LSHelpers::Arena arena;
+	LSHelpers::ArenaString name{LSHelpers::ArenaAllocator<char>(arena)};
+	LSHelpers::ArenaVector<int32_t> values{LSHelpers::ArenaAllocator<int32_t>(arena)};
+	LSHelpers::ArenaVector<double> doubles{LSHelpers::ArenaAllocator<double>(arena)};
+
+	LSHelpers::JsonParser parser(std::string(
+		R"json({"name":"a name longer than the small string buffer", "values":[1, 2, 3]})json"));
+	parser.get("name", name);
+	parser.getArray("values", values);
+	parser.getNumericArray("values", doubles);
+	EXPECT_TRUE(parser.finishParse(true));
+
+	EXPECT_EQ(std::string("a name longer than the small string buffer"), name.c_str());
+	EXPECT_EQ((LSHelpers::ArenaVector<int32_t>{{1, 2, 3}, LSHelpers::ArenaAllocator<int32_t>(arena)}), values);
+	ASSERT_EQ(size_t{3}, doubles.size());
+	EXPECT_DOUBLE_EQ(3.0, doubles[2]);
+	EXPECT_GT(arena.getBytesAllocated(), size_t{0});
+}
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
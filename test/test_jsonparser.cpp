@@ -196,6 +196,59 @@ TEST(TestJsonParser, JsonParserArraylTest)
 	EXPECT_FALSE(jp.hasError());
 }
 
+TEST(TestJsonParser, JsonParserCustomParserTest)
+{
+	std::string payload = R"json({
+"intValue":1234,
+"intArray":[1,2,3]
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_FALSE(jp.hasError());
+
+	auto doubleIt = [](const JValue& value, int& destination)
+	{
+		LSHelpers::JsonParser::parseValue(value, destination);
+		destination *= 2;
+	};
+
+	int intTest = 0;
+	jp.get("intValue", intTest, doubleIt);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(2468, intTest);
+
+	std::function<void(const JValue&, int&)> doubleItFunction = doubleIt;
+	intTest = 0;
+	jp.get("intValue", intTest, doubleItFunction);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(2468, intTest);
+
+	std::vector<int> intArrayTest;
+	jp.getArray("intArray", intArrayTest, doubleIt);
+	EXPECT_FALSE(jp.hasError());
+	ASSERT_EQ(3U, intArrayTest.size());
+	EXPECT_EQ(2, intArrayTest[0]);
+	EXPECT_EQ(6, intArrayTest[2]);
+
+	intArrayTest.clear();
+	jp.getArray("intArray", intArrayTest, doubleItFunction);
+	EXPECT_FALSE(jp.hasError());
+	ASSERT_EQ(3U, intArrayTest.size());
+	EXPECT_EQ(4, intArrayTest[1]);
+
+	auto failIt = [](const JValue& value, int& destination)
+	{
+		throw LSHelpers::JsonParseError("custom error");
+	};
+
+	intTest = 10;
+	bool valueRead = true;
+	jp.get("intValue", intTest, failIt).checkValueRead(valueRead);
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10, intTest);
+}
+
 TEST(TestJsonParser, JsonParserInvalidJsonTest)
 {
 	std::string payloadInvalid = R"json({"}})json";
@@ -360,6 +413,113 @@ TEST(TestJsonParser, JsonParserIntegerLimitsTest)
 }
 
 
+TEST(TestJsonParser, JsonParserInteger64Test)
+{
+	std::string payload = R"json({
+"uint64Max": 18446744073709551615,
+"uint64Overflow": 18446744073709551616,
+"above2pow53": 9007199254740993,
+"int64Min": -9223372036854775808,
+"int64Underflow": -9223372036854775809,
+"uint64MaxString": "18446744073709551615",
+"int64MinString": "-9223372036854775808",
+"exponent": 1.5e1,
+"zeroFraction": 2.0,
+"fractionString": "2.5"
+})json";
+
+	uint64_t uint64;
+	int64_t int64;
+	int32_t int32;
+	bool valueRead;
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_TRUE(jp.isValidJson());
+
+	uint64 = 10;
+	jp.get("uint64Max", uint64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(UINT64_MAX, uint64);
+
+	uint64 = 10;
+	jp.get("uint64MaxString", uint64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(UINT64_MAX, uint64);
+
+	uint64 = 10;
+	jp.get("uint64Overflow", uint64).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10U, uint64);
+
+	uint64 = 10;
+	jp.get("above2pow53", uint64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(9007199254740993ULL, uint64);
+
+	int64 = 10;
+	jp.get("above2pow53", int64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(9007199254740993LL, int64);
+
+	int64 = 10;
+	jp.get("int64Min", int64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(INT64_MIN, int64);
+
+	int64 = 10;
+	jp.get("int64MinString", int64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(INT64_MIN, int64);
+
+	int64 = 10;
+	jp.get("int64Underflow", int64).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10, int64);
+
+	uint64 = 10;
+	jp.get("int64Min", uint64).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10U, uint64);
+
+	int32 = 10;
+	jp.get("exponent", int32).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(15, int32);
+
+	int32 = 10;
+	jp.get("zeroFraction", int32).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(2, int32);
+
+	int32 = 10;
+	jp.get("fractionString", int32).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10, int32);
+
+	// Numbers created in code, not parsed from text.
+	LSHelpers::JsonParser jp2(JObject{{"int", 300}, {"negative", -1}, {"double", 2.5}});
+
+	uint64 = 10;
+	jp2.get("int", uint64).checkValueRead(valueRead);
+	EXPECT_TRUE(valueRead);
+	EXPECT_EQ(300U, uint64);
+
+	uint8_t uint8 = 10;
+	jp2.get("int", uint8).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10, uint8);
+
+	uint64 = 10;
+	jp2.get("negative", uint64).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10U, uint64);
+
+	int32 = 10;
+	jp2.get("double", int32).checkValueRead(valueRead);
+	EXPECT_FALSE(valueRead);
+	EXPECT_EQ(10, int32);
+}
+
 TEST(TestJsonParser, JsonParserMinMaxTest)
 {
 	std::string payload = R"json({
@@ -556,6 +716,27 @@ TEST(TestJsonParser, JsonParserValueMapTest)
 	jp.clearError();
 	EXPECT_FALSE((bool)jp.getAndMap("stringValue2", i, STRING_MAP));
 
+	static const LSHelpers::StringMap<int, 2> PERFECT_MAP {{{"zero", 0}, {"many", 1234}}};
+
+	i = 10;
+	jp.clearError();
+	EXPECT_TRUE((bool)jp.getAndMap("stringValue", i, PERFECT_MAP));
+	EXPECT_EQ(1234, i);
+
+	i = 10;
+	jp.clearError();
+	EXPECT_FALSE((bool)jp.getAndMap("stringValue2", i, PERFECT_MAP));
+	EXPECT_EQ(10, i);
+
+	jp.clearError();
+	EXPECT_FALSE((bool)jp.getAndMap("intValue", i, PERFECT_MAP));
+
+	jp.clearError();
+	EXPECT_TRUE((bool)jp.getAndMap("missing", i, PERFECT_MAP).optional());
+
+	jp.clearError();
+	EXPECT_TRUE((bool)jp.get("stringValue1", s).allowedValues(PERFECT_MAP));
+	EXPECT_FALSE((bool)jp.get("stringValue2", s).allowedValues(PERFECT_MAP));
 }
 
 TEST(TestJsonParser, JsonParserGetFromString)
@@ -612,6 +793,435 @@ TEST(TestJsonParser, JsonParserGetFromString)
 	EXPECT_FALSE(jp.hasError());
 }
 
+TEST(TestJsonParser, JsonParserNumericArrayTest)
+{
+	std::string payload = R"json({
+"ints":[1, -2, "3", 127],
+"doubles":[0.5, 1e3, "-2.25"],
+"outOfRange":[1, 2, 128],
+"fraction":[1, 2.5],
+"mixed":[1, "x"],
+"empty":[],
+"nullArray":null,
+"notArray":5
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_FALSE(jp.hasError());
+
+	std::vector<int8_t> ints;
+	jp.getNumericArray("ints", ints);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ((std::vector<int8_t>{1, -2, 3, 127}), ints);
+
+	std::vector<double> doubles;
+	jp.getNumericArray("doubles", doubles);
+	EXPECT_FALSE(jp.hasError());
+	ASSERT_EQ(size_t{3}, doubles.size());
+	EXPECT_DOUBLE_EQ(0.5, doubles[0]);
+	EXPECT_DOUBLE_EQ(1000.0, doubles[1]);
+	EXPECT_DOUBLE_EQ(-2.25, doubles[2]);
+
+	std::array<float, 3> floats;
+	jp.getNumericArray("doubles", floats);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_FLOAT_EQ(-2.25f, floats[2]);
+
+	std::array<int32_t, 2> wrongSize;
+	jp.getNumericArray("ints", wrongSize);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	int32_t buffer[4];
+	size_t count = 0;
+	jp.getNumericArray("ints", buffer, 4, count).min(1);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(size_t{4}, count);
+	EXPECT_EQ(127, buffer[3]);
+
+	jp.getNumericArray("ints", buffer, 3, count);
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_EQ(size_t{0}, count);
+	jp.clearError();
+
+	jp.getNumericArray("empty", buffer, 4, count).min(1);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	jp.getNumericArray("outOfRange", ints);
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_NE(std::string::npos, jp.getError().find("element 2"));
+	EXPECT_TRUE(ints.empty());
+	jp.clearError();
+
+	std::vector<int64_t> longs;
+	jp.getNumericArray("outOfRange", longs);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ((std::vector<int64_t>{1, 2, 128}), longs);
+
+	jp.getNumericArray("fraction", longs);
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_NE(std::string::npos, jp.getError().find("element 1"));
+	jp.clearError();
+
+	jp.getNumericArray("mixed", doubles);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	jp.getNumericArray("notArray", doubles);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	jp.getNumericArray("nullArray", doubles).allowNull();
+	jp.getNumericArray("missing", doubles).optional();
+	EXPECT_FALSE(jp.hasError());
+
+	// Numbers created from C++ values have no text.
+	JValue created = pbnjson::JObject{{"values", pbnjson::JArray{1, 2, 300}}};
+	LSHelpers::JsonParser createdParser(created);
+	std::vector<uint16_t> shorts;
+	createdParser.getNumericArray("values", shorts);
+	EXPECT_FALSE(createdParser.hasError());
+	EXPECT_EQ((std::vector<uint16_t>{1, 2, 300}), shorts);
+}
+
+TEST(TestJsonParser, JsonParserColumnsTest)
+{
+	std::string payload = R"json({
+"apps":[
+	{"id":"com.a", "size":100, "visible":false, "extra":1},
+	{"id":"com.b", "size":"200"},
+	{"id":"com.c", "size":300, "visible":null}
+],
+"badRow":[{"id":"com.a", "size":1}, {"id":"com.b"}],
+"badType":[{"id":"com.a", "size":1}, 5],
+"empty":[]
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_FALSE(jp.hasError());
+
+	std::vector<std::string> ids;
+	std::vector<int64_t> sizes;
+	std::vector<bool> visible;
+	size_t count = 0;
+
+	jp.getColumns("apps", count,
+	              LSHelpers::column("id", ids),
+	              LSHelpers::column("size", sizes),
+	              LSHelpers::optionalColumn("visible", visible, true));
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(size_t{3}, count);
+	EXPECT_EQ((std::vector<std::string>{"com.a", "com.b", "com.c"}), ids);
+	EXPECT_EQ((std::vector<int64_t>{100, 200, 300}), sizes);
+	EXPECT_EQ((std::vector<bool>{false, true, true}), visible);
+
+	jp.getColumns("badRow", count,
+	              LSHelpers::column("id", ids),
+	              LSHelpers::column("size", sizes));
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_NE(std::string::npos, jp.getError().find("element 1"));
+	EXPECT_EQ(size_t{0}, count);
+	EXPECT_TRUE(ids.empty());
+	EXPECT_TRUE(sizes.empty());
+	jp.clearError();
+
+	jp.getColumns("badType", count, LSHelpers::column("id", ids));
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	jp.getColumns("empty", count, LSHelpers::column("id", ids)).min(1);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	jp.getColumns("missing", count, LSHelpers::column("id", ids)).optional();
+	EXPECT_FALSE(jp.hasError());
+}
+
+TEST(TestJsonParser, JsonParserForEachElementTest)
+{
+	std::string payload = R"json({
+"numbers":[1, 2, 3, 4, 5],
+"bad":[1, "x", 3],
+"objects":[{"x":1, "y":2, "width":3, "height":4}, {"x":5, "y":6, "width":7, "height":8}]
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_FALSE(jp.hasError());
+
+	int32_t number = 0;
+	int32_t sum = 0;
+	jp.forEachElement("numbers", number, [&](int32_t value)
+	{
+		sum += value;
+		return true;
+	});
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(15, sum);
+	EXPECT_EQ(5, number);
+
+	size_t visited = 0;
+	jp.forEachElement("numbers", number, [&](int32_t value)
+	{
+		visited++;
+		return value != 3;
+	});
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(size_t{3}, visited);
+	EXPECT_EQ(3, number);
+
+	visited = 0;
+	jp.forEachElement("bad", number, [&](int32_t)
+	{
+		visited++;
+		return true;
+	});
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_EQ(size_t{1}, visited);
+	jp.clearError();
+
+	JValue object;
+	int32_t area = 0;
+	jp.forEachElement("objects", object, [&](const JValue& o)
+	{
+		int32_t width = 0;
+		int32_t height = 0;
+		LSHelpers::JsonParser objectParser(o);
+		objectParser.get("width", width);
+		objectParser.get("height", height);
+		area += width * height;
+		return objectParser.finishParse(false);
+	});
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(3 * 4 + 7 * 8, area);
+
+	jp.forEachElement("missing", number, [&](int32_t) { return true; }).optional();
+	EXPECT_FALSE(jp.hasError());
+
+	jp.forEachElement("missing", number, [&](int32_t) { return true; });
+	EXPECT_TRUE(jp.hasError());
+}
+
+TEST(TestJsonParser, JsonParserMapTest)
+{
+	std::string payload = R"json({
+"volumes":{"com.a":10, "com.b":"20", "com.c":30},
+"fewer":{"com.b":5},
+"bad":{"com.a":1, "com.b":"x"},
+"notObject":[1, 2],
+"nullMap":null
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_FALSE(jp.hasError());
+
+	std::unordered_map<std::string, int32_t> volumes;
+	jp.getMap("volumes", volumes);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(size_t{3}, volumes.size());
+	EXPECT_EQ(10, volumes["com.a"]);
+	EXPECT_EQ(20, volumes["com.b"]);
+	EXPECT_EQ(30, volumes["com.c"]);
+
+	// Parsing again reuses com.b and removes the other keys.
+	const int32_t* entry = &volumes["com.b"];
+	jp.getMap("fewer", volumes);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(size_t{1}, volumes.size());
+	EXPECT_EQ(5, volumes["com.b"]);
+	EXPECT_EQ(entry, &volumes["com.b"]);
+
+	std::map<std::string, double> ordered;
+	jp.getMap("volumes", ordered);
+	EXPECT_FALSE(jp.hasError());
+	ASSERT_EQ(size_t{3}, ordered.size());
+	EXPECT_EQ(std::string("com.a"), ordered.begin()->first);
+	EXPECT_DOUBLE_EQ(30.0, ordered["com.c"]);
+
+	std::map<std::string, int32_t> doubled;
+	jp.getMap("volumes", doubled, [](const JValue& value, int32_t& destination)
+	{
+		LSHelpers::JsonParser::parseValue(value, destination);
+		destination *= 2;
+	});
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(60, doubled["com.c"]);
+
+	jp.getMap("bad", volumes);
+	EXPECT_TRUE(jp.hasError());
+	EXPECT_NE(std::string::npos, jp.getError().find("bad.com.b"));
+	jp.clearError();
+
+	jp.getMap("notObject", volumes);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	jp.getMap("nullMap", volumes).optional().allowNull();
+	jp.getMap("missing", ordered).optional();
+	EXPECT_FALSE(jp.hasError());
+}
+
+TEST(TestJsonParser, JsonParserStringRefTest)
+{
+	std::string payload = R"json({
+"appId":"com.webos.app.test",
+"other":"com.webos.app.other",
+"number":5,
+"ids":["b", "a", "b"]
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+	EXPECT_FALSE(jp.hasError());
+
+	LSHelpers::StringRef appId;
+	jp.get("appId", appId).allowedValues({"com.webos.app.test", "com.webos.app.other"});
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(std::string("com.webos.app.test"), appId.str());
+	EXPECT_TRUE(appId == "com.webos.app.test");
+	EXPECT_TRUE(appId < LSHelpers::StringRef("com.webos.app.zzz"));
+
+	jp.get("number", appId);
+	EXPECT_TRUE(jp.hasError());
+	jp.clearError();
+
+	std::vector<LSHelpers::StringRef> ids;
+	jp.getArray("ids", ids);
+	EXPECT_FALSE(jp.hasError());
+	ASSERT_EQ(size_t{3}, ids.size());
+	EXPECT_TRUE(ids[0] == "b");
+	EXPECT_TRUE(ids[1] == "a");
+}
+
+TEST(TestJsonParser, JsonParserInternedStringTest)
+{
+	LSHelpers::InternedString empty;
+	EXPECT_TRUE(empty.empty());
+	EXPECT_TRUE(empty == "");
+
+	LSHelpers::InternedString first;
+	{
+		LSHelpers::JsonParser jp(std::string(R"json({"appId":"com.webos.app.interned"})json"));
+		jp.get("appId", first);
+		EXPECT_FALSE(jp.hasError());
+	}
+	size_t poolSize = LSHelpers::InternedString::poolSize();
+
+	// Same value from another payload gets the same pool entry.
+	LSHelpers::InternedString second;
+	LSHelpers::JsonParser jp(std::string(R"json({"appId":"com.webos.app.interned", "number":5})json"));
+	jp.get("appId", second);
+	EXPECT_FALSE(jp.hasError());
+	EXPECT_EQ(poolSize, LSHelpers::InternedString::poolSize());
+
+	EXPECT_TRUE(first == second);
+	EXPECT_EQ(&first.str(), &second.str());
+	EXPECT_EQ(std::string("com.webos.app.interned"), first.str());
+	EXPECT_TRUE(first == "com.webos.app.interned");
+	EXPECT_FALSE(first == LSHelpers::InternedString::intern("com.webos.app.other"));
+
+	jp.get("number", second);
+	EXPECT_TRUE(jp.hasError());
+
+	// Values from payloads can not grow the pool over the limit.
+	LSHelpers::InternedString value;
+	for (size_t i = LSHelpers::InternedString::poolSize(); i < LSHelpers::InternedString::MAX_POOL_SIZE; i++)
+	{
+		ASSERT_TRUE(LSHelpers::InternedString::tryIntern("pool.filler." + std::to_string(i), value));
+	}
+	EXPECT_FALSE(LSHelpers::InternedString::tryIntern("com.webos.app.new", value));
+	EXPECT_TRUE(LSHelpers::InternedString::tryIntern("com.webos.app.interned", value));
+	EXPECT_TRUE(value == first);
+
+	LSHelpers::JsonParser full(std::string(R"json({"known":"com.webos.app.interned", "new":"com.webos.app.new"})json"));
+	full.get("known", value);
+	EXPECT_FALSE(full.hasError());
+	full.get("new", value);
+	EXPECT_TRUE(full.hasError());
+	EXPECT_EQ(size_t{1}, full.getDiagnostics().size());
+	EXPECT_EQ(LSHelpers::InternedString::MAX_POOL_SIZE, LSHelpers::InternedString::poolSize());
+
+	// Strings from the program are not limited.
+	EXPECT_TRUE(LSHelpers::InternedString::intern("com.webos.app.new") == "com.webos.app.new");
+}
+
+TEST(TestJsonParser, JsonParserDiagnosticsTest)
+{
+	std::string payload = R"json({
+"small":1,
+"large":1000,
+"text":"abc",
+"a/b":"x",
+"values":[1, 2, 300],
+"extra":true
+})json";
+
+	LSHelpers::JsonParser jp(payload);
+
+	int32_t small;
+	int32_t large;
+	int32_t missing;
+	int32_t text;
+	std::string slash;
+	std::vector<uint8_t> values;
+
+	jp.get("small", small).min(5);
+	jp.get("large", large).max(100);
+	jp.get("missing", missing);
+	jp.get("text", text);
+	jp.get("a/b", slash).allowedValues({"y"});
+	jp.getNumericArray("values", values);
+	EXPECT_FALSE(jp.finishParse(true));
+
+	const std::vector<LSHelpers::ParseDiagnostic>& diagnostics = jp.getDiagnostics();
+	ASSERT_EQ(size_t{7}, diagnostics.size());
+
+	EXPECT_EQ(LSHelpers::ParseErrorCode::OutOfRange, diagnostics[0].code);
+	EXPECT_EQ(std::string("small"), diagnostics[0].field);
+	EXPECT_EQ(std::string("/small"), diagnostics[0].getLocation());
+	EXPECT_EQ(std::string("Failed to validate against schema: Field 'small' value less than minimum"), jp.getError());
+	EXPECT_EQ(diagnostics[0].toString(), jp.getError());
+
+	EXPECT_EQ(LSHelpers::ParseErrorCode::OutOfRange, diagnostics[1].code);
+	EXPECT_EQ(LSHelpers::ParseErrorCode::Missing, diagnostics[2].code);
+	EXPECT_EQ(LSHelpers::ParseErrorCode::InvalidValue, diagnostics[3].code);
+	EXPECT_STREQ("Integer value not a number", diagnostics[3].getMessage());
+
+	EXPECT_EQ(LSHelpers::ParseErrorCode::NotAllowed, diagnostics[4].code);
+	EXPECT_EQ(std::string("/a~1b"), diagnostics[4].getLocation());
+
+	EXPECT_EQ(LSHelpers::ParseErrorCode::OutOfRange, diagnostics[5].code);
+	EXPECT_EQ(std::string("/values/2"), diagnostics[5].getLocation());
+	EXPECT_NE(std::string::npos, diagnostics[5].toString().find("element 2"));
+
+	EXPECT_EQ(LSHelpers::ParseErrorCode::UnexpectedFields, diagnostics[6].code);
+	EXPECT_EQ(std::string(""), diagnostics[6].getLocation());
+
+	jp.clearError();
+	EXPECT_TRUE(jp.getDiagnostics().empty());
+	EXPECT_EQ(std::string(""), jp.getError());
+
+	// Failed decode is reported once, even if the context is checked before it is destroyed.
+	EXPECT_FALSE(jp.get("text", text));
+	ASSERT_EQ(size_t{1}, jp.getDiagnostics().size());
+	EXPECT_EQ(LSHelpers::ParseErrorCode::InvalidValue, jp.getDiagnostics()[0].code);
+	EXPECT_FALSE(jp.get("missing", missing));
+	ASSERT_EQ(size_t{2}, jp.getDiagnostics().size());
+	EXPECT_EQ(LSHelpers::ParseErrorCode::Missing, jp.getDiagnostics()[1].code);
+	jp.clearError();
+
+	// Number of stored errors is limited.
+	for (size_t i = 0; i < LSHelpers::JsonParser::MAX_DIAGNOSTICS + 5; i++)
+	{
+		jp.get("missing", missing);
+	}
+	EXPECT_EQ(LSHelpers::JsonParser::MAX_DIAGNOSTICS, jp.getDiagnostics().size());
+
+	LSHelpers::JsonParser invalid(std::string("{not json"));
+	ASSERT_EQ(size_t{1}, invalid.getDiagnostics().size());
+	EXPECT_EQ(LSHelpers::ParseErrorCode::MalformedJson, invalid.getDiagnostics()[0].code);
+	EXPECT_EQ(std::string("Malformed JSON."), invalid.getError());
+}
+
 
 int main(int argc, char **argv)
 {
@@ -0,0 +1,105 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include "util.hpp"
+
+using LSHelpers::scanReturnValue;
+
+TEST(TestScanReturnValue, ReturnValue)
+{
+	EXPECT_EQ(1, scanReturnValue("{\"returnValue\":true}"));
+	EXPECT_EQ(0, scanReturnValue("{\"returnValue\":false}"));
+	EXPECT_EQ(1, scanReturnValue("{\"a\":1,\"returnValue\":true,\"b\":[1,2]}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"a\":1}"));
+	EXPECT_EQ(-1, scanReturnValue("{}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":\"true\"}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":1}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":null}"));
+	EXPECT_EQ(-1, scanReturnValue("[true]"));
+}
+
+TEST(TestScanReturnValue, Whitespace)
+{
+	EXPECT_EQ(1, scanReturnValue(" \t\r\n{ \"returnValue\" :\ttrue\n}\n"));
+	EXPECT_EQ(0, scanReturnValue("{\"a\" : [ 1 , { } , [ ] ] ,\r\n\"returnValue\" : false }"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true} x"));
+}
+
+TEST(TestScanReturnValue, EscapedStrings)
+{
+	EXPECT_EQ(1, scanReturnValue("{\"a\\\"returnValue\\\"\":false,\"returnValue\":true}"));
+	EXPECT_EQ(1, scanReturnValue("{\"x\":\"\\\"returnValue\\\":false\",\"returnValue\":true}"));
+	EXPECT_EQ(1, scanReturnValue("{\"x\":\"\\\\\",\"returnValue\":true}"));
+	EXPECT_EQ(1, scanReturnValue("{\"x\":\"\\u00e4 \xc3\xa4\",\"returnValue\":true}"));
+
+	// Escaped key may spell returnValue.
+	EXPECT_EQ(-1, scanReturnValue("{\"return\\u0056alue\":false}"));
+
+	EXPECT_EQ(-1, scanReturnValue("{\"x\":\"\\q\",\"returnValue\":true}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"x\":\"\\u00g0\",\"returnValue\":true}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"x\":\"a\nb\",\"returnValue\":true}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"x\":\"\xff\",\"returnValue\":true}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"x\":\"\xc3\",\"returnValue\":true}"));
+}
+
+TEST(TestScanReturnValue, NestedAndDuplicate)
+{
+	EXPECT_EQ(-1, scanReturnValue("{\"a\":{\"returnValue\":true}}"));
+	EXPECT_EQ(1, scanReturnValue("{\"a\":{\"returnValue\":false},\"returnValue\":true}"));
+	EXPECT_EQ(0, scanReturnValue("{\"a\":[{\"returnValue\":true}],\"returnValue\":false}"));
+
+	// Last value wins, like in the parsed object.
+	EXPECT_EQ(0, scanReturnValue("{\"returnValue\":true,\"returnValue\":false}"));
+	EXPECT_EQ(1, scanReturnValue("{\"returnValue\":false,\"returnValue\":true}"));
+}
+
+TEST(TestScanReturnValue, Malformed)
+{
+	EXPECT_EQ(-1, scanReturnValue(""));
+	EXPECT_EQ(-1, scanReturnValue("{"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\""));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":\"abc"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\" true}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":tru}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":tru}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":nul}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":[1,}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":[1,]}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":[1}}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":{\"a\"}}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":{1:2}}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":[1 2]}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":01}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":1.}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":1e}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":-}"));
+	EXPECT_EQ(-1, scanReturnValue("{\"returnValue\":true,\"x\":+1}"));
+	EXPECT_EQ(1, scanReturnValue("{\"returnValue\":true,\"x\":[-0.5e+10,0,1E2,true,false,null]}"));
+}
+
+TEST(TestScanReturnValue, DeepNesting)
+{
+	std::string shallow = "{\"returnValue\":true,\"x\":" + std::string(31, '[') + std::string(31, ']') + "}";
+	EXPECT_EQ(1, scanReturnValue(shallow.c_str()));
+
+	// Too deep to scan, left to the full parser.
+	std::string deep = "{\"returnValue\":true,\"x\":" + std::string(32, '[') + std::string(32, ']') + "}";
+	EXPECT_EQ(-1, scanReturnValue(deep.c_str()));
+}
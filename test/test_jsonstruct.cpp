@@ -0,0 +1,198 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using namespace pbnjson;
+using namespace LSHelpers;
+
+enum class Color
+{
+	Red,
+	Green
+};
+
+static const StringMap<Color, 2> colors {{
+	{"red", Color::Red},
+	{"green", Color::Green}
+}};
+
+struct Point : public JsonStruct<Point, true>
+{
+	int32_t x;
+	int32_t y;
+
+	template<typename V>
+	void jsonFields(V& field)
+	{
+		field("x", x);
+		field("y", y);
+	}
+};
+
+struct Shape : public JsonStruct<Shape>
+{
+	std::string name;
+	Color color;
+	double scale;
+	bool visible;
+	Point origin;
+	std::vector<Point> points;
+	std::map<std::string, int32_t> tags;
+
+	template<typename V>
+	void jsonFields(V& field)
+	{
+		field("name", name);
+		field.mapped("color", color, colors);
+		field("scale", scale).min(0.0);
+		field("visible", visible).optional().defaultValue(true);
+		field("origin", origin);
+		field("points", points);
+		field("tags", tags).optional();
+	}
+};
+
+// Tracks whether the optional field was present in the parsed payload.
+struct Label : public JsonStruct<Label>
+{
+	std::string text;
+	bool hasText = false;
+
+	template<typename V>
+	void jsonFields(V& field)
+	{
+		field("text", text).optional().checkValueRead(hasText);
+	}
+};
+
+TEST(TestJsonStruct, Parse)
+{
+	JsonParser parser(std::string(R"json({"shape":{
+		"name":"triangle",
+		"color":"green",
+		"scale":1.5,
+		"origin":{"x":1,"y":2},
+		"points":[{"x":0,"y":0},{"x":10,"y":0},{"x":0,"y":10}],
+		"tags":{"layer":3}
+	}})json"));
+
+	Shape shape;
+	parser.get("shape", shape);
+	ASSERT_TRUE(parser.finishParse());
+
+	EXPECT_EQ("triangle", shape.name);
+	EXPECT_EQ(Color::Green, shape.color);
+	EXPECT_EQ(1.5, shape.scale);
+	EXPECT_TRUE(shape.visible);
+	EXPECT_EQ(2, shape.origin.y);
+	ASSERT_EQ(3U, shape.points.size());
+	EXPECT_EQ(10, shape.points[2].y);
+	EXPECT_EQ(3, shape.tags["layer"]);
+}
+
+TEST(TestJsonStruct, Write)
+{
+	Shape shape;
+	shape.name = "line";
+	shape.color = Color::Red;
+	shape.scale = 0.5;
+	shape.visible = false;
+	shape.origin.x = 1;
+	shape.origin.y = 2;
+	shape.points.resize(2);
+	shape.points[0].x = 0;
+	shape.points[0].y = 0;
+	shape.points[1].x = 3;
+	shape.points[1].y = 4;
+	shape.tags["layer"] = 1;
+
+	EXPECT_EQ(R"json({"name":"line","color":"red","scale":0.5,"visible":false,"origin":{"x":1,"y":2},)json"
+	          R"json("points":[{"x":0,"y":0},{"x":3,"y":4}],"tags":{"layer":1}})json",
+	          shape.toJsonString());
+}
+
+TEST(TestJsonStruct, RoundTrip)
+{
+	Shape shape;
+	shape.name = "quote\"d";
+	shape.color = Color::Green;
+	shape.scale = 1.0 / 3;
+	shape.visible = true;
+	shape.origin.x = -1;
+	shape.origin.y = 7;
+
+	JsonWriter writer;
+	writer.beginObject().field("shape", shape).endObject();
+
+	JsonParser parser(writer.str());
+	Shape parsed;
+	parser.get("shape", parsed);
+	ASSERT_TRUE(parser.finishParse());
+
+	EXPECT_EQ(shape.name, parsed.name);
+	EXPECT_EQ(shape.color, parsed.color);
+	EXPECT_EQ(shape.scale, parsed.scale);
+	EXPECT_EQ(shape.origin.x, parsed.origin.x);
+	EXPECT_TRUE(parsed.points.empty());
+}
+
+TEST(TestJsonStruct, ParseErrors)
+{
+	{
+		JsonParser parser(std::string(R"json({"point":{"x":1,"y":2,"z":3}})json"));
+		Point point;
+		parser.get("point", point);
+		EXPECT_FALSE(parser.finishParse());
+	}
+
+	{
+		JsonParser parser(std::string(R"json({"shape":{"name":"a","color":"blue","scale":1,"origin":{"x":1,"y":2},"points":[]}})json"));
+		Shape shape;
+		parser.get("shape", shape);
+		EXPECT_FALSE(parser.finishParse());
+	}
+}
+
+TEST(TestJsonStruct, UnmappedValueWrittenAsNull)
+{
+	Shape shape;
+	shape.name = "a";
+	shape.color = static_cast<Color>(5);
+	shape.scale = 1;
+	shape.visible = true;
+	shape.origin.x = 0;
+	shape.origin.y = 0;
+
+	JValue value = JDomParser::fromString(shape.toJsonString());
+	ASSERT_TRUE(value.isObject());
+	EXPECT_TRUE(value["color"].isNull());
+}
+
+TEST(TestJsonStruct, WriteHasNoSideEffects)
+{
+	Label label;
+	label.text = "a";
+	EXPECT_EQ(R"json({"text":"a"})json", label.toJsonString());
+	EXPECT_FALSE(label.hasText);
+
+	JsonParser parser(std::string(R"json({"label":{"text":"b"}})json"));
+	parser.get("label", label);
+	ASSERT_TRUE(parser.finishParse());
+	EXPECT_TRUE(label.hasText);
+}
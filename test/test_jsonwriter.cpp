@@ -0,0 +1,102 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cmath>
+#include <limits>
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using namespace pbnjson;
+using LSHelpers::JsonWriter;
+
+TEST(TestJsonWriter, Structure)
+{
+	JsonWriter writer;
+	writer.beginObject()
+		.field("returnValue", true)
+		.key("list").beginArray().value(1).value(2).beginObject().endObject().beginArray().endArray().null().endArray()
+		.key("nested").beginObject().field("a", false).endObject()
+		.key("raw").raw(R"json({"x":1})json")
+		.endObject();
+
+	EXPECT_EQ(R"json({"returnValue":true,"list":[1,2,{},[],null],"nested":{"a":false},"raw":{"x":1}})json", writer.str());
+
+	JValue parsed = JDomParser::fromString(writer.c_str());
+	ASSERT_TRUE(parsed.isObject());
+	EXPECT_EQ(2, parsed["list"][1].asNumber<int32_t>());
+}
+
+TEST(TestJsonWriter, StringEscaping)
+{
+	JsonWriter writer;
+	writer.beginArray()
+		.value("quote\" backslash\\ newline\n tab\t control\x01 utf8 \xc3\xa9")
+		.value(std::string("std"))
+		.value(LSHelpers::StringRef("ref", 2))
+		.value(static_cast<const char*>(nullptr))
+		.endArray();
+
+	EXPECT_EQ("[\"quote\\\" backslash\\\\ newline\\n tab\\t control\\u0001 utf8 \xc3\xa9\",\"std\",\"re\",null]",
+	          writer.str());
+
+	JValue parsed = JDomParser::fromString(writer.c_str());
+	ASSERT_TRUE(parsed.isArray());
+	EXPECT_EQ("quote\" backslash\\ newline\n tab\t control\x01 utf8 \xc3\xa9", parsed[0].asString());
+}
+
+TEST(TestJsonWriter, Numbers)
+{
+	JsonWriter writer;
+	writer.beginArray()
+		.value(int8_t(-5))
+		.value(std::numeric_limits<int64_t>::min())
+		.value(std::numeric_limits<uint64_t>::max())
+		.value(0.1)
+		.value(1.0 / 3)
+		.value(2.5f)
+		.value(NAN)
+		.value(INFINITY)
+		.endArray();
+
+	EXPECT_EQ("[-5,-9223372036854775808,18446744073709551615,0.1,0.3333333333333333,2.5,null,null]", writer.str());
+
+	JValue parsed = JDomParser::fromString(writer.c_str());
+	ASSERT_TRUE(parsed.isArray());
+	EXPECT_EQ(1.0 / 3, parsed[4].asNumber<double>());
+}
+
+TEST(TestJsonWriter, ClearReusesBuffer)
+{
+	JsonWriter writer;
+	writer.beginObject().field("value", std::string(1000, 'x')).endObject();
+	size_t capacity = writer.str().capacity();
+
+	writer.clear();
+	EXPECT_TRUE(writer.empty());
+	writer.beginObject().field("returnValue", true).endObject();
+
+	EXPECT_EQ(R"json({"returnValue":true})json", writer.str());
+	EXPECT_EQ(capacity, writer.str().capacity());
+}
+
+TEST(TestJsonWriter, JValue)
+{
+	JsonWriter writer;
+	writer.beginObject().field("value", JObject{{"a", 1}}).endObject();
+
+	EXPECT_EQ(JObject({{"value", JObject{{"a", 1}}}}), JDomParser::fromString(writer.c_str()));
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include "util.hpp"
+
+using namespace std;
+using LSHelpers::LogRateLimiter;
+
+TEST(TestLogRateLimiter, BurstThenSuppress)
+{
+	LogRateLimiter limiter(3, 100);
+	uint32_t suppressed = 99;
+
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_TRUE(limiter.allow(suppressed, 1000));
+		EXPECT_EQ(0U, suppressed);
+	}
+
+	EXPECT_FALSE(limiter.allow(suppressed, 1000));
+	EXPECT_FALSE(limiter.allow(suppressed, 1050));
+
+	// One token refilled, the summary reports the suppressed messages.
+	EXPECT_TRUE(limiter.allow(suppressed, 1100));
+	EXPECT_EQ(2U, suppressed);
+	EXPECT_FALSE(limiter.allow(suppressed, 1100));
+
+	EXPECT_TRUE(limiter.allow(suppressed, 1200));
+	EXPECT_EQ(1U, suppressed);
+}
+
+TEST(TestLogRateLimiter, RefillCappedAtBurst)
+{
+	LogRateLimiter limiter(2, 100);
+	uint32_t suppressed = 0;
+
+	EXPECT_TRUE(limiter.allow(suppressed, 1000));
+	EXPECT_TRUE(limiter.allow(suppressed, 1000));
+	EXPECT_FALSE(limiter.allow(suppressed, 1000));
+
+	// Long idle period refills only up to the burst size.
+	EXPECT_TRUE(limiter.allow(suppressed, 100000));
+	EXPECT_EQ(1U, suppressed);
+	EXPECT_TRUE(limiter.allow(suppressed, 100000));
+	EXPECT_FALSE(limiter.allow(suppressed, 100000));
+}
+
+TEST(TestLogRateLimiter, SharedPerMessageId)
+{
+	std::string id = "TEST_MSGID";
+	LogRateLimiter& first = LogRateLimiter::forMessage("TEST_MSGID");
+	LogRateLimiter& second = LogRateLimiter::forMessage(id.c_str());
+	LogRateLimiter& other = LogRateLimiter::forMessage("TEST_OTHER_MSGID");
+
+	EXPECT_EQ(&first, &second);
+	EXPECT_NE(&first, &other);
+}
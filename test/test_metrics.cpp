@@ -0,0 +1,124 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using LSHelpers::Histogram;
+using LSHelpers::MethodMetrics;
+
+TEST(TestMetrics, BucketIndex)
+{
+	// Small values are exact.
+	for (uint64_t value = 0; value < Histogram::SUB_BUCKETS; value++)
+	{
+		EXPECT_EQ(value, Histogram::bucketIndex(value));
+		EXPECT_EQ(value, Histogram::bucketLimit(Histogram::bucketIndex(value)));
+	}
+
+	// Buckets are contiguous and bound the relative error.
+	uint32_t previous = Histogram::bucketIndex(Histogram::SUB_BUCKETS - 1);
+	for (uint64_t value = Histogram::SUB_BUCKETS; value < 100000; value++)
+	{
+		uint32_t index = Histogram::bucketIndex(value);
+		ASSERT_TRUE(index == previous || index == previous + 1) << value;
+		ASSERT_GE(Histogram::bucketLimit(index), value);
+		ASSERT_LE(Histogram::bucketLimit(index), value + value / Histogram::SUB_BUCKETS);
+		previous = index;
+	}
+
+	// Large values are clamped.
+	EXPECT_EQ(Histogram::BUCKETS - 1, Histogram::bucketIndex(UINT64_MAX));
+	EXPECT_EQ(Histogram::BUCKETS - 1, Histogram::bucketIndex(uint64_t(1) << Histogram::MAX_VALUE_BITS));
+}
+
+TEST(TestMetrics, Percentiles)
+{
+	Histogram histogram;
+	EXPECT_EQ(0u, histogram.getPercentile(50));
+	EXPECT_EQ(0, histogram.getMean());
+
+	for (uint64_t value = 1; value <= 1000; value++)
+	{
+		histogram.record(value);
+	}
+
+	EXPECT_EQ(1000u, histogram.getCount());
+	EXPECT_EQ(1000u, histogram.getMax());
+	EXPECT_DOUBLE_EQ(500.5, histogram.getMean());
+
+	EXPECT_NEAR(500, histogram.getPercentile(50), 500 / 8);
+	EXPECT_NEAR(900, histogram.getPercentile(90), 900 / 8);
+	EXPECT_NEAR(990, histogram.getPercentile(99), 990 / 8);
+	EXPECT_EQ(1000u, histogram.getPercentile(100));
+}
+
+TEST(TestMetrics, Json)
+{
+	Histogram histogram;
+	histogram.record(10);
+	histogram.record(20);
+
+	pbnjson::JValue json = histogram.toJson();
+	EXPECT_EQ(2, json["count"].asNumber<int64_t>());
+	EXPECT_EQ(15, json["mean"].asNumber<double>());
+	EXPECT_EQ(20, json["max"].asNumber<int64_t>());
+}
+
+TEST(TestMetrics, Threads)
+{
+	Histogram histogram;
+	vector<thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&histogram, t]()
+		{
+			for (uint64_t i = 0; i < 10000; i++)
+			{
+				histogram.record(i * (t + 1));
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	EXPECT_EQ(40000u, histogram.getCount());
+	EXPECT_EQ(39996u, histogram.getMax());
+}
+
+TEST(TestMetrics, Errors)
+{
+	MethodMetrics metrics;
+	metrics.calls += 3;
+	metrics.recordError(3);
+	metrics.recordError(3);
+	metrics.recordError(-1);
+
+	auto errors = metrics.getErrors();
+	EXPECT_EQ(2u, errors.size());
+	EXPECT_EQ(2u, errors[3]);
+	EXPECT_EQ(1u, errors[-1]);
+
+	pbnjson::JValue json = metrics.toJson();
+	EXPECT_EQ(3, json["calls"].asNumber<int64_t>());
+	EXPECT_EQ(2, json["errors"]["3"].asNumber<int64_t>());
+	EXPECT_TRUE(json["respondUs"].isObject());
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using namespace pbnjson;
+
+TEST(TestPayloadCache, HitAndMiss)
+{
+	LSHelpers::PayloadCache cache;
+
+	JValue first = cache.parse(R"json({"subscribe":true})json", JSchema::AllSchema());
+	EXPECT_TRUE(first.isValid());
+	EXPECT_TRUE(first["subscribe"].asBool());
+	EXPECT_EQ(0U, cache.getHits());
+	EXPECT_EQ(1U, cache.getMisses());
+
+	JValue second = cache.parse(R"json({"subscribe":true})json", JSchema::AllSchema());
+	EXPECT_TRUE(second.isValid());
+	EXPECT_EQ(first, second);
+	EXPECT_EQ(1U, cache.getHits());
+	EXPECT_EQ(1U, cache.getMisses());
+
+	JValue other = cache.parse(R"json({"subscribe":false})json", JSchema::AllSchema());
+	EXPECT_TRUE(other.isValid());
+	EXPECT_FALSE(other["subscribe"].asBool());
+	EXPECT_EQ(1U, cache.getHits());
+	EXPECT_EQ(2U, cache.getMisses());
+
+	cache.clear();
+	cache.parse(R"json({"subscribe":true})json", JSchema::AllSchema());
+	EXPECT_EQ(1U, cache.getHits());
+	EXPECT_EQ(3U, cache.getMisses());
+}
+
+TEST(TestPayloadCache, Schema)
+{
+	LSHelpers::PayloadCache cache;
+	JSchema schema = JSchema::fromString(R"json({"type":"object","properties":{"a":{"type":"integer"}}})json");
+
+	std::string payload = R"json({"a":"string"})json";
+	EXPECT_TRUE(cache.parse(payload.c_str(), JSchema::AllSchema()).isValid());
+	// Same payload with different schema is not served from the cache.
+	EXPECT_FALSE(cache.parse(payload.c_str(), schema).isValid());
+	EXPECT_FALSE(cache.parse(payload.c_str(), schema).isValid());
+	EXPECT_EQ(0U, cache.getHits());
+}
+
+TEST(TestPayloadCache, Limits)
+{
+	LSHelpers::PayloadCache cache(1, 16);
+
+	EXPECT_TRUE(cache.isCacheable("{}"));
+	EXPECT_FALSE(cache.isCacheable(R"json({"longPayload":"1234567890"})json"));
+	EXPECT_FALSE(cache.isCacheable(nullptr));
+
+	// Not cached, not counted.
+	EXPECT_TRUE(cache.parse(R"json({"longPayload":"1234567890"})json", JSchema::AllSchema()).isValid());
+	EXPECT_TRUE(cache.parse(R"json({"longPayload":"1234567890"})json", JSchema::AllSchema()).isValid());
+	EXPECT_EQ(0U, cache.getHits());
+	EXPECT_EQ(0U, cache.getMisses());
+
+	// Failures are not cached.
+	EXPECT_FALSE(cache.parse("{", JSchema::AllSchema()).isValid());
+	EXPECT_FALSE(cache.parse("{", JSchema::AllSchema()).isValid());
+	EXPECT_EQ(0U, cache.getHits());
+	EXPECT_EQ(2U, cache.getMisses());
+
+	// Single slot - replaced by the next payload.
+	cache.parse("{\"a\":1}", JSchema::AllSchema());
+	cache.parse("{\"a\":2}", JSchema::AllSchema());
+	cache.parse("{\"a\":1}", JSchema::AllSchema());
+	EXPECT_EQ(0U, cache.getHits());
+	cache.parse("{\"a\":1}", JSchema::AllSchema());
+	EXPECT_EQ(1U, cache.getHits());
+}
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using namespace pbnjson;
+using LSHelpers::OrderedOffload;
+using LSHelpers::PayloadOffload;
+using LSHelpers::WorkerPool;
+
+TEST(TestPayloadOffload, EstimateSize)
+{
+	JValue value = JObject{{"returnValue", true},
+	                       {"name", "0123456789"},
+	                       {"items", JArray{1, 2, 3}}};
+	size_t size = value.stringify().size();
+	size_t estimate = PayloadOffload::estimateSize(value, SIZE_MAX);
+
+	EXPECT_GE(estimate, size / 2);
+	EXPECT_LE(estimate, size * 2);
+}
+
+TEST(TestPayloadOffload, EstimateStopsAtLimit)
+{
+	JArray items;
+	for (int i = 0; i < 10000; i++)
+	{
+		items.append("0123456789");
+	}
+
+	size_t estimate = PayloadOffload::estimateSize(items, 1000);
+	EXPECT_GE(estimate, 1000u);
+	EXPECT_LT(estimate, 1100u);
+}
+
+TEST(TestPayloadOffload, IsLarge)
+{
+	WorkerPool pool(1);
+	JValue value = JObject{{"name", string(2000, 'a')}};
+
+	EXPECT_FALSE(PayloadOffload().isLarge(size_t(1000000)));
+	EXPECT_FALSE(PayloadOffload().isLarge(value));
+
+	PayloadOffload offload(pool, 1000);
+	EXPECT_FALSE(offload.isLarge(size_t(999)));
+	EXPECT_TRUE(offload.isLarge(size_t(1000)));
+	EXPECT_TRUE(offload.isLarge(value));
+	EXPECT_FALSE(offload.isLarge(JObject{{"returnValue", true}}));
+}
+
+TEST(TestPayloadOffload, OrderedOffload)
+{
+	WorkerPool pool(4);
+	PayloadOffload offload(pool, 1000);
+	OrderedOffload ordered;
+	mutex resultsMutex;
+	vector<int> results;
+
+	auto add = [&](int i)
+	{
+		return [&results, &resultsMutex, i]()
+		{
+			lock_guard<mutex> lock(resultsMutex);
+			results.push_back(i);
+		};
+	};
+
+	// Nothing queued, small tasks run inline.
+	EXPECT_FALSE(ordered.offload(offload, false, add(0)));
+	add(0)();
+
+	for (int i = 1; i <= 100; i++)
+	{
+		bool large = i % 10 == 1;
+		if (!ordered.offload(offload, large, [&, i, large]()
+		                     {
+			                     this_thread::sleep_for(chrono::microseconds(large ? 100 : 1));
+			                     add(i)();
+		                     }))
+		{
+			add(i)();
+		}
+	}
+	ordered.wait();
+
+	ASSERT_EQ(101u, results.size());
+	for (int i = 0; i <= 100; i++)
+	{
+		EXPECT_EQ(i, results[i]);
+	}
+}
+
+TEST(TestPayloadOffload, NoPool)
+{
+	OrderedOffload ordered;
+	EXPECT_FALSE(ordered.offload(PayloadOffload(), true, []() {}));
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+#include "set_shape_schema.hpp"
+
+using namespace std;
+using namespace pbnjson;
+
+TEST(TestSchemaGen, Decode)
+{
+	LSHelpers::JsonParser parser(std::string(R"json({
+		"name": "triangle",
+		"kind": "polygon",
+		"id": 5000000000,
+		"points": [{"x": 0, "y": 0}, {"x": 1, "y": 2}, {"x": 3000000000, "y": -3000000000}],
+		"tags": ["a", "b"]
+	})json"));
+
+	SchemaTest::SetShape shape;
+	ASSERT_TRUE(shape.readFields(parser));
+
+	EXPECT_EQ("triangle", shape.name);
+	EXPECT_EQ("polygon", shape.kind);
+	EXPECT_EQ(1, shape.layer);
+	EXPECT_EQ(5000000000LL, shape.id);
+	EXPECT_TRUE(shape.visible);
+	ASSERT_EQ(3U, shape.points.size());
+	EXPECT_EQ(2, shape.points[1].y);
+
+	// Integers without bounds in the schema are not limited to 32 bits.
+	EXPECT_EQ(3000000000LL, shape.points[2].x);
+	EXPECT_EQ(-3000000000LL, shape.points[2].y);
+	EXPECT_EQ(vector<string>({"a", "b"}), shape.tags);
+}
+
+TEST(TestSchemaGen, Validate)
+{
+	const char* invalid[] = {
+		R"json({"kind": "line", "id": 1})json",                                  // Missing required
+		R"json({"name": "a", "kind": "circle", "id": 1})json",                   // Not in enum
+		R"json({"name": "a", "kind": "line", "id": 1, "layer": 11})json",        // Above maximum
+		R"json({"name": "a", "kind": "line", "id": 1, "scale": 0.1})json",       // Below minimum
+		R"json({"name": "a", "kind": "line", "id": 1, "extra": true})json",      // Additional property
+		R"json({"name": "a", "kind": "line", "id": 1, "points": [{"x": 1}]})json", // Nested required
+		R"json({"name": 5, "kind": "line", "id": 1})json",                       // Wrong type
+	};
+
+	for (const char* payload : invalid)
+	{
+		LSHelpers::JsonParser parser(payload);
+		SchemaTest::SetShape shape;
+		EXPECT_FALSE(shape.readFields(parser)) << payload;
+	}
+}
+
+TEST(TestSchemaGen, Write)
+{
+	SchemaTest::SetShape shape;
+	shape.name = "dot";
+	shape.kind = "line";
+	shape.layer = 2;
+	shape.id = 7;
+	shape.scale = 1;
+	shape.visible = false;
+
+	EXPECT_EQ(R"json({"name":"dot","kind":"line","layer":2,"id":7,"scale":1,"visible":false,"points":[],"tags":[]})json",
+	          shape.toJsonString());
+}
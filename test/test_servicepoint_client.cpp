@@ -35,6 +35,7 @@ public:
 		mLunaClient.registerMethod("/","method", this, &TestService::method);
 		mLunaClient.registerMethod("/","strictMethod", this, &TestService::strictMethod);
 		mLunaClient.registerMethod("/","subscribe", this, &TestService::subscribe);
+		mLunaClient.registerMethod("/","errorMethod", this, &TestService::errorMethod);
 		mService.attachToLoop(mLoop.get());
 
 		// Sleep some to allow service to register with the bus.
@@ -66,6 +67,12 @@ public:
 	}
 
 
+	pbnjson::JValue errorMethod(LSHelpers::JsonRequest& request)
+	{
+		return LSHelpers::ErrorResponse(42, "Test error");
+	}
+
+
 	pbnjson::JValue subscribe(LSHelpers::JsonRequest& request)
 	{
 		bool subscribe;
@@ -111,6 +118,61 @@ TEST(TestSubscriptionPointClient, CallSuccess)
 	ASSERT_TRUE(callOk);
 }
 
+TEST(TestSubscriptionPointClient, CallErrorResponse)
+{
+	TestService ts;
+	MainLoopT loop;
+
+	auto handle = LS::registerService(TEST_CLIENT);
+	handle.attachToLoop(loop.get());
+	LSHelpers::ServicePoint client { &handle };
+
+	//Async call - set callback and wait 100 ms.
+	bool called = false;
+	bool callOk = true;
+	int errorCode = 0;
+	client.callOneReply("luna://" TEST_SERVICE "/errorMethod",
+	                    JObject {},
+	                    [&called, &callOk, &errorCode](LSHelpers::JsonResponse& response)
+	                    {
+		                    called = true;
+		                    callOk = response.isSuccess();
+		                    response.get("errorCode", errorCode);
+	                    });
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	ASSERT_TRUE(called);
+	ASSERT_FALSE(callOk);
+	ASSERT_EQ(42, errorCode);
+}
+
+TEST(TestSubscriptionPointClient, CallResponseCopy)
+{
+	TestService ts;
+	MainLoopT loop;
+
+	auto handle = LS::registerService(TEST_CLIENT);
+	handle.attachToLoop(loop.get());
+	LSHelpers::ServicePoint client { &handle };
+
+	// Copy outlives the handler and the message payload.
+	std::unique_ptr<LSHelpers::JsonResponse> copy;
+	client.callOneReply("luna://" TEST_SERVICE "/method",
+	                    JObject {{"ping","copy"}},
+	                    [&copy](LSHelpers::JsonResponse& response)
+	                    {
+		                    copy.reset(new LSHelpers::JsonResponse(response));
+	                    });
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	ASSERT_TRUE(copy != nullptr);
+	std::string pong;
+	copy->get("pong", pong);
+	ASSERT_TRUE(copy->finishParse(false));
+	ASSERT_TRUE(copy->isSuccess());
+	ASSERT_EQ("copy", pong);
+}
+
 TEST(TestSubscriptionPointClient, CallCancel)
 {
 	TestService ts;
@@ -185,6 +247,47 @@ TEST(TestSubscriptionPointClient, CallParallel)
 	ASSERT_EQ(1000, responses);
 }
 
+TEST(TestSubscriptionPointClient, CallMetrics)
+{
+	TestService ts;
+	MainLoopT loop;
+
+	auto handle = LS::registerService(TEST_CLIENT);
+	handle.attachToLoop(loop.get());
+	LSHelpers::ServicePoint client { &handle };
+	client.enableCallMetrics();
+
+	client.callOneReply("luna://" TEST_SERVICE "/method", JObject {{"ping","1"}}, [](LSHelpers::JsonResponse&) {});
+	client.callOneReply("luna://" TEST_SERVICE "/method", JObject {{"ping","2"}}, [](LSHelpers::JsonResponse&) {});
+	client.callOneReply("luna://" TEST_SERVICE "/errorMethod", JObject {}, [](LSHelpers::JsonResponse&) {});
+	auto token = client.callMultiReply("luna://" TEST_SERVICE "/subscribe",
+	                                   JObject {{"subscribe",true}},
+	                                   [](LSHelpers::JsonResponse&) {});
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	client.cancelCall(token);
+
+	auto method = client.getCallMetrics("luna://" TEST_SERVICE "/method");
+	ASSERT_TRUE(bool(method));
+	ASSERT_EQ(2u, method->calls.load());
+	ASSERT_EQ(2u, method->replies.load());
+	ASSERT_EQ(0u, method->errors.load());
+	ASSERT_EQ(2u, method->roundTripUs.getCount());
+
+	auto error = client.getCallMetrics("luna://" TEST_SERVICE "/errorMethod");
+	ASSERT_TRUE(bool(error));
+	ASSERT_EQ(1u, error->errors.load());
+
+	auto subscribe = client.getCallMetrics("luna://" TEST_SERVICE "/subscribe");
+	ASSERT_TRUE(bool(subscribe));
+	ASSERT_EQ(1u, subscribe->roundTripUs.getCount());
+	ASSERT_GT(subscribe->updateIntervalUs.getCount(), 5u);
+	ASSERT_EQ(subscribe->replies.load(), subscribe->updateIntervalUs.getCount() + 1);
+	ASSERT_EQ(1u, subscribe->cancelled.load());
+
+	ASSERT_FALSE(bool(client.getCallMetrics("luna://" TEST_SERVICE "/strictMethod")));
+	ASSERT_EQ(2, client.getMetrics()["calls"]["luna://" TEST_SERVICE "/method"]["calls"].asNumber<int>());
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -14,6 +14,9 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
 #include <gtest/gtest.h>
 #include <ls2-helpers/ls2-helpers.hpp>
 #include "test_util.hpp"
@@ -26,14 +29,24 @@ using namespace pbnjson;
 class TestService
 {
 public:
-	TestService()
+	explicit TestService(bool requestArena = false)
 			: mService { new LS::Handle(LS::registerService(TEST_SERVICE)) }
 			, mLunaClient { new LSHelpers::ServicePoint( mService.get() ) }
 	{
+		mLunaClient->setRequestArena(requestArena);
 		mLunaClient->registerMethod("/","method", this, &TestService::method);
+		mLunaClient->registerMethod("/","arenaMethod", this, &TestService::arenaMethod);
 		mLunaClient->registerMethod("/","strictMethod", this, &TestService::strictMethod);
+		mLunaClient->registerMethod("/","returnErrorMethod", this, &TestService::returnErrorMethod);
+		mLunaClient->registerMethod("/","writerMethod", this, &TestService::writerMethod);
 		mLunaClient->registerMethod("/","deferred", this, &TestService::deferred);
 		mLunaClient->registerMethod("/","shutdown", this, &TestService::shutdown);
+		mLunaClient->registerMethod("/","limited", this, &TestService::limited);
+		mLunaClient->registerMethod("/","releaseLimited", this, &TestService::releaseLimited);
+		mLunaClient->setAdmissionLimits("/", "limited", LSHelpers::AdmissionLimits(1, 1));
+		mLunaClient->registerMethod("/","rateLimited", this, &TestService::method);
+		mLunaClient->setAdmissionLimits("/", "rateLimited", LSHelpers::AdmissionLimits().senderRate(0.1, 2));
+		mLunaClient->registerStatsMethod("/", "stats");
 		mService->attachToLoop(mLoop.get());
 
 			// Sleep some to allow service to register with the bus.
@@ -47,10 +60,21 @@ public:
 			mDeferred(JObject{{"returnValue", true}});
 			mDeferred = nullptr;
 		}
+		mLimited.clear();
 
 		mLoop.stop();
 	}
 
+	LSHelpers::AdmissionStats getLimitedStats() const
+	{
+		return mLunaClient->getAdmissionStats("/", "limited");
+	}
+
+	void enableMetrics()
+	{
+		mLunaClient->enableMetrics();
+	}
+
 	pbnjson::JValue method(LSHelpers::JsonRequest& request)
 	{
 		std::string ping;
@@ -60,6 +84,23 @@ public:
 		return JObject{{"pong", ping}, {"returnValue", true}};
 	}
 
+	pbnjson::JValue arenaMethod(LSHelpers::JsonRequest& request)
+	{
+		LSHelpers::ArenaString ping{LSHelpers::ArenaAllocator<char>(request.getArena())};
+		LSHelpers::ArenaVector<int32_t> values{LSHelpers::ArenaAllocator<int32_t>(request.getArena())};
+		request.get("ping", ping);
+		request.getArray("values", values);
+		request.finishParseOrThrow(true);
+
+		int32_t sum = 0;
+		for (int32_t value : values)
+		{
+			sum += value;
+		}
+
+		return JObject{{"pong", ping.c_str()}, {"sum", sum}, {"returnValue", true}};
+	}
+
 	pbnjson::JValue strictMethod(LSHelpers::JsonRequest& request)
 	{
 		std::string ping;
@@ -69,6 +110,32 @@ public:
 		return JObject{{"pong", ping}, {"returnValue", true}};
 	}
 
+	pbnjson::JValue returnErrorMethod(LSHelpers::JsonRequest& request)
+	{
+		std::string ping;
+		request.get("ping", ping);
+
+		if (!request.finishParse(true))
+		{
+			return request.getErrorResponse();
+		}
+
+		return JObject{{"pong", ping}, {"returnValue", true}};
+	}
+
+	pbnjson::JValue writerMethod(LSHelpers::JsonRequest& request)
+	{
+		std::string ping;
+		request.get("ping", ping);
+		request.finishParseOrThrow(true);
+
+		LSHelpers::JsonWriter writer;
+		writer.beginObject().field("pong", ping).field("returnValue", true).endObject();
+		request.respond(writer);
+
+		return JObject{{"returnValue", false}}; // Not sent.
+	}
+
 	// Shut down the service and send response
 	pbnjson::JValue shutdown(LSHelpers::JsonRequest& request)
 	{
@@ -96,11 +163,30 @@ public:
 		return true;
 	}
 
+	// Hold on to the request, until released with releaseLimited.
+	pbnjson::JValue limited(LSHelpers::JsonRequest& request)
+	{
+		mLimited.push_back(request.defer());
+		return true;
+	}
+
+	// Respond to the oldest limited request.
+	pbnjson::JValue releaseLimited(LSHelpers::JsonRequest& request)
+	{
+		if (!mLimited.empty())
+		{
+			mLimited.front()(JObject{{"returnValue", true}});
+			mLimited.pop_front();
+		}
+		return true;
+	}
+
 private:
 	MainLoopT mLoop;
 	std::unique_ptr<LS::Handle> mService;
 	std::unique_ptr<LSHelpers::ServicePoint> mLunaClient;
 	LSHelpers::JsonRequest::DeferredResponseFunction mDeferred;
+	std::deque<LSHelpers::JsonRequest::DeferredResponseFunction> mLimited;
 };
 
 
@@ -153,6 +239,63 @@ TEST(TestSubscriptionPointService, CallSuccess)
 	}
 }
 
+TEST(TestSubscriptionPointService, CallArena)
+{
+	for (bool requestArena : {false, true})
+	{
+		TestService ts{requestArena};
+		MainLoopT loop;
+
+		auto client = LS::registerService(TEST_CLIENT);
+		client.attachToLoop(loop.get());
+
+		for (int i = 0; i < 3; i++)
+		{
+			auto call = client.callOneReply("luna://" TEST_SERVICE "/arenaMethod",
+			                                R"({"ping":"hello", "values":[1, 2, 3]})");
+			auto reply = call.get();
+			ASSERT_TRUE(reply.getPayload());
+			LSHelpers::JsonParser p{reply.getPayload()};
+			std::string pong;
+			int32_t sum;
+			ASSERT_TRUE(bool(p.get("pong", pong)));
+			ASSERT_TRUE(bool(p.get("sum", sum)));
+			ASSERT_EQ("hello", pong);
+			ASSERT_EQ(6, sum);
+		}
+
+		// Deferred requests keep their arena until responded.
+		auto call = client.callMultiReply("luna://" TEST_SERVICE "/deferred", R"({"ping":"1"})");
+		ASSERT_FALSE(bool(call.get(200)));
+		auto call1 = client.callMultiReply("luna://" TEST_SERVICE "/deferred", R"({"ping":"1"})");
+		ASSERT_TRUE(bool(call.get(200)));
+	}
+}
+
+TEST(TestSubscriptionPointService, CallWriterResponse)
+{
+	TestService ts;
+	MainLoopT loop;
+
+	auto client = LS::registerService(TEST_CLIENT);
+	client.attachToLoop(loop.get());
+
+	auto call = client.callMultiReply("luna://" TEST_SERVICE "/writerMethod", R"({"ping":"hello \"writer\""})");
+	auto reply = call.get();
+	ASSERT_TRUE(reply.getPayload());
+	LSHelpers::JsonParser p{reply.getPayload()};
+	std::string pong;
+	bool rv;
+	ASSERT_TRUE(bool(p.get("pong", pong)));
+	ASSERT_TRUE(bool(p.get("returnValue", rv)));
+	ASSERT_EQ("hello \"writer\"", pong);
+	ASSERT_TRUE(rv);
+
+	//No second message
+	reply = call.get(200);
+	ASSERT_FALSE(bool(reply));
+}
+
 TEST(TestSubscriptionPointService, CallFail)
 {
 	TestService ts;
@@ -181,6 +324,23 @@ TEST(TestSubscriptionPointService, CallFail)
 		ASSERT_FALSE(bool(reply));
 	}
 
+	//Strict - extra fields, error returned without exception
+	{
+		auto call = client.callMultiReply("luna://" TEST_SERVICE "/returnErrorMethod", R"({"ping":"1", "extra":true})");
+		auto reply = call.get();
+		ASSERT_TRUE(reply.getPayload());
+		LSHelpers::JsonParser p{reply.getPayload()};
+		bool rv;
+		std::string em;
+		int ec;
+		ASSERT_TRUE(bool(p.get("returnValue", rv)));
+		ASSERT_TRUE(bool(p.get("errorMessage", em)));
+		ASSERT_TRUE(bool(p.get("errorCode", ec)));
+		ASSERT_TRUE(bool(p.finishParse(true)));
+		ASSERT_FALSE(rv);
+		ASSERT_EQ(3, ec);
+	}
+
 	//Strict - extra fields
 	{
 		auto call = client.callMultiReply("luna://" TEST_SERVICE "/strictMethod", R"({"ping":"1", "extra":true})");
@@ -240,6 +400,149 @@ TEST(TestSubscriptionPointService, CallShutdown)
 	ASSERT_TRUE(bool(reply));
 }
 
+TEST(TestSubscriptionPointService, CallAdmissionLimits)
+{
+	TestService ts;
+	MainLoopT loop;
+
+	auto client = LS::registerService(TEST_CLIENT);
+	client.attachToLoop(loop.get());
+
+	// First call is in flight, second waits in the queue.
+	auto call = client.callMultiReply("luna://" TEST_SERVICE "/limited", R"({})");
+	auto call1 = client.callMultiReply("luna://" TEST_SERVICE "/limited", R"({})");
+	ASSERT_FALSE(bool(call.get(200)));
+	ASSERT_FALSE(bool(call1.get(10)));
+
+	// Third call is over the queue limit.
+	auto call2 = client.callMultiReply("luna://" TEST_SERVICE "/limited", R"({})");
+	auto reply = call2.get(200);
+	ASSERT_TRUE(bool(reply));
+	JValue response = JDomParser::fromString(reply.getPayload());
+	ASSERT_EQ(6, response["errorCode"].asNumber<int>());
+
+	LSHelpers::AdmissionStats stats = ts.getLimitedStats();
+	EXPECT_EQ(1u, stats.admitted);
+	EXPECT_EQ(1u, stats.queued);
+	EXPECT_EQ(1u, stats.rejected);
+	EXPECT_EQ(1u, stats.inFlight);
+	EXPECT_EQ(1u, stats.queueDepth);
+
+	// Responding to the first call dispatches the second.
+	client.callOneReply("luna://" TEST_SERVICE "/releaseLimited", R"({})").get(200);
+	ASSERT_TRUE(bool(call.get(200)));
+	ASSERT_FALSE(bool(call1.get(100)));
+
+	client.callOneReply("luna://" TEST_SERVICE "/releaseLimited", R"({})").get(200);
+	ASSERT_TRUE(bool(call1.get(200)));
+
+	stats = ts.getLimitedStats();
+	EXPECT_EQ(2u, stats.admitted);
+	EXPECT_EQ(0u, stats.inFlight);
+	EXPECT_EQ(0u, stats.queueDepth);
+}
+
+TEST(TestSubscriptionPointService, CallSenderRate)
+{
+	TestService ts;
+	MainLoopT loop;
+
+	auto client = LS::registerService(TEST_CLIENT);
+	client.attachToLoop(loop.get());
+
+	// Burst of two, then limited.
+	for (int i = 0; i < 2; i++)
+	{
+		auto reply = client.callOneReply("luna://" TEST_SERVICE "/rateLimited", R"({"ping":"hello"})").get(200);
+		ASSERT_TRUE(bool(reply));
+		ASSERT_TRUE(JDomParser::fromString(reply.getPayload())["returnValue"].asBool());
+	}
+
+	auto reply = client.callOneReply("luna://" TEST_SERVICE "/rateLimited", R"({"ping":"hello"})").get(200);
+	ASSERT_TRUE(bool(reply));
+	JValue response = JDomParser::fromString(reply.getPayload());
+	ASSERT_FALSE(response["returnValue"].asBool());
+	ASSERT_EQ(7, response["errorCode"].asNumber<int>());
+}
+
+TEST(TestSubscriptionPointService, CallStats)
+{
+	TestService ts;
+	ts.enableMetrics();
+	MainLoopT loop;
+
+	auto client = LS::registerService(TEST_CLIENT);
+	client.attachToLoop(loop.get());
+
+	client.callOneReply("luna://" TEST_SERVICE "/method", R"({"ping":"hello"})").get(200);
+	client.callOneReply("luna://" TEST_SERVICE "/strictMethod", R"({"ping":"hello","extra":1})").get(200);
+
+	auto reply = client.callOneReply("luna://" TEST_SERVICE "/stats", R"({})").get(200);
+	ASSERT_TRUE(bool(reply));
+	JValue response = JDomParser::fromString(reply.getPayload());
+	ASSERT_TRUE(response["returnValue"].asBool());
+
+	JValue method = response["methods"]["/method"];
+	ASSERT_EQ(1, method["calls"].asNumber<int>());
+	ASSERT_EQ(1, method["handlerUs"]["count"].asNumber<int>());
+	ASSERT_EQ(1, method["responseBytes"]["count"].asNumber<int>());
+	ASSERT_EQ(0, method["errors"].objectSize());
+
+	JValue strict = response["methods"]["/strictMethod"];
+	ASSERT_EQ(1, strict["calls"].asNumber<int>());
+	ASSERT_EQ(1, strict["errors"]["3"].asNumber<int>());
+}
+
+TEST(TestSubscriptionPointService, CallTraced)
+{
+	std::string path = "/tmp/ls2-helpers-test-service-trace-" + std::to_string(getpid()) + ".json";
+	ASSERT_TRUE(LSHelpers::Tracer::start(path));
+
+	{
+		TestService ts;
+		MainLoopT loop;
+
+		auto client = LS::registerService(TEST_CLIENT);
+		client.attachToLoop(loop.get());
+
+		// The trace field is removed before the strict schema check.
+		std::string payload = LSHelpers::Tracer::inject(R"({"ping":"hello"})",
+		                                                LSHelpers::TraceContext{0x1234, 0x5678});
+		auto reply = client.callOneReply("luna://" TEST_SERVICE "/strictMethod", payload.c_str()).get(200);
+		ASSERT_TRUE(bool(reply));
+		JValue response = JDomParser::fromString(reply.getPayload());
+		ASSERT_TRUE(response["returnValue"].asBool());
+		ASSERT_EQ("hello", response["pong"].asString());
+	}
+
+	LSHelpers::Tracer::stop();
+
+	std::ifstream file(path);
+	std::stringstream content;
+	content << file.rdbuf();
+	JValue events = JDomParser::fromString(content.str());
+	unlink(path.c_str());
+	ASSERT_TRUE(events.isArray());
+
+	bool handler = false;
+	bool flow = false;
+	for (const JValue& event : events.items())
+	{
+		if (event["cat"].asString() == "handler" && event["name"].asString() == "/strictMethod")
+		{
+			handler = true;
+			ASSERT_EQ("0x0000000000001234", event["args"]["traceId"].asString());
+		}
+		if (event["ph"].asString() == "f")
+		{
+			flow = true;
+			ASSERT_EQ("0x0000000000005678", event["id"].asString());
+		}
+	}
+	ASSERT_TRUE(handler);
+	ASSERT_TRUE(flow);
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
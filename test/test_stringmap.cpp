@@ -0,0 +1,97 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+
+enum class Color
+{
+	RED,
+	GREEN,
+	BLUE
+};
+
+TEST(TestStringMap, Find)
+{
+	static const LSHelpers::StringMap<Color, 3> colors {{
+		{"red", Color::RED},
+		{"green", Color::GREEN},
+		{"blue", Color::BLUE}
+	}};
+
+	EXPECT_EQ(size_t{3}, colors.size());
+	ASSERT_NE(nullptr, colors.find("red"));
+	EXPECT_EQ(Color::RED, *colors.find("red"));
+	EXPECT_EQ(Color::GREEN, *colors.find("green"));
+	EXPECT_EQ(Color::BLUE, *colors.find("blue"));
+
+	// Length is explicit, the string does not need to be terminated.
+	EXPECT_EQ(Color::RED, *colors.find("redish", 3));
+
+	EXPECT_EQ(nullptr, colors.find("Red"));
+	EXPECT_EQ(nullptr, colors.find("re"));
+	EXPECT_EQ(nullptr, colors.find(""));
+	EXPECT_TRUE(colors.contains("blue"));
+	EXPECT_FALSE(colors.contains("yellow"));
+}
+
+TEST(TestStringMap, ManyKeys)
+{
+	std::vector<std::string> keys;
+	for (int i = 0; i < 64; i++)
+	{
+		keys.push_back("value" + std::to_string(i));
+	}
+
+	std::vector< std::pair<const char*, int> > pairs;
+	for (int i = 0; i < 64; i++)
+	{
+		pairs.emplace_back(keys[i].c_str(), i);
+	}
+
+	LSHelpers::StringMap<int, 4> small {{pairs[0], pairs[1], pairs[2], pairs[3]}};
+	EXPECT_EQ(3, *small.find(keys[3]));
+
+	LSHelpers::StringMap<int, 16> medium {{
+		pairs[0], pairs[1], pairs[2], pairs[3], pairs[4], pairs[5], pairs[6], pairs[7],
+		pairs[8], pairs[9], pairs[10], pairs[11], pairs[12], pairs[13], pairs[14], pairs[15]
+	}};
+
+	for (int i = 0; i < 16; i++)
+	{
+		ASSERT_NE(nullptr, medium.find(keys[i]));
+		EXPECT_EQ(i, *medium.find(keys[i]));
+	}
+	for (int i = 16; i < 64; i++)
+	{
+		EXPECT_EQ(nullptr, medium.find(keys[i]));
+	}
+}
+
+TEST(TestStringMap, InvalidValues)
+{
+	typedef LSHelpers::StringMap<int, 2> Map;
+	EXPECT_THROW(Map({{"a", 1}}), std::invalid_argument);
+	EXPECT_THROW(Map({{"a", 1}, {"a", 2}}), std::invalid_argument);
+}
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using LSHelpers::ScopedSpan;
+using LSHelpers::Span;
+using LSHelpers::SpanKind;
+using LSHelpers::TraceContext;
+using LSHelpers::TraceScope;
+using LSHelpers::Tracer;
+
+static string tracePath()
+{
+	return "/tmp/ls2-helpers-test-trace-" + to_string(getpid()) + ".json";
+}
+
+static string readFile(const string& path)
+{
+	ifstream file(path);
+	stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+TEST(TestTracing, InjectExtract)
+{
+	TraceContext context{0x0123456789abcdefULL, 0xfedcba9876543210ULL};
+
+	string payload = Tracer::inject(R"( {"ping": "hello"})", context);
+	EXPECT_EQ(R"({"$trace":"0123456789abcdef-fedcba9876543210","ping": "hello"})", payload);
+
+	TraceContext extracted;
+	string stripped;
+	ASSERT_TRUE(Tracer::extract(payload.c_str(), extracted, stripped));
+	EXPECT_EQ(context.traceId, extracted.traceId);
+	EXPECT_EQ(context.spanId, extracted.spanId);
+	EXPECT_EQ(R"({"ping": "hello"})", stripped);
+
+	// Empty object.
+	payload = Tracer::inject("{ }", context);
+	EXPECT_EQ(R"({"$trace":"0123456789abcdef-fedcba9876543210"})", payload);
+	ASSERT_TRUE(Tracer::extract(payload.c_str(), extracted, stripped));
+	EXPECT_EQ("{}", stripped);
+
+	// Not an object.
+	EXPECT_EQ("[1]", Tracer::inject("[1]", context));
+}
+
+TEST(TestTracing, ExtractInvalid)
+{
+	TraceContext context;
+	string stripped;
+
+	EXPECT_FALSE(Tracer::extract(R"({"ping":"hello"})", context, stripped));
+	EXPECT_FALSE(Tracer::extract(R"({"$trace":"0123456789abcdef","ping":"hello"})", context, stripped));
+	EXPECT_FALSE(Tracer::extract(R"({"$trace":"0123456789abcdeX-fedcba9876543210"})", context, stripped));
+	EXPECT_FALSE(Tracer::extract(R"({"$trace":"0000000000000000-fedcba9876543210"})", context, stripped));
+	EXPECT_FALSE(Tracer::extract(R"({"$trace":"0123456789abcdef-fedcba9876543210" })", context, stripped));
+	EXPECT_FALSE(Tracer::extract(R"({"$trace")", context, stripped));
+	EXPECT_FALSE(bool(context));
+}
+
+TEST(TestTracing, Scope)
+{
+	EXPECT_FALSE(bool(Tracer::current()));
+	{
+		TraceScope outer{TraceContext{1, 2}};
+		EXPECT_EQ(2u, Tracer::current().spanId);
+		{
+			TraceScope inner{TraceContext{1, 3}};
+			EXPECT_EQ(3u, Tracer::current().spanId);
+		}
+		EXPECT_EQ(2u, Tracer::current().spanId);
+	}
+	EXPECT_FALSE(bool(Tracer::current()));
+}
+
+TEST(TestTracing, WriteFile)
+{
+	string path = tracePath();
+	ASSERT_TRUE(Tracer::start(path));
+	ASSERT_TRUE(Tracer::isEnabled());
+
+	TraceContext root{Tracer::newId(), Tracer::newId()};
+	{
+		ScopedSpan handler(SpanKind::Handler, "/test/method", root);
+		EXPECT_EQ(root.traceId, handler.getContext().traceId);
+		EXPECT_NE(root.spanId, handler.getContext().spanId);
+
+		thread worker([&handler]()
+		{
+			ScopedSpan respond(SpanKind::Respond, nullptr, handler.getContext());
+		});
+		worker.join();
+	}
+
+	// Not traced.
+	{
+		ScopedSpan span(SpanKind::Parse, nullptr, TraceContext());
+		EXPECT_FALSE(bool(span.getContext()));
+	}
+
+	Span call = Span();
+	call.name = "luna://com.webos.test/method";
+	call.kind = SpanKind::Call;
+	call.traceId = root.traceId;
+	call.spanId = Tracer::newId();
+	call.parentId = root.spanId;
+	call.startUs = LSHelpers::MethodMetrics::nowUs();
+	call.durationUs = 100;
+	Tracer::record(call);
+
+	Tracer::stop();
+	EXPECT_FALSE(Tracer::isEnabled());
+
+	string content = readFile(path);
+	unlink(path.c_str());
+
+	EXPECT_EQ('[', content.front());
+	EXPECT_NE(string::npos, content.find(R"("name":"/test/method","cat":"handler","ph":"X")"));
+	EXPECT_NE(string::npos, content.find(R"("name":"respond","cat":"respond","ph":"X")"));
+	EXPECT_EQ(string::npos, content.find(R"("cat":"parse")"));
+	EXPECT_NE(string::npos, content.find(R"("cat":"call","ph":"b")"));
+	EXPECT_NE(string::npos, content.find(R"("cat":"call","ph":"e")"));
+	EXPECT_NE(string::npos, content.find(R"("cat":"flow","ph":"s")"));
+
+	char traceId[24];
+	snprintf(traceId, sizeof(traceId), "0x%016llx", static_cast<unsigned long long>(root.traceId));
+	EXPECT_NE(string::npos, content.find(traceId));
+
+	// Not recorded when stopped.
+	Tracer::record(call);
+	ASSERT_TRUE(Tracer::start(path));
+	Tracer::stop();
+	content = readFile(path);
+	unlink(path.c_str());
+	EXPECT_EQ(string::npos, content.find(R"("cat":"call")"));
+}
+
+TEST(TestTracing, BufferFull)
+{
+	string path = tracePath();
+	ASSERT_TRUE(Tracer::start(path, 60000));
+
+	uint64_t dropped = Tracer::getDropped();
+	TraceContext root{Tracer::newId(), Tracer::newId()};
+	for (size_t i = 0; i < Tracer::BUFFER_SIZE + 10; i++)
+	{
+		ScopedSpan span(SpanKind::Handler, nullptr, root);
+	}
+	EXPECT_EQ(dropped + 10, Tracer::getDropped());
+
+	// Flushing frees the buffer.
+	Tracer::flush();
+	{
+		ScopedSpan span(SpanKind::Handler, nullptr, root);
+	}
+	EXPECT_EQ(dropped + 10, Tracer::getDropped());
+
+	Tracer::stop();
+	unlink(path.c_str());
+}
+
+TEST(TestTracing, PropagateTo)
+{
+	string path = tracePath();
+	EXPECT_FALSE(Tracer::isPropagating("luna://com.webos.test/method"));
+
+	// Not propagated by default.
+	ASSERT_TRUE(Tracer::start(path));
+	EXPECT_FALSE(Tracer::isPropagating("luna://com.webos.test/method"));
+
+	ASSERT_TRUE(Tracer::start(path, 1000, {"com.webos.test", "com.webos.other"}));
+	EXPECT_TRUE(Tracer::isPropagating("luna://com.webos.test/method"));
+	EXPECT_TRUE(Tracer::isPropagating("luna://com.webos.other/category/method"));
+	EXPECT_FALSE(Tracer::isPropagating("luna://com.webos.testing/method"));
+	EXPECT_FALSE(Tracer::isPropagating("luna://com.webos/method"));
+
+	ASSERT_TRUE(Tracer::start(path, 1000, {"*"}));
+	EXPECT_TRUE(Tracer::isPropagating("luna://com.webos.any/method"));
+
+	Tracer::stop();
+	EXPECT_FALSE(Tracer::isPropagating("luna://com.webos.any/method"));
+	unlink(path.c_str());
+}
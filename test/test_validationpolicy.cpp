@@ -0,0 +1,101 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using namespace pbnjson;
+using LSHelpers::ValidationPolicy;
+
+static JSchema testSchema()
+{
+	return JSchema::fromString(R"json({"type":"object","properties":{"id":{"type":"integer"}}})json");
+}
+
+TEST(TestValidationPolicy, Always)
+{
+	JSchema schema = testSchema();
+	ValidationPolicy policy = ValidationPolicy::always();
+
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_EQ(&schema, &policy.selectSchema(schema, "com.webos.service.test"));
+	}
+	policy.recordFailure();
+
+	LSHelpers::ValidationStats stats = policy.getStats();
+	EXPECT_EQ(3U, stats.validated);
+	EXPECT_EQ(0U, stats.skipped);
+	EXPECT_EQ(1U, stats.failed);
+}
+
+TEST(TestValidationPolicy, Sampled)
+{
+	JSchema schema = testSchema();
+	ValidationPolicy policy = ValidationPolicy::sampled(4);
+
+	size_t validated = 0;
+	for (int i = 0; i < 12; i++)
+	{
+		const JSchema& selected = policy.selectSchema(schema, nullptr);
+		if (&selected == &schema)
+		{
+			validated++;
+		}
+		else
+		{
+			EXPECT_EQ(&JSchema::AllSchema(), &selected);
+		}
+	}
+
+	EXPECT_EQ(3U, validated);
+	EXPECT_EQ(3U, policy.getStats().validated);
+	EXPECT_EQ(9U, policy.getStats().skipped);
+
+	// Sampled failures are only counted, the requests are not rejected.
+	EXPECT_TRUE(policy.isMonitoring());
+	EXPECT_FALSE(ValidationPolicy::always().isMonitoring());
+	EXPECT_FALSE(ValidationPolicy::trustedSenders({}).isMonitoring());
+}
+
+TEST(TestValidationPolicy, TrustedSenders)
+{
+	JSchema schema = testSchema();
+	ValidationPolicy policy = ValidationPolicy::trustedSenders({"com.webos.service.b", "com.webos.service.a"});
+
+	EXPECT_EQ(&JSchema::AllSchema(), &policy.selectSchema(schema, "com.webos.service.a"));
+	EXPECT_EQ(&JSchema::AllSchema(), &policy.selectSchema(schema, "com.webos.service.b"));
+	EXPECT_EQ(&schema, &policy.selectSchema(schema, "com.webos.service"));
+	EXPECT_EQ(&schema, &policy.selectSchema(schema, "com.webos.service.c"));
+	EXPECT_EQ(&schema, &policy.selectSchema(schema, nullptr));
+
+	EXPECT_EQ(3U, policy.getStats().validated);
+	EXPECT_EQ(2U, policy.getStats().skipped);
+}
+
+TEST(TestValidationPolicy, CopyResetsCounters)
+{
+	JSchema schema = testSchema();
+	ValidationPolicy policy = ValidationPolicy::sampled(2);
+	policy.selectSchema(schema, nullptr);
+	policy.recordFailure();
+
+	ValidationPolicy copy(policy);
+	EXPECT_EQ(ValidationPolicy::Mode::Sampled, copy.getMode());
+	EXPECT_EQ(0U, copy.getStats().validated);
+	EXPECT_EQ(0U, copy.getStats().failed);
+}
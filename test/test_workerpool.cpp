@@ -0,0 +1,104 @@
+// Copyright (c) 2016-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <ls2-helpers/ls2-helpers.hpp>
+
+using namespace std;
+using LSHelpers::WorkerPool;
+
+TEST(TestWorkerPool, RunsTasks)
+{
+	atomic<int> count(0);
+	{
+		WorkerPool pool(4);
+		EXPECT_EQ(4u, pool.getThreadCount());
+
+		for (int i = 0; i < 100; i++)
+		{
+			EXPECT_TRUE(pool.submit([&count]() { count++; }));
+		}
+	}
+
+	// Destructor runs the queued tasks.
+	EXPECT_EQ(100, count.load());
+}
+
+TEST(TestWorkerPool, KeyedTasksInOrder)
+{
+	const size_t KEYS = 8;
+	vector< vector<int> > results(KEYS);
+
+	{
+		WorkerPool pool(4);
+		for (int i = 0; i < 200; i++)
+		{
+			size_t key = i % KEYS;
+			EXPECT_TRUE(pool.submit([&results, key, i]()
+			                        {
+				                        this_thread::sleep_for(chrono::microseconds(10));
+				                        results[key].push_back(i);
+			                        }, key));
+		}
+	}
+
+	for (size_t key = 0; key < KEYS; key++)
+	{
+		ASSERT_EQ(25u, results[key].size());
+		for (size_t i = 0; i < results[key].size(); i++)
+		{
+			EXPECT_EQ(int(key + i * KEYS), results[key][i]);
+		}
+	}
+}
+
+TEST(TestWorkerPool, QueueCapacity)
+{
+	mutex blockMutex;
+	unique_lock<mutex> block(blockMutex);
+	atomic<int> started(0);
+
+	WorkerPool pool(1, 2);
+
+	// Occupy the only worker.
+	EXPECT_TRUE(pool.submit([&]() { started++; lock_guard<mutex> wait(blockMutex); }));
+	while (started.load() == 0)
+	{
+		this_thread::yield();
+	}
+
+	EXPECT_TRUE(pool.submit([]() {}));
+	EXPECT_TRUE(pool.submit([]() {}, 1));
+	EXPECT_EQ(2u, pool.getQueueSize());
+
+	EXPECT_FALSE(pool.submit([]() {}));
+	EXPECT_FALSE(pool.submit([]() {}, 1));
+
+	block.unlock();
+}
+
+TEST(TestWorkerPool, TaskExceptions)
+{
+	atomic<int> count(0);
+	{
+		WorkerPool pool(1);
+		EXPECT_TRUE(pool.submit([]() { throw runtime_error("Task failed"); }));
+		EXPECT_TRUE(pool.submit([&count]() { count++; }));
+	}
+	EXPECT_EQ(1, count.load());
+}